@@ -0,0 +1,328 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "../common/aggregate.h"
+#include "../common/bitonic_engine.h"
+#include "../common/bitonic_kernels.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+int TEST_MODE = 0;
+
+// for time measurements
+struct timeval startwtime, endwtime;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int P; //number of threads
+int p; //log2(number of threads)
+int N; //number of keys
+int q; //log2(number of keys)
+int D; //keys are drawn from [0,D)
+
+int *orig;   //the random keys
+int *vals;   //a payload per key
+int *a;      //sorted copy
+int *keys;   //run keys
+int *counts; //run lengths
+int  nruns;
+
+struct agg_group *groups;
+int               ngroups;
+
+
+// Function Declaration
+//===========================================================
+
+void   parse_arguments(int argc,char *argv[]);
+void   init           (void);
+void   run_rle        (void);
+void   run_group_by   (void);
+void   test           (void);
+double elapsed        (struct timeval*, struct timeval*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+	init();
+	run_rle();
+	run_group_by();
+	test();
+
+	free(orig);
+	free(vals);
+	free(a);
+	free(keys);
+	free(counts);
+	free(groups);
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 3) {
+		printf("Usage: %s [%s] p q d\n\nwhere, %s is an optional flag (test mode)\n       P=2^p is the number of threads\n       N=2^q is the number of keys\n       d is the number of distinct key values\n",
+		       argv[0],TEST_FLAG,TEST_FLAG);
+		exit(1);
+	}
+
+	p = atoi(argv[arg]);
+	q = atoi(argv[arg+1]);
+	D = atoi(argv[arg+2]);
+
+	if (D < 1) {
+		printf("d must be at least 1.\n");
+		exit(1);
+	}
+
+	P = 1 << p;
+	N = 1 << q;
+}
+
+// function : init()
+// description : N random keys in [0,D), each with a random payload.
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	int i;
+
+	orig   = (int*) malloc((size_t) N * sizeof(int));
+	vals   = (int*) malloc((size_t) N * sizeof(int));
+	a      = (int*) malloc((size_t) N * sizeof(int));
+	keys   = (int*) malloc((size_t) N * sizeof(int));
+	counts = (int*) malloc((size_t) N * sizeof(int));
+	groups = (struct agg_group*) malloc((size_t) N * sizeof(struct agg_group));
+	if (orig == NULL || vals == NULL || a == NULL || keys == NULL ||
+	    counts == NULL || groups == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	srand( time(NULL) );
+	for (i = 0; i < N; i++) {
+		orig[i] = rand() % D;
+		vals[i] = rand() % 2001 - 1000;
+	}
+}
+
+// function : run_rle()
+// description : Time the sort followed by agg_rle(), then the fused
+//               agg_sort_rle(). The first line is the fused time.
+//---------------------------------------------------------------------
+
+void run_rle(void)
+{
+	double t_sort, t_rle, t_fused;
+
+	memcpy(a, orig, (size_t) N * sizeof(int));
+	gettimeofday(&startwtime,NULL);
+	engine_sort(a, N, ENGINE_ASCENDING, P);
+	gettimeofday(&endwtime,NULL);
+	t_sort = elapsed(&startwtime, &endwtime);
+
+	gettimeofday(&startwtime,NULL);
+	nruns = agg_rle(a, N, keys, counts, P);
+	gettimeofday(&endwtime,NULL);
+	t_rle = elapsed(&startwtime, &endwtime);
+
+	memcpy(a, orig, (size_t) N * sizeof(int));
+	gettimeofday(&startwtime,NULL);
+	nruns = agg_sort_rle(a, N, ENGINE_ASCENDING, keys, counts, P);
+	gettimeofday(&endwtime,NULL);
+	t_fused = elapsed(&startwtime, &endwtime);
+
+	if (nruns < 0) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	printf("%lf\n",t_fused);
+	printf("rle: %d runs, fused %lf s, sort %lf s + rle %lf s\n",
+	       nruns, t_fused, t_sort, t_rle);
+}
+
+// function : run_group_by()
+// description : Sort the (key,payload) pairs with the key-value engine,
+//               then time agg_group_by() on them.
+//---------------------------------------------------------------------
+
+void run_group_by(void)
+{
+	struct kernel_kv *kv = (struct kernel_kv*) malloc((size_t) N * sizeof(struct kernel_kv));
+	int i;
+
+	if (kv == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	// keys are >= 0, so they order the same as unsigned
+	for (i = 0; i < N; i++) {
+		kv[i].key = (unsigned long long) orig[i];
+		kv[i].val = (unsigned int) i;
+	}
+	engine_sort_kv(kv, N, ENGINE_ASCENDING, P);
+
+	int *gk = (int*) malloc((size_t) N * sizeof(int));
+	int *gv = (int*) malloc((size_t) N * sizeof(int));
+	if (gk == NULL || gv == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	for (i = 0; i < N; i++) {
+		gk[i] = (int) kv[i].key;
+		gv[i] = vals[kv[i].val];
+	}
+
+	gettimeofday(&startwtime,NULL);
+	ngroups = agg_group_by(gk, gv, N, groups, P);
+	gettimeofday(&endwtime,NULL);
+
+	if (ngroups < 0) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	printf("group-by: %d groups, %lf s\n", ngroups, elapsed(&startwtime, &endwtime));
+
+	free(gk);
+	free(gv);
+	free(kv);
+}
+
+// function : test()
+// description : Check the runs, unique and the groups against serial
+//               loops over stdlib/qsort of the keys.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	int i, g, ok = 1;
+
+	if (TEST_MODE) {
+
+		int       *ref  = (int*) malloc((size_t) N * sizeof(int));
+		long long *sum  = (long long*) calloc(D, sizeof(long long));
+		int       *cnt  = (int*) calloc(D, sizeof(int));
+		int       *mn   = (int*) malloc(D * sizeof(int));
+		int       *mx   = (int*) malloc(D * sizeof(int));
+		int       *uniq = (int*) malloc((size_t) N * sizeof(int));
+		if (ref == NULL || sum == NULL || cnt == NULL || mn == NULL ||
+		    mx == NULL || uniq == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+
+		memcpy(ref, orig, (size_t) N * sizeof(int));
+		qsort(ref, N, sizeof(int), engine_cmp_asc);
+
+		// runs
+		for (i = 0, g = 0; i < N && ok; g++) {
+			int e = i + 1;
+			while (e < N && ref[e] == ref[i])
+				e++;
+			ok = (g < nruns && keys[g] == ref[i] && counts[g] == e - i);
+			i = e;
+		}
+		ok = ok && (g == nruns);
+		ok = ok && (agg_unique_count(ref, N, P) == nruns);
+		ok = ok && (agg_unique(ref, N, uniq, P) == nruns);
+		ok = ok && (memcmp(uniq, keys, (size_t) nruns * sizeof(int)) == 0);
+
+		// groups
+		for (i = 0; i < N; i++) {
+			int k = orig[i];
+			if (cnt[k] == 0 || vals[i] < mn[k]) mn[k] = vals[i];
+			if (cnt[k] == 0 || vals[i] > mx[k]) mx[k] = vals[i];
+			cnt[k]++;
+			sum[k] += vals[i];
+		}
+		ok = ok && (ngroups == nruns);
+		for (g = 0; g < ngroups && ok; g++) {
+			int k = groups[g].key;
+			ok = (k == keys[g] && groups[g].count == cnt[k] && groups[g].sum == sum[k] &&
+			      groups[g].min == mn[k] && groups[g].max == mx[k]);
+		}
+
+		if (ok)
+			printf("Test PASSED. Same results with stdlib/qsort.\n");
+		else
+			printf("Test NOT PASSED. Different results with stdlib/qsort.\n");
+
+		free(ref);
+		free(sum);
+		free(cnt);
+		free(mn);
+		free(mx);
+		free(uniq);
+	}
+}
+
+// function : elapsed()
+// description : Seconds between two gettimeofday() samples.
+//---------------------------------------------------------------------
+
+double elapsed(struct timeval *t0, struct timeval *t1)
+{
+	return (double) ( (t1->tv_usec - t0->tv_usec) / 1.0e6
+	                + t1->tv_sec - t0->tv_sec );
+}
@@ -0,0 +1,295 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#include "../common/sort_async.h"
+#include "../common/bitonic_engine.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+int TEST_MODE = 0;
+
+// for time measurements
+struct timeval startwtime, submitwtime, endwtime;
+double seq_time;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int W; //worker threads of the pool
+int J; //sorts in flight
+int N; //keys per sort (any number)
+
+const int poll_usec = 100000; //progress line every 0.1 s
+
+int **keys;                   //the arrays being sorted
+int **copies;                 //the same keys for qsort (test mode)
+struct sort_future **futures; //one per sort
+
+int completed = 0; //callbacks run so far
+pthread_mutex_t completed_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+// Function Declaration
+//===========================================================
+
+void   parse_arguments(int argc,char *argv[]);
+void   submit_all     (void);
+void   poll_progress  (void);
+void   test           (void);
+void   on_done        (struct sort_future*, void*);
+double elapsed        (struct timeval*, struct timeval*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+
+	if (sort_async_init(W) != 0) {
+		printf("Error creating the worker pool.\n");
+		exit(3);
+	}
+
+	// start measuring time
+	gettimeofday(&startwtime,NULL);
+
+	submit_all();
+	poll_progress();
+
+	// the time stops in the callback of the last sort (on_done),
+	// which for tiny sorts can come before the submit loop returned
+	seq_time = elapsed(&startwtime, &endwtime);
+	if (elapsed(&submitwtime, &endwtime) < 0)
+		submitwtime = endwtime;
+
+	printf("%lf\n",seq_time);
+	printf("overlap: %.6f s generating and submitting, %.6f s sorting after the last submit\n",
+	       elapsed(&startwtime, &submitwtime), elapsed(&submitwtime, &endwtime));
+
+	test();
+	sort_async_shutdown();
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 3) {
+		printf("Usage: %s [%s] w j n\n\nwhere, %s is an optional flag (test mode)\n       w is the number of worker threads in the pool\n       j is the number of sorts in flight at once\n       n is the number of keys per sort (any n >= 1)\n",
+		       argv[0],TEST_FLAG,TEST_FLAG);
+		exit(1);
+	}
+
+	W = atoi(argv[arg]);
+	J = atoi(argv[arg+1]);
+	N = atoi(argv[arg+2]);
+
+	if (W < 1 || J < 1 || N < 1) {
+		printf("w, j and n must be at least 1.\n");
+		exit(1);
+	}
+}
+
+// function : submit_all()
+// description : Generate the keys of each sort and submit it; the
+//               earlier sorts run on the pool while the later keys are
+//               being generated. Odd sorts are descending.
+//---------------------------------------------------------------------
+
+void submit_all(void)
+{
+	int s, i;
+
+	keys    = (int**) malloc(J * sizeof(int*));
+	copies  = (int**) malloc(J * sizeof(int*));
+	futures = (struct sort_future**) malloc(J * sizeof(struct sort_future*));
+	if (keys == NULL || copies == NULL || futures == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	srand( time(NULL) );
+	for (s = 0; s < J; s++) {
+
+		keys[s] = (int*) malloc((size_t) N * sizeof(int));
+		if (keys[s] == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+		for (i = 0; i < N; i++) {
+			keys[s][i] = rand() % N;
+		}
+
+		copies[s] = NULL;
+		if (TEST_MODE) {
+			copies[s] = (int*) malloc((size_t) N * sizeof(int));
+			if (copies[s] == NULL) {
+				printf("Error allocating memory.\n");
+				exit(4);
+			}
+			memcpy(copies[s], keys[s], (size_t) N * sizeof(int));
+		}
+
+		futures[s] = sort_async_submit(keys[s], N, (s % 2 == 0) ? ENGINE_ASCENDING : ENGINE_DESCENDING, on_done, NULL);
+		if (futures[s] == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+	}
+
+	gettimeofday(&submitwtime,NULL);
+}
+
+// function : poll_progress()
+// description : Poll the futures with sort_async_try_wait() and print
+//               the merge levels done over all sorts until every one is
+//               finished.
+//---------------------------------------------------------------------
+
+void poll_progress(void)
+{
+	int s, running = J;
+
+	while (running > 0) {
+
+		int done_levels = 0, total_levels = 0;
+		running = 0;
+
+		for (s = 0; s < J; s++) {
+
+			int d, t;
+			sort_async_progress(futures[s], &d, &t);
+			done_levels  += d;
+			total_levels += t;
+			if (!sort_async_try_wait(futures[s]))
+				running++;
+		}
+
+		pthread_mutex_lock(&completed_mutex);
+		printf("progress: %d of %d levels, %d of %d sorts done\n",
+		       done_levels, total_levels, completed, J);
+		pthread_mutex_unlock(&completed_mutex);
+
+		if (running > 0)
+			usleep(poll_usec);
+	}
+
+	for (s = 0; s < J; s++)
+		sort_async_wait(futures[s]);
+}
+
+// function : on_done()
+// description : Completion callback, on the worker that finished the
+//               sort. The last one stops measuring time, so that the
+//               time does not depend on the progress poll interval.
+//---------------------------------------------------------------------
+
+void on_done(struct sort_future *f, void *arg)
+{
+	pthread_mutex_lock(&completed_mutex);
+	completed++;
+	if (completed == J)
+		gettimeofday(&endwtime,NULL);
+	pthread_mutex_unlock(&completed_mutex);
+}
+
+// function : test()
+// description : Check every sort against stdlib/qsort, then free the
+//               arrays and futures.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	int s, passed = 1;
+
+	for (s = 0; s < J; s++) {
+
+		if (TEST_MODE) {
+
+			qsort(copies[s], N, sizeof(int), (s % 2 == 0) ? engine_cmp_asc : engine_cmp_des);
+			if (memcmp(copies[s], keys[s], (size_t) N * sizeof(int)) != 0)
+				passed = 0;
+			free(copies[s]);
+		}
+
+		sort_async_release(futures[s]);
+		free(keys[s]);
+	}
+
+	if (TEST_MODE) {
+		if (passed)
+			printf("Test PASSED. Same results with stdlib/qsort.\n");
+		else
+			printf("Test NOT PASSED. Different results with stdlib/qsort.\n");
+	}
+
+	free(keys);
+	free(copies);
+	free(futures);
+}
+
+// function : elapsed()
+// description : Seconds between two gettimeofday() samples.
+//---------------------------------------------------------------------
+
+double elapsed(struct timeval *t0, struct timeval *t1)
+{
+	return (double) ( (t1->tv_usec - t0->tv_usec) / 1.0e6
+	                + t1->tv_sec - t0->tv_sec );
+}
@@ -0,0 +1,368 @@
+#!/usr/bin/env python3
+# =======================================================================
+#  This file is part of Bitonic-Sorter.
+#  Copyright (C) 2016 Marios Mitalidis
+#
+#  Bitonic-Sorter is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  Bitonic-Sorter is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+# =======================================================================
+
+"""Scaling analysis and regression check over the bench_*.csv files.
+
+The CSVs hold repeated runs of one driver, one line per run:
+p,q,total_time (P=2^p threads, N=2^q keys, seconds), or q,total_time for
+the serial qsort. Only the standard library is used.
+
+    bench_analysis.py run driver out.csv --p 0 1 2 --q 16 20 24 [--reps r] [--dispatch] [-- flags]
+    bench_analysis.py summary bench.csv [--serial serial.csv] [--plots dir]
+    bench_analysis.py compare baseline.csv candidate.csv [--alpha a] [--threshold t]
+
+run times a driver over a (p,q) grid and writes the CSV. The drivers'
+dispatcher may sort on fewer than P threads, so run passes -nodispatch
+unless --dispatch is given, and every row measures P threads.
+
+summary prints, for every (p,q), the mean time with its confidence
+interval, the speedup over the serial qsort and the strong-scaling
+efficiency speedup/P, then the weak-scaling curves (N/P fixed). With
+--plots it also writes them as SVG files.
+
+compare runs Welch's t-test on every (p,q) of both files and flags the
+ones that got slower by more than the threshold with a one-sided p-value
+below alpha. It exits with 1 if any did, so it can gate a new build or
+machine.
+"""
+
+import argparse
+import csv
+import math
+import os
+import subprocess
+import sys
+
+
+# Statistics
+#===========================================================
+
+def mean_sd(xs):
+    """Mean and sample standard deviation (0 for a single sample)."""
+    n = len(xs)
+    m = sum(xs) / n
+    if n < 2:
+        return m, 0.0
+    return m, math.sqrt(sum((x - m) ** 2 for x in xs) / (n - 1))
+
+
+def betacf(a, b, x):
+    """Continued fraction of the incomplete beta function (Lentz)."""
+    tiny = 1e-300
+    c, d = 1.0, 1.0 - (a + b) * x / (a + 1)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        for num in (m * (b - m) * x / ((a + m2 - 1) * (a + m2)),
+                    -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1))):
+            d = 1.0 + num * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + num / c
+            c = c if abs(c) > tiny else tiny
+            h *= d * c
+        if abs(d * c - 1.0) < 1e-14:
+            break
+    return h
+
+
+def betai(a, b, x):
+    """Regularized incomplete beta function I_x(a,b)."""
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    lbt = (math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b)
+           + a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1) / (a + b + 2):
+        return math.exp(lbt) * betacf(a, b, x) / a
+    return 1.0 - math.exp(lbt) * betacf(b, a, 1.0 - x) / b
+
+
+def t_sf(t, df):
+    """P(T > t) for Student's t with df degrees of freedom."""
+    tail = 0.5 * betai(df / 2.0, 0.5, df / (df + t * t))
+    return tail if t > 0 else 1.0 - tail
+
+
+def t_quantile(p, df):
+    """t with P(T <= t) = p, by bisection on t_sf()."""
+    lo, hi = -1e3, 1e3
+    for _ in range(200):
+        mid = (lo + hi) / 2
+        if 1.0 - t_sf(mid, df) < p:
+            lo = mid
+        else:
+            hi = mid
+    return (lo + hi) / 2
+
+
+def ci(xs, conf):
+    """Mean and half width of its confidence interval."""
+    m, sd = mean_sd(xs)
+    if len(xs) < 2:
+        return m, float("nan")
+    return m, t_quantile(0.5 + conf / 2, len(xs) - 1) * sd / math.sqrt(len(xs))
+
+
+def welch(a, b):
+    """Welch's t-test of mean(b) > mean(a): t, df and one-sided p."""
+    ma, sa = mean_sd(a)
+    mb, sb = mean_sd(b)
+    va, vb = sa * sa / len(a), sb * sb / len(b)
+    if va + vb == 0:
+        return float("inf") if mb > ma else 0.0, float("inf"), 0.0 if mb > ma else 1.0
+    t = (mb - ma) / math.sqrt(va + vb)
+    den = ((va * va / (len(a) - 1) if len(a) > 1 else 0) +
+           (vb * vb / (len(b) - 1) if len(b) > 1 else 0))
+    df = (va + vb) ** 2 / den if den > 0 else 1.0
+    return t, df, t_sf(t, df)
+
+
+# Input
+#===========================================================
+
+def load(path):
+    """Samples of a bench CSV as {(p,q): [seconds]}; p is 0 for the
+    serial qsort file (q,total_time)."""
+    runs = {}
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            p = int(row["p"]) if "p" in row else 0
+            runs.setdefault((p, int(row["q"])), []).append(float(row["total_time"]))
+    if not runs:
+        sys.exit("%s: no samples" % path)
+    return runs
+
+
+# Plots
+#===========================================================
+
+def svg_plot(path, title, xlabel, ylabel, series, logy=False):
+    """Line plot of series {label: [(x,y)]} as a standalone SVG file."""
+    w, h, ml, mr, mt, mb = 640, 420, 70, 140, 40, 50
+    pts = [pt for s in series.values() for pt in s if pt[1] > 0 or not logy]
+    if not pts:
+        return
+    fy = (lambda y: math.log10(y)) if logy else (lambda y: y)
+    x0, x1 = min(x for x, _ in pts), max(x for x, _ in pts)
+    y0, y1 = min(fy(y) for _, y in pts), max(fy(y) for _, y in pts)
+    if not logy:
+        y0 = min(y0, 0.0)
+    if x1 == x0:
+        x1 = x0 + 1
+    if y1 == y0:
+        y1 = y0 + 1
+
+    def sx(x):
+        return ml + (x - x0) / (x1 - x0) * (w - ml - mr)
+
+    def sy(y):
+        return h - mb - (fy(y) - y0) / (y1 - y0) * (h - mt - mb)
+
+    colors = ["#1f77b4", "#ff7f0e", "#2ca02c", "#d62728", "#9467bd",
+              "#8c564b", "#e377c2", "#7f7f7f", "#bcbd22", "#17becf"]
+    out = ['<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" '
+           'font-family="sans-serif" font-size="12">' % (w, h),
+           '<rect width="100%" height="100%" fill="white"/>',
+           '<text x="%d" y="24" font-size="15">%s</text>' % (ml, title),
+           '<line x1="%d" y1="%d" x2="%d" y2="%d" stroke="black"/>' % (ml, h - mb, w - mr, h - mb),
+           '<line x1="%d" y1="%d" x2="%d" y2="%d" stroke="black"/>' % (ml, mt, ml, h - mb),
+           '<text x="%d" y="%d" text-anchor="middle">%s</text>' % ((ml + w - mr) // 2, h - 12, xlabel),
+           '<text x="16" y="%d" transform="rotate(-90 16 %d)" text-anchor="middle">%s</text>'
+           % ((mt + h - mb) // 2, (mt + h - mb) // 2, ylabel)]
+
+    for i in range(5):
+        yv = y0 + (y1 - y0) * i / 4
+        label = ("%.3g" % (10 ** yv)) if logy else ("%.3g" % yv)
+        yy = h - mb - (h - mt - mb) * i / 4
+        out.append('<text x="%d" y="%.1f" text-anchor="end">%s</text>' % (ml - 6, yy + 4, label))
+        out.append('<line x1="%d" y1="%.1f" x2="%d" y2="%.1f" stroke="#ddd"/>' % (ml, yy, w - mr, yy))
+    for x in sorted({x for x, _ in pts}):
+        out.append('<text x="%.1f" y="%d" text-anchor="middle">%g</text>' % (sx(x), h - mb + 16, x))
+
+    for i, (label, s) in enumerate(series.items()):
+        s = sorted(pt for pt in s if pt[1] > 0 or not logy)
+        color = colors[i % len(colors)]
+        if s:
+            out.append('<polyline fill="none" stroke="%s" stroke-width="2" points="%s"/>'
+                       % (color, " ".join("%.1f,%.1f" % (sx(x), sy(y)) for x, y in s)))
+        out.append('<text x="%d" y="%d" fill="%s">%s</text>' % (w - mr + 10, mt + 16 * i + 10, color, label))
+
+    out.append("</svg>")
+    with open(path, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+# Commands
+#===========================================================
+
+def summary(args):
+    runs = load(args.csv)
+    serial = load(args.serial) if args.serial else {}
+    conf = args.confidence
+    name = os.path.splitext(os.path.basename(args.csv))[0]
+
+    stat = {k: ci(v, conf) for k, v in runs.items()}
+    sstat = {q: ci(v, conf) for (_, q), v in serial.items()}
+
+    print("%s: %d points, confidence %g" % (args.csv, len(runs), conf))
+    print("%3s %3s %4s %14s %11s %18s %11s" %
+          ("p", "q", "n", "mean (s)", "+/- (s)", "speedup", "efficiency"))
+
+    speedup = {}
+    for (p, q) in sorted(runs):
+        m, hw = stat[(p, q)]
+        line = "%3d %3d %4d %14.6f %11.6f" % (p, q, len(runs[(p, q)]), m, hw)
+        if q in sstat and m > 0:
+            ms, hs = sstat[q]
+            s = ms / m
+            # first order: relative half widths add in quadrature
+            rel = math.sqrt((hs / ms) ** 2 + (hw / m) ** 2) if ms > 0 else float("nan")
+            speedup[(p, q)] = s
+            line += " %9.3f +/- %5.3f %10.1f%%" % (s, s * rel, 100.0 * s / (1 << p))
+        print(line)
+
+    # weak scaling: N/P = 2^(q-p) fixed, time relative to the fewest threads
+    print("\nweak scaling (N/P fixed): time and efficiency T(p0)/T(p)")
+    weak = {}
+    for (p, q) in sorted(runs):
+        weak.setdefault(q - p, []).append((p, stat[(p, q)][0]))
+    for k in sorted(weak):
+        pts = sorted(weak[k])
+        if len(pts) < 2:
+            continue
+        t0 = pts[0][1]
+        print("  N/P=2^%-2d " % k + "  ".join("p=%d %.6f s (%.0f%%)" % (p, t, 100 * t0 / t)
+                                              for p, t in pts))
+
+    if args.plots:
+        os.makedirs(args.plots, exist_ok=True)
+        ps = sorted({p for p, _ in runs})
+        qs = sorted({q for _, q in runs})
+        svg_plot(os.path.join(args.plots, name + "_time.svg"), name + ": time",
+                 "q (N=2^q)", "seconds",
+                 {"p=%d" % p: [(q, stat[(p, q)][0]) for q in qs if (p, q) in stat] for p in ps},
+                 logy=True)
+        if speedup:
+            svg_plot(os.path.join(args.plots, name + "_speedup.svg"),
+                     name + ": speedup over serial qsort", "q (N=2^q)", "speedup",
+                     {"p=%d" % p: [(q, speedup[(p, q)]) for q in qs if (p, q) in speedup] for p in ps})
+            svg_plot(os.path.join(args.plots, name + "_efficiency.svg"),
+                     name + ": strong-scaling efficiency", "p (P=2^p)", "speedup / P",
+                     {"q=%d" % q: [(p, speedup[(p, q)] / (1 << p)) for p in ps if (p, q) in speedup]
+                      for q in qs[::max(1, len(qs) // 8)]})
+        svg_plot(os.path.join(args.plots, name + "_weak.svg"), name + ": weak scaling",
+                 "p (P=2^p)", "T(p0) / T(p)",
+                 {"N/P=2^%d" % k: [(p, sorted(weak[k])[0][1] / t) for p, t in weak[k]]
+                  for k in sorted(weak)[::max(1, len(weak) // 8)] if len(weak[k]) > 1})
+        print("\nplots written to %s" % args.plots)
+    return 0
+
+
+def run(args):
+    mode = [] if args.dispatch else ["-nodispatch"]
+    with open(args.out, "w", newline="") as f:
+        out = csv.writer(f)
+        out.writerow(["p", "q", "total_time"])
+        for q in args.q:
+            for p in args.p:
+                for _ in range(args.reps):
+                    cmd = [args.driver] + mode + args.flags + [str(p), str(q)]
+                    res = subprocess.run(cmd, capture_output=True, text=True)
+                    if res.returncode != 0:
+                        sys.exit("%s: exit status %d\n%s" % (" ".join(cmd), res.returncode, res.stdout))
+                    # the time is the first line that is a number
+                    for line in res.stdout.split("\n"):
+                        try:
+                            t = float(line)
+                        except ValueError:
+                            continue
+                        out.writerow([p, q, "%f" % t])
+                        break
+                    else:
+                        sys.exit("%s: no time in the output" % " ".join(cmd))
+            f.flush()
+    return 0
+
+
+def compare(args):
+    base = load(args.baseline)
+    cand = load(args.candidate)
+    common = sorted(set(base) & set(cand))
+    if not common:
+        sys.exit("no (p,q) in both files")
+
+    print("%3s %3s %14s %14s %8s %10s" % ("p", "q", "baseline (s)", "candidate (s)", "change", "p-value"))
+    flagged = 0
+    for k in common:
+        mb, _ = mean_sd(base[k])
+        mc, _ = mean_sd(cand[k])
+        _, _, pv = welch(base[k], cand[k])
+        change = mc / mb - 1.0 if mb > 0 else 0.0
+        slow = pv < args.alpha and change > args.threshold
+        flagged += slow
+        print("%3d %3d %14.6f %14.6f %+7.1f%% %10.2g%s" %
+              (k[0], k[1], mb, mc, 100 * change, pv, "  SLOWER" if slow else ""))
+
+    print("\n%d of %d points significantly slower (alpha %g, threshold %g%%)" %
+          (flagged, len(common), args.alpha, 100 * args.threshold))
+    return 1 if flagged else 0
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    default_serial = os.path.join(here, "..", "pthread_qsort", "bench_qsort_serial.csv")
+
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    r = sub.add_parser("run", help="time a driver over a (p,q) grid into a CSV")
+    r.add_argument("driver")
+    r.add_argument("out")
+    r.add_argument("--p", type=int, nargs="+", required=True, help="P=2^p threads")
+    r.add_argument("--q", type=int, nargs="+", required=True, help="N=2^q keys")
+    r.add_argument("--reps", type=int, default=10, help="runs of every point")
+    r.add_argument("--dispatch", action="store_true",
+                   help="let the dispatcher pick the threads (default -nodispatch)")
+
+    s = sub.add_parser("summary", help="speedup, efficiency and weak scaling of one CSV")
+    s.add_argument("csv")
+    s.add_argument("--serial", default=default_serial if os.path.exists(default_serial) else None,
+                   help="serial qsort CSV (q,total_time) for the speedups")
+    s.add_argument("--confidence", type=float, default=0.95)
+    s.add_argument("--plots", help="directory for the SVG plots")
+
+    c = sub.add_parser("compare", help="flag significant slowdowns against a baseline")
+    c.add_argument("baseline")
+    c.add_argument("candidate")
+    c.add_argument("--alpha", type=float, default=0.01, help="one-sided significance level")
+    c.add_argument("--threshold", type=float, default=0.05,
+                   help="smallest relative slowdown to flag (0.05 = 5%%)")
+
+    # driver flags (run) follow "--", apart from the own arguments
+    argv = sys.argv[1:]
+    flags = argv[argv.index("--") + 1:] if "--" in argv else []
+    args = ap.parse_args(argv[:argv.index("--")] if "--" in argv else argv)
+    args.flags = flags
+    return {"run": run, "summary": summary, "compare": compare}[args.cmd](args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,344 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptive_bitonic.h"
+#include "bitonic_kernels.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int abs_task_grain = 1<<14; //merges/walks above this size are forked
+const int abs_array_max  = 1<<20; //still contiguous blocks up to this size
+                                  //are merged in the array (sequential
+                                  //access beats the pointer walks there)
+
+static int  *abs_v;      //node values (the drivers' array)
+static int  *abs_id;     //tie breaker, moves with the value
+static int  *abs_left;   //left child of each node, -1 for none
+static int  *abs_right;  //right child of each node, -1 for none
+static char *abs_merged; //per block root: the block has been merged
+static int   abs_n;
+static abs_fork  abs_fork_fn;  //the driver's two-way fork (NULL: serial)
+static abs_array abs_array_fn; //the driver's parallel array merge
+
+struct abs_tree_args {
+
+	int root;
+	int spare;
+	int cnt;
+	int dir;
+	int threads;
+}; // a half of abs_merge_tree() handed to the fork
+
+struct abs_walk_args {
+
+	int  node;
+	int  size;
+	int *out;
+	int  threads;
+}; // a subtree of abs_inorder() handed to the fork
+
+// The prefix/suffix property only holds for distinct keys, so equal
+// values are ordered by their id. A leaf run gets ids that follow its
+// order when it is first merged; after that every merge keeps the
+// blocks sorted by (value, id).
+#define ABS_GREATER(x,y) (abs_v[x] > abs_v[y] || (abs_v[x] == abs_v[y] && abs_id[x] > abs_id[y]))
+
+// nodes x and y are out of order for direction dir
+#define ABS_SWAP_NEEDED(x,y,dir) ((dir) ? ABS_GREATER(x,y) : ABS_GREATER(y,x))
+
+
+// Function Declaration
+//===========================================================
+
+static void  abs_merge_tree (int, int, int, int, int);
+static void* abs_tree_task  (void*);
+static void  abs_number_run (int, int);
+static void  abs_array_merge(int*, int, int);
+static void  abs_inorder    (int, int, int*, int);
+static void* abs_walk_task  (void*);
+
+
+// Function Definition
+//===========================================================
+
+// function : abs_init()
+// description : Build the perfect tree whose in-order walk is v[0..n-1):
+//               node x has height h = log2 of the lowest set bit of x+1
+//               and children x -/+ 2^(h-1). Node n-1 is the spare.
+//               fork and merge are the driver's backend (see header).
+//---------------------------------------------------------------------
+
+void abs_init(int *v, int n, abs_fork fork, abs_array merge)
+{
+	abs_v     = v;
+	abs_n     = n;
+	abs_fork_fn  = fork;
+	abs_array_fn = merge;
+	abs_id     = (int*) malloc(n * sizeof(int));
+	abs_left   = (int*) malloc(n * sizeof(int));
+	abs_right  = (int*) malloc(n * sizeof(int));
+	abs_merged = (char*) calloc(n, sizeof(char));
+
+	if (abs_id == NULL || abs_left == NULL || abs_right == NULL || abs_merged == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	int x;
+	for (x = 0; x < n - 1; x++) {
+
+		int low = (x + 1) & -(x + 1);
+
+		abs_left[x]  = (low == 1) ? -1 : x - low/2;
+		abs_right[x] = (low == 1) ? -1 : x + low/2;
+	}
+	abs_left[n-1] = abs_right[n-1] = -1;
+}
+
+// function : abs_merge()
+// description : Merge the bitonic block [lo,lo+cnt) in direction dir.
+//               Its subtree root is node lo+cnt/2-1 and its spare node
+//               lo+cnt-1; both keep their identity while the blocks
+//               below them are merged. A half that has not been merged
+//               yet is a leaf sorted in place by the driver. Up to
+//               threads threads work on it.
+//---------------------------------------------------------------------
+
+void abs_merge(int lo, int cnt, int dir, int threads)
+{
+	if (cnt < 2)
+		return;
+
+	int h = cnt / 2;
+	int contiguous1 = (h == 1 || !abs_merged[lo + h/2 - 1]);
+	int contiguous2 = (h == 1 || !abs_merged[lo + h + h/2 - 1]);
+
+	// small block, both halves still in place: the block stays a leaf
+	if (contiguous1 && contiguous2 && cnt <= abs_array_max) {
+		if (abs_array_fn != NULL)
+			abs_array_fn(lo, cnt, dir, threads);
+		else
+			abs_array_merge(abs_v + lo, cnt, dir);
+		return;
+	}
+
+	if (contiguous1)
+		abs_number_run(lo, h);
+	if (contiguous2)
+		abs_number_run(lo + h, h);
+
+	abs_merge_tree(lo + h - 1, lo + cnt - 1, cnt, dir, threads);
+
+	abs_merged[lo + h - 1] = 1;
+}
+
+// function : abs_number_run()
+// description : Ids for the sorted leaf run [lo,lo+cnt), increasing in
+//               the direction it was sorted in. They are a permutation
+//               of lo..lo+cnt-1, so ids never collide between runs.
+//---------------------------------------------------------------------
+
+static void abs_number_run(int lo, int cnt)
+{
+	int asc = abs_v[lo] <= abs_v[lo + cnt - 1];
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		abs_id[lo + i] = asc ? lo + i : lo + cnt - 1 - i;
+}
+
+// function : abs_array_merge()
+// description : Serial bitonic merge on a contiguous block, for a
+//               driver that has no array merge to give.
+//---------------------------------------------------------------------
+
+static void abs_array_merge(int *v, int cnt, int dir)
+{
+	if (cnt > KERNEL_MAX_CNT) {
+
+		int k = cnt / 2;
+
+		kernel_compare_level(v, k, dir);
+
+		abs_array_merge(v, k, dir);
+		abs_array_merge(v + k, k, dir);
+	}
+	else {
+		kernel_merge_small(v, cnt, dir);
+	}
+}
+
+// function : abs_merge_tree()
+// description : Bitonic merge of the tree (root, spare) of cnt keys.
+//               In a bitonic sequence the pairs (i, i+cnt/2) that the
+//               half cleaner exchanges form a prefix or a suffix of the
+//               first half; comparing root with spare (the last pair)
+//               tells which. A binary search down both subtrees in step
+//               finds where the exchanged part ends, and every subtree
+//               lying entirely inside it is exchanged as a whole by
+//               swapping two child pointers. That is O(log cnt) work per
+//               half cleaner and O(cnt) for the whole merge. The two
+//               halves are forked while the budget of threads lasts.
+//---------------------------------------------------------------------
+
+static void abs_merge_tree(int root, int spare, int cnt, int dir, int threads)
+{
+	int *v = abs_v, *id = abs_id, *L = abs_left, *R = abs_right;
+	int tmp;
+
+	// exchanged part is a suffix of the first half
+	int suffix = ABS_SWAP_NEEDED(root, spare, dir);
+	if (suffix) {
+		tmp = v[root];  v[root]  = v[spare];  v[spare]  = tmp;
+		tmp = id[root]; id[root] = id[spare]; id[spare] = tmp;
+	}
+
+	int p = L[root];
+	int q = R[root];
+
+	while (p >= 0) {
+
+		if (ABS_SWAP_NEEDED(p, q, dir)) {
+
+			tmp = v[p];  v[p]  = v[q];  v[q]  = tmp;
+			tmp = id[p]; id[p] = id[q]; id[q] = tmp;
+
+			// everything on the far side of p is exchanged too
+			if (suffix) {
+				tmp = R[p]; R[p] = R[q]; R[q] = tmp;
+				p = L[p]; q = L[q];
+			}
+			else {
+				tmp = L[p]; L[p] = L[q]; L[q] = tmp;
+				p = R[p]; q = R[q];
+			}
+		}
+		else {
+
+			if (suffix) {
+				p = R[p]; q = R[q];
+			}
+			else {
+				p = L[p]; q = L[q];
+			}
+		}
+	}
+
+	// both halves are bitonic now
+	if (cnt > abs_task_grain && threads > 1 && abs_fork_fn != NULL) {
+
+		struct abs_tree_args half1 = { L[root], root,  cnt/2, dir, threads / 2 };
+		struct abs_tree_args half2 = { R[root], spare, cnt/2, dir, threads - threads / 2 };
+
+		abs_fork_fn(abs_tree_task, (void*) &half1, (void*) &half2);
+	}
+	else if (cnt > 2) {
+
+		abs_merge_tree(L[root], root, cnt/2, dir, 1);
+		abs_merge_tree(R[root], spare, cnt/2, dir, 1);
+	}
+}
+
+// function : abs_tree_task()
+// description : abs_merge_tree() on struct abs_tree_args, for the fork.
+//---------------------------------------------------------------------
+
+static void* abs_tree_task(void *ptr)
+{
+	struct abs_tree_args *t = ptr;
+
+	abs_merge_tree(t->root, t->spare, t->cnt, t->dir, t->threads);
+	return NULL;
+}
+
+// function : abs_finish()
+// description : Write the in-order walk of the tree (then the spare)
+//               back to the array and free the tree, on up to threads
+//               threads.
+//---------------------------------------------------------------------
+
+void abs_finish(int threads)
+{
+	int n = abs_n;
+	int *out = (int*) malloc(n * sizeof(int));
+
+	if (out == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	if (n > 1)
+		abs_inorder(n/2 - 1, n - 1, out, threads);
+	out[n-1] = abs_v[n-1];
+
+	memcpy(abs_v, out, n * sizeof(int));
+
+	free(out);
+	free(abs_id);
+	free(abs_left);
+	free(abs_right);
+	free(abs_merged);
+}
+
+// function : abs_inorder()
+// description : In-order walk of a subtree of size nodes into out.
+//               The subtrees are forked while the budget lasts.
+//---------------------------------------------------------------------
+
+static void abs_inorder(int node, int size, int *out, int threads)
+{
+	if (node < 0)
+		return;
+
+	int half = size / 2;
+
+	out[half] = abs_v[node];
+
+	if (size > abs_task_grain && threads > 1 && abs_fork_fn != NULL) {
+
+		struct abs_walk_args left  = { abs_left[node],  half, out,            threads / 2 };
+		struct abs_walk_args right = { abs_right[node], half, out + half + 1, threads - threads / 2 };
+
+		abs_fork_fn(abs_walk_task, (void*) &left, (void*) &right);
+	}
+	else {
+
+		abs_inorder(abs_left[node], half, out, 1);
+		abs_inorder(abs_right[node], half, out + half + 1, 1);
+	}
+}
+
+// function : abs_walk_task()
+// description : abs_inorder() on struct abs_walk_args, for the fork.
+//---------------------------------------------------------------------
+
+static void* abs_walk_task(void *ptr)
+{
+	struct abs_walk_args *w = ptr;
+
+	abs_inorder(w->node, w->size, w->out, w->threads);
+	return NULL;
+}
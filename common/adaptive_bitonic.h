@@ -0,0 +1,53 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#ifndef ADAPTIVE_BITONIC_H
+#define ADAPTIVE_BITONIC_H
+
+// Adaptive bitonic merge (Bilardi & Nicolau) for the drivers' -abs flag.
+//
+// abs_init() turns v[0..n) (n a power of two) into a bitonic tree: node
+// i holds v[i], the in-order walk of the tree followed by the spare
+// node n-1 gives the sequence. A block [lo,lo+cnt) (cnt a power of two,
+// lo a multiple of cnt) is a subtree plus its spare, and as long as no
+// merge has touched it, it is still contiguous in v, so the leaves can
+// be sorted in place as usual. abs_merge() then merges a bitonic block
+// with O(cnt) work by swapping subtrees instead of keys (small blocks
+// are merged in the array and stay contiguous), and abs_finish()
+// writes the sorted sequence back to v.
+//
+// The parallelism comes from the driver's backend. fork runs task(x)
+// and task(y), at the same time if it can, and returns when both are
+// done (OpenMP tasks, cilk_spawn, a helper pthread). merge is the
+// driver's parallel bitonic merge of the contiguous a[lo..lo+cnt),
+// which takes the array-sized merges. Either may be NULL (serial).
+// abs_merge() and abs_finish() get a budget of threads, as the
+// drivers' merges do, and fork only while it lasts.
+//===========================================================
+
+typedef void* (*abs_task) (void *arg);
+typedef void  (*abs_fork) (abs_task task, void *x, void *y);
+typedef void  (*abs_array)(int lo, int cnt, int dir, int threads);
+
+void abs_init  (int *v, int n, abs_fork fork, abs_array merge);
+void abs_merge (int lo, int cnt, int dir, int threads);
+void abs_finish(int threads);
+
+#endif
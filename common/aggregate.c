@@ -0,0 +1,426 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "aggregate.h"
+#include "bitonic_engine.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int agg_min_par = 1<<16; //below this many keys, one thread
+
+struct agg_block {
+
+	int lo;
+	int cnt;
+	int runs; //runs of v[lo..lo+cnt), encoded at lo in the scratch arrays
+	int off;  //where they go in the output
+	int cont; //the first run continues the last run of the block before
+}; // one final block of agg_sort_rle()
+
+struct agg_fused {
+
+	int              *sk;     //run keys, per block at its lo
+	int              *sc;     //run lengths (NULL for unique)
+	struct agg_block *blocks;
+	int               nblocks;
+	int               cap;
+	int               err;
+}; // state of one agg_sort_rle() call
+
+
+// Function Declaration
+//===========================================================
+
+static void agg_visit  (const int*, int, int, void*);
+static int  agg_cmp_lo (const void*, const void*);
+static void agg_add    (struct agg_group*, int);
+static void agg_fold   (struct agg_group*, const struct agg_group*);
+
+
+// Function Definition
+//===========================================================
+
+// function : agg_unique_count()
+// description : Number of distinct keys: one plus the boundaries.
+//---------------------------------------------------------------------
+
+int agg_unique_count(const int *v, int n, int nthreads)
+{
+	int i, c = 1;
+
+	if (n < 1)
+		return 0;
+	if (n < agg_min_par || nthreads < 1)
+		nthreads = 1;
+
+	// the comparisons are added, not branched on, so the scan vectorizes
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) reduction(+:c)
+	for (i = 1; i < n; i++)
+		c += (v[i] != v[i-1]);
+
+	return c;
+}
+
+// function : agg_unique()
+// description : The distinct keys of v, in order.
+//---------------------------------------------------------------------
+
+int agg_unique(const int *v, int n, int *keys, int nthreads)
+{
+	return agg_rle(v, n, keys, NULL, nthreads);
+}
+
+// function : agg_rle()
+// description : Run-length encoding of v:
+//               1. every thread counts the runs that start in its chunk,
+//               2. the counts are prefix summed into offsets,
+//               3. every thread writes the keys and start positions of
+//                  its runs, then turns the positions into lengths: a
+//                  run ends where the next one starts, which may be in
+//                  the next chunk, so that start is read first.
+//               Returns the number of runs, -1 if out of memory.
+//---------------------------------------------------------------------
+
+int agg_rle(const int *v, int n, int *keys, int *counts, int nthreads)
+{
+	int *off;
+	int  total;
+
+	if (n < 1)
+		return 0;
+	if (n < agg_min_par || nthreads < 1)
+		nthreads = 1;
+
+	off = (int*) malloc((nthreads + 1) * sizeof(int));
+	if (off == NULL)
+		return -1;
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+	{
+		int t  = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+		int a  = (int) ((long long) n * t / nt);
+		int b  = (int) ((long long) n * (t + 1) / nt);
+		int i, g, c = 0, next;
+
+		// 1.
+		for (i = a; i < b; i++)
+			c += (i == 0 || v[i] != v[i-1]);
+		off[t+1] = c;
+
+		#pragma omp barrier
+
+		// 2.
+		#pragma omp single
+		{
+			int s;
+			off[0] = 0;
+			for (s = 1; s <= nt; s++)
+				off[s] += off[s-1];
+			total = off[nt];
+		}
+
+		// 3.
+		for (i = a, g = off[t]; i < b; i++) {
+			if (i == 0 || v[i] != v[i-1]) {
+				keys[g] = v[i];
+				if (counts)
+					counts[g] = i;
+				g++;
+			}
+		}
+
+		if (counts) {
+
+			#pragma omp barrier
+			next = (off[t+1] < total) ? counts[off[t+1]] : n;
+			#pragma omp barrier
+
+			for (g = off[t+1] - 1; g >= off[t]; g--) {
+				int start = counts[g];
+				counts[g] = next - start;
+				next = start;
+			}
+		}
+	}
+
+	free(off);
+	return total;
+}
+
+// function : agg_group_by()
+// description : Count, sum, min and max of vals per key, split like
+//               agg_rle(). A group that starts in an earlier chunk is
+//               summed up by every thread it reaches into as a partial
+//               (head) group, and the heads are folded into their groups
+//               at the end, in order. Returns the number of groups, -1
+//               if out of memory.
+//---------------------------------------------------------------------
+
+int agg_group_by(const int *keys, const int *vals, int n, struct agg_group *out, int nthreads)
+{
+	struct agg_group *head;
+	int              *off, *has_head;
+	int               t, total, nt = 1;
+
+	if (n < 1)
+		return 0;
+	if (n < agg_min_par || nthreads < 1)
+		nthreads = 1;
+
+	off      = (int*) malloc((nthreads + 1) * sizeof(int));
+	has_head = (int*) calloc(nthreads, sizeof(int));
+	head     = (struct agg_group*) malloc(nthreads * sizeof(struct agg_group));
+	if (off == NULL || has_head == NULL || head == NULL) {
+		free(off);
+		free(has_head);
+		free(head);
+		return -1;
+	}
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+	{
+		int me = omp_get_thread_num();
+		int tt = omp_get_num_threads();
+		int a  = (int) ((long long) n * me / tt);
+		int b  = (int) ((long long) n * (me + 1) / tt);
+		int i, g, c = 0;
+
+		for (i = a; i < b; i++)
+			c += (i == 0 || keys[i] != keys[i-1]);
+		off[me+1] = c;
+
+		#pragma omp barrier
+
+		#pragma omp single
+		{
+			int s;
+			off[0] = 0;
+			for (s = 1; s <= tt; s++)
+				off[s] += off[s-1];
+			total = off[tt];
+			nt    = tt;
+		}
+
+		for (i = a, g = off[me] - 1; i < b; i++) {
+
+			if (i == 0 || keys[i] != keys[i-1]) {
+				g++;
+				out[g].key   = keys[i];
+				out[g].count = 1;
+				out[g].sum   = vals[i];
+				out[g].min   = vals[i];
+				out[g].max   = vals[i];
+			}
+			else if (g < off[me]) {
+				if (!has_head[me]) {
+					head[me].key   = keys[i];
+					head[me].count = 1;
+					head[me].sum   = vals[i];
+					head[me].min   = vals[i];
+					head[me].max   = vals[i];
+					has_head[me]   = 1;
+				}
+				else
+					agg_add(&head[me], vals[i]);
+			}
+			else
+				agg_add(&out[g], vals[i]);
+		}
+	}
+
+	for (t = 1; t < nt; t++)
+		if (has_head[t])
+			agg_fold(&out[off[t] - 1], &head[t]);
+
+	free(off);
+	free(has_head);
+	free(head);
+	return total;
+}
+
+// function : agg_sort_rle()
+// description : Sort v with engine_sort_visit(), encoding every final
+//               block at its own position in the scratch arrays as it
+//               is visited. Then, in block order, a block's first run
+//               continues the run before if the keys are equal; the
+//               offsets are summed up, the runs moved in parallel, and
+//               the first runs of the continuing blocks added to the
+//               runs they continue. Without scratch memory, v is sorted
+//               and encoded in two passes.
+//---------------------------------------------------------------------
+
+int agg_sort_rle(int *v, int n, int dir, int *keys, int *counts, int nthreads)
+{
+	struct agg_fused f;
+	int b, total = 0;
+
+	if (n < 1)
+		return 0;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	memset(&f, 0, sizeof(f));
+	f.sk = (int*) malloc((size_t) n * sizeof(int));
+	if (counts)
+		f.sc = (int*) malloc((size_t) n * sizeof(int));
+
+	if (f.sk == NULL || (counts && f.sc == NULL)) {
+		free(f.sk);
+		free(f.sc);
+		engine_sort(v, n, dir, nthreads);
+		return agg_rle(v, n, keys, counts, nthreads);
+	}
+
+	engine_sort_visit(v, n, dir, nthreads, agg_visit, &f);
+
+	if (f.err) {
+		free(f.sk);
+		free(f.sc);
+		free(f.blocks);
+		return agg_rle(v, n, keys, counts, nthreads);
+	}
+
+	qsort(f.blocks, f.nblocks, sizeof(struct agg_block), agg_cmp_lo);
+
+	for (b = 0; b < f.nblocks; b++) {
+		struct agg_block *x = &f.blocks[b];
+		x->cont = (b > 0 && f.sk[x->lo] == v[x->lo - 1]);
+		x->off  = total;
+		total  += x->runs - x->cont;
+	}
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1 && f.nblocks > 1) schedule(dynamic,1)
+	for (b = 0; b < f.nblocks; b++) {
+
+		struct agg_block *x = &f.blocks[b];
+		int len = x->runs - x->cont;
+
+		memcpy(keys + x->off, f.sk + x->lo + x->cont, (size_t) len * sizeof(int));
+		if (counts)
+			memcpy(counts + x->off, f.sc + x->lo + x->cont, (size_t) len * sizeof(int));
+	}
+
+	if (counts)
+		for (b = 0; b < f.nblocks; b++)
+			if (f.blocks[b].cont)
+				counts[f.blocks[b].off - 1] += f.sc[f.blocks[b].lo];
+
+	free(f.sk);
+	free(f.sc);
+	free(f.blocks);
+	return total;
+}
+
+// function : agg_visit()
+// description : engine_sort_visit() callback: encode the runs of the
+//               final block v[lo..lo+cnt) at lo, and record the block.
+//---------------------------------------------------------------------
+
+static void agg_visit(const int *v, int lo, int cnt, void *arg)
+{
+	struct agg_fused *f = (struct agg_fused*) arg;
+	int i, r = 0;
+
+	f->sk[lo] = v[lo];
+	if (f->sc) {
+		f->sc[lo] = 1;
+		for (i = lo + 1; i < lo + cnt; i++) {
+			if (v[i] != v[i-1]) {
+				r++;
+				f->sk[lo+r] = v[i];
+				f->sc[lo+r] = 1;
+			}
+			else
+				f->sc[lo+r]++;
+		}
+	}
+	else {
+		for (i = lo + 1; i < lo + cnt; i++) {
+			if (v[i] != v[i-1])
+				f->sk[lo + ++r] = v[i];
+		}
+	}
+
+	#pragma omp critical(agg_blocks)
+	{
+		if (f->nblocks == f->cap) {
+			int               cap = f->cap ? 2 * f->cap : 64;
+			struct agg_block *nb  = (struct agg_block*) realloc(f->blocks, cap * sizeof(struct agg_block));
+			if (nb == NULL)
+				f->err = 1;
+			else {
+				f->blocks = nb;
+				f->cap    = cap;
+			}
+		}
+		if (!f->err) {
+			f->blocks[f->nblocks].lo   = lo;
+			f->blocks[f->nblocks].cnt  = cnt;
+			f->blocks[f->nblocks].runs = r + 1;
+			f->nblocks++;
+		}
+	}
+}
+
+// function : agg_cmp_lo()
+// description : qsort comparator, blocks by position.
+//---------------------------------------------------------------------
+
+static int agg_cmp_lo(const void *x, const void *y)
+{
+	int a = ((const struct agg_block*) x)->lo;
+	int b = ((const struct agg_block*) y)->lo;
+
+	return (a > b) - (a < b);
+}
+
+// function : agg_add()
+// description : Add one value to a group.
+//---------------------------------------------------------------------
+
+static inline void agg_add(struct agg_group *g, int val)
+{
+	g->count++;
+	g->sum += val;
+	g->min  = (val < g->min) ? val : g->min;
+	g->max  = (val > g->max) ? val : g->max;
+}
+
+// function : agg_fold()
+// description : Add the partial group h to g (same key).
+//---------------------------------------------------------------------
+
+static void agg_fold(struct agg_group *g, const struct agg_group *h)
+{
+	g->count += h->count;
+	g->sum   += h->sum;
+	g->min    = (h->min < g->min) ? h->min : g->min;
+	g->max    = (h->max > g->max) ? h->max : g->max;
+}
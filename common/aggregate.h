@@ -0,0 +1,57 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+// Parallel operators on sorted keys (OpenMP): the usual next step after
+// a sort. Each thread finds the group boundaries (v[i] != v[i-1]) in an
+// equal share of the keys, the counts are prefix summed, and every
+// thread writes its groups at its offset. They return the number of
+// groups written, or -1 if out of memory; the outputs must have room
+// for n groups.
+//
+// agg_sort_rle() sorts v and run-length encodes it in one go: each
+// block of the engine's last merge level is encoded as soon as it is
+// final, while it is still in cache (engine_sort_visit), and only the
+// encoded runs are moved afterwards.
+//===========================================================
+
+struct agg_group {
+
+	int       key;
+	int       count;
+	long long sum;
+	int       min;
+	int       max;
+}; // one group of agg_group_by()
+
+int agg_unique_count(const int *v, int n, int nthreads);
+int agg_unique      (const int *v, int n, int *keys, int nthreads);
+int agg_rle         (const int *v, int n, int *keys, int *counts, int nthreads);
+
+// keys sorted, vals[i] the payload of keys[i]
+int agg_group_by    (const int *keys, const int *vals, int n, struct agg_group *out, int nthreads);
+
+// sort, then agg_rle() (agg_unique() if counts is NULL)
+int agg_sort_rle    (int *v, int n, int dir, int *keys, int *counts, int nthreads);
+
+#endif
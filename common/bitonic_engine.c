@@ -0,0 +1,325 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#include "bitonic_engine.h"
+#include "bitonic_kernels.h"
+#include "sort_dispatch.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int engine_min_leaf = 1<<12; //smallest leaf given to qsort
+
+struct engine_args {
+
+	int              *v;
+	struct kernel_kv *kv;    //key-value records instead of v (engine_sort_kv)
+	int               n;
+	int               leaf;  //leaves of at most this size are sorted with qsort
+	int               grain; //merges/compare loops above this size become tasks
+	engine_visit      visit; //called on every final block (engine_sort_visit)
+	void             *arg;
+}; // state shared by one engine_sort call
+
+
+// Function Declaration
+//===========================================================
+
+static void engine_rec_sort(struct engine_args*, int, int, int);
+static void engine_merge   (struct engine_args*, int, int, int, int);
+static int  engine_pow2_below(int);
+static void engine_leaf    (struct engine_args*, int, int, int);
+static void engine_range   (struct engine_args*, int, int, int, int);
+
+
+// Function Definition
+//===========================================================
+
+// function : engine_sort()
+// description : Sort v[0..n) in direction dir with up to nthreads
+//               OpenMP threads. n may be any positive number: the
+//               recursion splits at n/2 and the merge at the greatest
+//               power of two below the length (H.W. Lang's variant).
+//---------------------------------------------------------------------
+
+void engine_sort(int *v, int n, int dir, int nthreads)
+{
+	engine_sort_visit(v, n, dir, nthreads, NULL, NULL);
+}
+
+// function : engine_sort_visit()
+// description : engine_sort() that hands v[lo..lo+cnt) to visit as
+//               soon as that block is final, while it is still in the
+//               cache of the thread that merged it. The blocks cover
+//               v[0..n) once each, in no particular order, and may be
+//               visited while other blocks are still being merged.
+//---------------------------------------------------------------------
+
+void engine_sort_visit(int *v, int n, int dir, int nthreads, engine_visit visit, void *arg)
+{
+	struct engine_args args;
+
+	if (n < 2) {
+		if (visit && n == 1)
+			visit(v, 0, 1, arg);
+		return;
+	}
+
+	// small sorts run inline on the calling thread, mid sizes on fewer
+	// threads (common/sort_dispatch.c)
+	struct dispatch_plan plan = dispatch_plan(n, DISPATCH_KEY_INT, DISPATCH_LEAF_QSORT, nthreads);
+
+	if (plan.path == DISPATCH_SERIAL) {
+
+		if ((n & (n - 1)) == 0)
+			kernel_sort(v, n, dir);
+		else
+			qsort(v, n, sizeof(int), dir == ENGINE_ASCENDING ? engine_cmp_asc : engine_cmp_des);
+		if (visit)
+			visit(v, 0, n, arg);
+		return;
+	}
+	nthreads = plan.threads;
+
+	// a few leaves per thread so that the tasks balance
+	args.v     = v;
+	args.kv    = NULL;
+	args.n     = n;
+	args.visit = visit;
+	args.arg   = arg;
+	args.leaf  = n / (4 * nthreads);
+	if (args.leaf < engine_min_leaf)
+		args.leaf = engine_min_leaf;
+	args.grain = args.leaf;
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+	#pragma omp single nowait
+	engine_rec_sort(&args, 0, n, dir);
+}
+
+// function : engine_sort_kv()
+// description : engine_sort() on key-value records, ordered by key and
+//               then by val (common/bitonic_kernels.h).
+//---------------------------------------------------------------------
+
+void engine_sort_kv(struct kernel_kv *v, int n, int dir, int nthreads)
+{
+	struct engine_args args;
+
+	if (n < 2)
+		return;
+
+	struct dispatch_plan plan = dispatch_plan(n, DISPATCH_KEY_KV, DISPATCH_LEAF_QSORT, nthreads);
+
+	if (plan.path == DISPATCH_SERIAL) {
+
+		if ((n & (n - 1)) == 0)
+			kernel_sort_kv(v, n, dir);
+		else
+			qsort(v, n, sizeof(struct kernel_kv),
+			      dir == ENGINE_ASCENDING ? engine_cmp_kv_asc : engine_cmp_kv_des);
+		return;
+	}
+	nthreads = plan.threads;
+
+	args.v     = NULL;
+	args.kv    = v;
+	args.n     = n;
+	args.visit = NULL;
+	args.arg   = NULL;
+	args.leaf  = n / (4 * nthreads);
+	if (args.leaf < engine_min_leaf)
+		args.leaf = engine_min_leaf;
+	args.grain = args.leaf;
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+	#pragma omp single nowait
+	engine_rec_sort(&args, 0, n, dir);
+}
+
+// function : engine_rec_sort()
+// description : The recursive bitonic sort; first half in the opposite
+//               direction, second half in dir, then merge.
+//---------------------------------------------------------------------
+
+static void engine_rec_sort(struct engine_args *args, int lo, int cnt, int dir)
+{
+	if (cnt <= args->leaf) {
+		engine_leaf(args, lo, cnt, dir);
+		if (args->visit && cnt == args->n)
+			args->visit(args->v, lo, cnt, args->arg);
+		return;
+	}
+
+	int m = cnt / 2;
+
+	#pragma omp task
+	engine_rec_sort(args, lo, m, !dir);
+
+	engine_rec_sort(args, lo+m, cnt-m, dir);
+
+	#pragma omp taskwait
+
+	engine_merge(args, lo, cnt, dir, cnt == args->n);
+}
+
+// function : engine_merge()
+// description : Bitonic merge of v[lo..lo+cnt). Power of two tails go to
+//               the unrolled networks, large compare loops are split in
+//               grain sized tasks. In the final merge (fin), the blocks
+//               merged on one thread are handed to args->visit.
+//---------------------------------------------------------------------
+
+static void engine_merge(struct engine_args *args, int lo, int cnt, int dir, int fin)
+{
+	if (cnt < 2)
+		return;
+
+	if (cnt <= KERNEL_MAX_CNT && (cnt & (cnt-1)) == 0) {
+
+		if (args->kv)
+			kernel_merge_small_kv(args->kv+lo, cnt, dir);
+		else
+			kernel_merge_small(args->v+lo, cnt, dir);
+		if (fin && args->visit)
+			args->visit(args->v, lo, cnt, args->arg);
+		return;
+	}
+
+	int m   = engine_pow2_below(cnt);
+	int len = cnt - m; // number of compare-exchanges at this level
+
+	if (len > args->grain) {
+
+		int c;
+		for (c = 0; c < len; c += args->grain) {
+
+			int chunk = (len - c < args->grain) ? len - c : args->grain;
+
+			#pragma omp task firstprivate(c,chunk)
+			engine_range(args, lo+c, chunk, m, dir);
+		}
+		#pragma omp taskwait
+
+		#pragma omp task
+		engine_merge(args, lo, m, dir, fin);
+
+		engine_merge(args, lo+m, len, dir, fin);
+
+		#pragma omp taskwait
+	}
+	else {
+
+		engine_range(args, lo, len, m, dir);
+
+		engine_merge(args, lo,   m,   dir, 0);
+		engine_merge(args, lo+m, len, dir, 0);
+
+		if (fin && args->visit)
+			args->visit(args->v, lo, cnt, args->arg);
+	}
+}
+
+// function : engine_pow2_below()
+// description : Greatest power of two strictly less than n (n >= 2).
+//---------------------------------------------------------------------
+
+static int engine_pow2_below(int n)
+{
+	int k = 1;
+	while (k < n - k)
+		k <<= 1;
+	return k;
+}
+
+// function : engine_leaf()
+// description : Sort a leaf v[lo..lo+cnt) with qsort.
+//---------------------------------------------------------------------
+
+static void engine_leaf(struct engine_args *args, int lo, int cnt, int dir)
+{
+	if (args->kv)
+		qsort(args->kv+lo, cnt, sizeof(struct kernel_kv),
+		      dir == ENGINE_ASCENDING ? engine_cmp_kv_asc : engine_cmp_kv_des);
+	else
+		qsort(args->v+lo, cnt, sizeof(int),
+		      dir == ENGINE_ASCENDING ? engine_cmp_asc : engine_cmp_des);
+}
+
+// function : engine_range()
+// description : Compare v[lo+i] with v[lo+i+dist] for i in [0,cnt).
+//---------------------------------------------------------------------
+
+static void engine_range(struct engine_args *args, int lo, int cnt, int dist, int dir)
+{
+	if (args->kv)
+		kernel_compare_range_kv(args->kv+lo, cnt, dist, dir);
+	else
+		kernel_compare_range(args->v+lo, cnt, dist, dir);
+}
+
+// function : engine_cmp_asc()
+// description : qsort comparator, ascending (no overflow on wide keys).
+//---------------------------------------------------------------------
+
+int engine_cmp_asc(const void *x, const void *y)
+{
+	int a = *(const int*) x;
+	int b = *(const int*) y;
+
+	return (a > b) - (a < b);
+}
+
+// function : engine_cmp_des()
+// description : qsort comparator, descending.
+//---------------------------------------------------------------------
+
+int engine_cmp_des(const void *x, const void *y)
+{
+	return engine_cmp_asc(y, x);
+}
+
+// function : engine_cmp_kv_asc()
+// description : qsort comparator of key-value records, ascending.
+//---------------------------------------------------------------------
+
+int engine_cmp_kv_asc(const void *x, const void *y)
+{
+	const struct kernel_kv *a = (const struct kernel_kv*) x;
+	const struct kernel_kv *b = (const struct kernel_kv*) y;
+
+	if (a->key != b->key)
+		return (a->key > b->key) - (a->key < b->key);
+	return (a->val > b->val) - (a->val < b->val);
+}
+
+// function : engine_cmp_kv_des()
+// description : qsort comparator of key-value records, descending.
+//---------------------------------------------------------------------
+
+int engine_cmp_kv_des(const void *x, const void *y)
+{
+	return engine_cmp_kv_asc(y, x);
+}
@@ -0,0 +1,50 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#ifndef BITONIC_ENGINE_H
+#define BITONIC_ENGINE_H
+
+// Parallel bitonic sort of an arbitrary int array (OpenMP tasks).
+// Unlike the drivers it takes the array as an argument and n does not
+// have to be a power of two.
+//===========================================================
+
+#define ENGINE_ASCENDING  1
+#define ENGINE_DESCENDING 0
+
+struct kernel_kv;
+
+// engine_sort_visit() callback, called on each final block v[lo..lo+cnt)
+typedef void (*engine_visit)(const int *v, int lo, int cnt, void *arg);
+
+void engine_sort  (int *v, int n, int dir, int nthreads);
+int  engine_cmp_asc(const void*, const void*);
+int  engine_cmp_des(const void*, const void*);
+
+// engine_sort() that hands every block to visit as soon as it is final,
+// so a pass over the sorted keys can run while they are still in cache
+void engine_sort_visit(int *v, int n, int dir, int nthreads, engine_visit visit, void *arg);
+
+// the same sort on key-value records (common/bitonic_kernels.h)
+void engine_sort_kv   (struct kernel_kv *v, int n, int dir, int nthreads);
+int  engine_cmp_kv_asc(const void*, const void*);
+int  engine_cmp_kv_des(const void*, const void*);
+
+#endif
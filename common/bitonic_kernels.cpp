@@ -0,0 +1,490 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#include <stdint.h>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "bitonic_kernels.h"
+#include "bitonic_kernels.hpp"
+
+
+// Constants & Variables
+//===========================================================
+
+const int kernel_prefetch = 1024; //keys ahead for the stream prefetches (4 KB)
+
+
+// Function Declaration
+//===========================================================
+
+template <bool Asc> static void stream_range(const int*, int*, int, int);
+
+// the order of the key-value records, used by the templates through
+// cmp_xchg()
+static inline bool operator<(const kernel_kv &x, const kernel_kv &y)
+{
+	return x.key < y.key || (x.key == y.key && x.val < y.val);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : kernel_compare_level()
+// description : Compare v[i] with v[i+k] for i in [0,k). The direction
+//               is resolved once, the loop itself is branch free.
+//---------------------------------------------------------------------
+
+void kernel_compare_level(int *v, int k, int dir)
+{
+	if (dir) {
+		bitonic::compare_level<int, true>(v, k);
+	}
+	else {
+		bitonic::compare_level<int, false>(v, k);
+	}
+}
+
+// function : kernel_compare_range()
+// description : Compare v[i] with v[i+dist] for i in [0,cnt). Used when
+//               a level is split between several threads.
+//---------------------------------------------------------------------
+
+void kernel_compare_range(int *v, int cnt, int dist, int dir)
+{
+	if (dir) {
+		bitonic::compare_range<int, true>(v, cnt, dist);
+	}
+	else {
+		bitonic::compare_range<int, false>(v, cnt, dist);
+	}
+}
+
+// function : kernel_compare_flip()
+// description : Compare v[i] with w[-i] for i in [0,cnt), the first
+//               level of a merge whose halves are sorted the same way.
+//---------------------------------------------------------------------
+
+void kernel_compare_flip(int *v, int *w, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::compare_flip<int, true>(v, w, cnt);
+	}
+	else {
+		bitonic::compare_flip<int, false>(v, w, cnt);
+	}
+}
+
+// function : kernel_merge_small()
+// description : Merge a bitonic sequence of cnt <= KERNEL_MAX_CNT
+//               elements with an unrolled network.
+//---------------------------------------------------------------------
+
+void kernel_merge_small(int *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::merge_small<int, true>(v, cnt);
+	}
+	else {
+		bitonic::merge_small<int, false>(v, cnt);
+	}
+}
+
+// function : kernel_sort_small()
+// description : Sort cnt <= KERNEL_MAX_CNT elements with an unrolled
+//               network.
+//---------------------------------------------------------------------
+
+void kernel_sort_small(int *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::sort_small<int, true>(v, cnt);
+	}
+	else {
+		bitonic::sort_small<int, false>(v, cnt);
+	}
+}
+
+// function : kernel_merge()
+// description : Bitonic merge of cnt elements (any power of two) on one
+//               thread, depth first.
+//---------------------------------------------------------------------
+
+void kernel_merge(int *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::merge<int, true>(v, cnt);
+	}
+	else {
+		bitonic::merge<int, false>(v, cnt);
+	}
+}
+
+// function : kernel_sort()
+// description : Sort cnt elements (any power of two) on one thread
+//               with the vectorized levels and networks, no qsort.
+//---------------------------------------------------------------------
+
+void kernel_sort(int *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::sort<int, true>(v, cnt);
+	}
+	else {
+		bitonic::sort<int, false>(v, cnt);
+	}
+}
+
+// function : kernel_compare_range_kv()
+// description : kernel_compare_range() on key-value records.
+//---------------------------------------------------------------------
+
+void kernel_compare_range_kv(kernel_kv *v, int cnt, int dist, int dir)
+{
+	if (dir) {
+		bitonic::compare_range<kernel_kv, true>(v, cnt, dist);
+	}
+	else {
+		bitonic::compare_range<kernel_kv, false>(v, cnt, dist);
+	}
+}
+
+// function : kernel_merge_small_kv()
+// description : kernel_merge_small() on key-value records.
+//---------------------------------------------------------------------
+
+void kernel_merge_small_kv(kernel_kv *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::merge_small<kernel_kv, true>(v, cnt);
+	}
+	else {
+		bitonic::merge_small<kernel_kv, false>(v, cnt);
+	}
+}
+
+// function : kernel_sort_kv()
+// description : kernel_sort() on key-value records (cnt a power of
+//               two, one thread).
+//---------------------------------------------------------------------
+
+void kernel_sort_kv(kernel_kv *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::sort<kernel_kv, true>(v, cnt);
+	}
+	else {
+		bitonic::sort<kernel_kv, false>(v, cnt);
+	}
+}
+
+// function : kernel_compare_range_u16()
+// description : kernel_compare_range() on 16-bit keys.
+//---------------------------------------------------------------------
+
+void kernel_compare_range_u16(unsigned short *v, int cnt, int dist, int dir)
+{
+	if (dir) {
+		bitonic::compare_range<unsigned short, true>(v, cnt, dist);
+	}
+	else {
+		bitonic::compare_range<unsigned short, false>(v, cnt, dist);
+	}
+}
+
+// function : kernel_merge_u16()
+// description : kernel_merge() on 16-bit keys.
+//---------------------------------------------------------------------
+
+void kernel_merge_u16(unsigned short *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::merge<unsigned short, true>(v, cnt);
+	}
+	else {
+		bitonic::merge<unsigned short, false>(v, cnt);
+	}
+}
+
+// function : kernel_sort_u16()
+// description : kernel_sort() on 16-bit keys.
+//---------------------------------------------------------------------
+
+void kernel_sort_u16(unsigned short *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::sort<unsigned short, true>(v, cnt);
+	}
+	else {
+		bitonic::sort<unsigned short, false>(v, cnt);
+	}
+}
+
+// function : kernel_oddeven_merge()
+// description : Odd-even merge of two halves of cnt elements (power of
+//               two), both already sorted in direction dir.
+//---------------------------------------------------------------------
+
+void kernel_oddeven_merge(int *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::oddeven_merge<int, true>(v, cnt);
+	}
+	else {
+		bitonic::oddeven_merge<int, false>(v, cnt);
+	}
+}
+
+// function : kernel_oddeven_level()
+// description : Pairs [p0,p1) of the level at distance k of the
+//               odd-even merge of v[0..cnt), for merges split between
+//               threads (kernel_oddeven_pairs() of them in all).
+//---------------------------------------------------------------------
+
+void kernel_oddeven_level(int *v, int cnt, int k, int p0, int p1, int dir)
+{
+	if (dir) {
+		bitonic::oddeven_level<int, true>(v, cnt, k, p0, p1);
+	}
+	else {
+		bitonic::oddeven_level<int, false>(v, cnt, k, p0, p1);
+	}
+}
+
+// function : kernel_oddeven_pairs()
+// description : Pairs of the level at distance k of an odd-even merge
+//               of cnt elements: k at the first level, then cnt/2 - k.
+//---------------------------------------------------------------------
+
+int kernel_oddeven_pairs(int cnt, int k)
+{
+	return (2 * k == cnt) ? k : cnt / 2 - k;
+}
+
+// function : kernel_oddeven_sort_small()
+// description : Sort cnt <= KERNEL_MAX_CNT elements with an unrolled
+//               odd-even merge sort network.
+//---------------------------------------------------------------------
+
+void kernel_oddeven_sort_small(int *v, int cnt, int dir)
+{
+	if (dir) {
+		bitonic::oddeven_sort_small<int, true>(v, cnt);
+	}
+	else {
+		bitonic::oddeven_sort_small<int, false>(v, cnt);
+	}
+}
+
+// function : kernel_merge_comparators()
+// description : Comparators in the merge network of cnt elements.
+//---------------------------------------------------------------------
+
+long long kernel_merge_comparators(int cnt, int oddeven)
+{
+	return oddeven ? bitonic::oddeven_merge_size(cnt) : bitonic::bitonic_merge_size(cnt);
+}
+
+// function : kernel_sort_comparators()
+// description : Comparators in the sorting network of cnt elements.
+//---------------------------------------------------------------------
+
+long long kernel_sort_comparators(int cnt, int oddeven)
+{
+	return oddeven ? bitonic::oddeven_sort_size(cnt) : bitonic::bitonic_sort_size(cnt);
+}
+
+// function : kernel_stream_nt()
+// description : 1 if kernel_stream_range() was compiled with
+//               non-temporal stores, 0 if it does plain stores.
+//---------------------------------------------------------------------
+
+int kernel_stream_nt(void)
+{
+#if defined(__SSE2__)
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+// function : kernel_isa()
+// description : Vector extension the kernels were compiled for.
+//---------------------------------------------------------------------
+
+const char* kernel_isa(void)
+{
+#if defined(__AVX512F__)
+	return "avx512";
+#elif defined(__AVX2__)
+	return "avx2";
+#elif defined(__SSE4_1__)
+	return "sse4.1";
+#elif defined(__SSE2__)
+	return "sse2";
+#elif defined(__ARM_NEON)
+	return "neon";
+#else
+	return "generic";
+#endif
+}
+
+// function : kernel_compare_copy()
+// description : One level out of place, through the cache: pairs
+//               (src[i],src[i+dist]) for i in [0,cnt) go in order to
+//               dst[i] and dst[i+dist].
+//---------------------------------------------------------------------
+
+void kernel_compare_copy(const int *src, int *dst, int cnt, int dist, int dir)
+{
+	if (dir) {
+		bitonic::compare_copy<int, true>(src, dst, cnt, dist);
+	}
+	else {
+		bitonic::compare_copy<int, false>(src, dst, cnt, dist);
+	}
+}
+
+// function : kernel_stream_range()
+// description : kernel_compare_copy() for levels that do not fit in the
+//               cache: dst is written with non-temporal stores, so it
+//               is not read into the cache first and does not evict the
+//               inputs, and both input streams are prefetched.
+//---------------------------------------------------------------------
+
+void kernel_stream_range(const int *src, int *dst, int cnt, int dist, int dir)
+{
+	if (dir) {
+		stream_range<true>(src, dst, cnt, dist);
+	}
+	else {
+		stream_range<false>(src, dst, cnt, dist);
+	}
+}
+
+// function : stream_range()
+// description : The loop of kernel_stream_range(). A scalar head aligns
+//               dst (dst+dist has the same alignment, dist being a large
+//               power of two), then 16 keys (one cache line) per stream
+//               and step. The prefetch distance is kernel_prefetch keys,
+//               but never more than dist, so that the first stream does
+//               not prefetch what the second one is reading. SSE2 has
+//               no min/max on 32-bit ints, they are built from a compare
+//               mask. Without SSE2 the stores are plain stores.
+//---------------------------------------------------------------------
+
+template <bool Asc>
+static void stream_range(const int *src, int *dst, int cnt, int dist)
+{
+	const int *s2 = src + dist;
+	int       *d2 = dst + dist;
+	int        pf = (dist < kernel_prefetch) ? dist : kernel_prefetch;
+	int        i  = 0;
+
+	while (i < cnt && ((uintptr_t) (dst + i) & 63) != 0) {
+		int x = src[i], y = s2[i];
+		bitonic::cmp_xchg<int, Asc>(x, y);
+		dst[i] = x;
+		d2[i]  = y;
+		i++;
+	}
+
+#if defined(__AVX2__)
+	for (; i + 16 <= cnt; i += 16) {
+
+		__builtin_prefetch(src + i + pf, 0, 0);
+		__builtin_prefetch(s2  + i + pf, 0, 0);
+
+		__m256i x0 = _mm256_loadu_si256((const __m256i*) (src + i));
+		__m256i x1 = _mm256_loadu_si256((const __m256i*) (src + i + 8));
+		__m256i y0 = _mm256_loadu_si256((const __m256i*) (s2 + i));
+		__m256i y1 = _mm256_loadu_si256((const __m256i*) (s2 + i + 8));
+
+		__m256i lo0 = _mm256_min_epi32(x0, y0), hi0 = _mm256_max_epi32(x0, y0);
+		__m256i lo1 = _mm256_min_epi32(x1, y1), hi1 = _mm256_max_epi32(x1, y1);
+
+		_mm256_stream_si256((__m256i*) (dst + i),     Asc ? lo0 : hi0);
+		_mm256_stream_si256((__m256i*) (dst + i + 8), Asc ? lo1 : hi1);
+		_mm256_stream_si256((__m256i*) (d2 + i),      Asc ? hi0 : lo0);
+		_mm256_stream_si256((__m256i*) (d2 + i + 8),  Asc ? hi1 : lo1);
+	}
+	_mm_sfence();
+#elif defined(__SSE4_1__)
+	for (; i + 16 <= cnt; i += 16) {
+
+		__builtin_prefetch(src + i + pf, 0, 0);
+		__builtin_prefetch(s2  + i + pf, 0, 0);
+
+		for (int j = 0; j < 16; j += 4) {
+
+			__m128i x  = _mm_loadu_si128((const __m128i*) (src + i + j));
+			__m128i y  = _mm_loadu_si128((const __m128i*) (s2 + i + j));
+			__m128i lo = _mm_min_epi32(x, y), hi = _mm_max_epi32(x, y);
+
+			_mm_stream_si128((__m128i*) (dst + i + j), Asc ? lo : hi);
+			_mm_stream_si128((__m128i*) (d2 + i + j),  Asc ? hi : lo);
+		}
+	}
+	_mm_sfence();
+#elif defined(__SSE2__)
+	for (; i + 16 <= cnt; i += 16) {
+
+		__builtin_prefetch(src + i + pf, 0, 0);
+		__builtin_prefetch(s2  + i + pf, 0, 0);
+
+		for (int j = 0; j < 16; j += 4) {
+
+			__m128i x  = _mm_loadu_si128((const __m128i*) (src + i + j));
+			__m128i y  = _mm_loadu_si128((const __m128i*) (s2 + i + j));
+			__m128i gt = _mm_cmpgt_epi32(x, y);
+			__m128i lo = _mm_or_si128(_mm_and_si128(gt, y), _mm_andnot_si128(gt, x));
+			__m128i hi = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, y));
+
+			_mm_stream_si128((__m128i*) (dst + i + j), Asc ? lo : hi);
+			_mm_stream_si128((__m128i*) (d2 + i + j),  Asc ? hi : lo);
+		}
+	}
+	_mm_sfence();
+#else
+	for (; i + 16 <= cnt; i += 16) {
+
+		__builtin_prefetch(src + i + pf, 0, 0);
+		__builtin_prefetch(s2  + i + pf, 0, 0);
+
+		for (int j = i; j < i + 16; j++) {
+			int x = src[j], y = s2[j];
+			bitonic::cmp_xchg<int, Asc>(x, y);
+			dst[j] = x;
+			d2[j]  = y;
+		}
+	}
+#endif
+
+	for (; i < cnt; i++) {
+		int x = src[i], y = s2[i];
+		bitonic::cmp_xchg<int, Asc>(x, y);
+		dst[i] = x;
+		d2[i]  = y;
+	}
+}
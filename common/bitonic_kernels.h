@@ -0,0 +1,86 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#ifndef BITONIC_KERNELS_H
+#define BITONIC_KERNELS_H
+
+// C entry points of the template core (bitonic_kernels.hpp).
+// dir follows the drivers: 1 = ascending, 0 = descending.
+//===========================================================
+
+#define KERNEL_MAX_CNT 64 //largest unrolled network
+
+// key + payload record of the key-value sorts, ordered by key and then
+// by val, so records with equal keys keep the order of their payloads
+struct kernel_kv {
+
+	unsigned long long key;
+	unsigned int       val;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void kernel_compare_level(int *v, int k,   int dir);
+void kernel_compare_range(int *v, int cnt, int dist, int dir);
+void kernel_compare_flip (int *v, int *w,  int cnt,  int dir); //v[i] with w[-i]
+void kernel_merge_small  (int *v, int cnt, int dir);
+void kernel_sort_small   (int *v, int cnt, int dir);
+void kernel_merge        (int *v, int cnt, int dir); //one thread, cnt a power of two
+void kernel_sort         (int *v, int cnt, int dir); //one thread, cnt a power of two
+
+// out of place levels (src and dst do not overlap); the stream version
+// prefetches both inputs and writes dst with non-temporal stores
+void kernel_compare_copy (const int *src, int *dst, int cnt, int dist, int dir);
+void kernel_stream_range (const int *src, int *dst, int cnt, int dist, int dir);
+int  kernel_stream_nt    (void); //0: this build has no non-temporal stores
+
+// the same levels and networks on key-value records
+void kernel_compare_range_kv(struct kernel_kv *v, int cnt, int dist, int dir);
+void kernel_merge_small_kv  (struct kernel_kv *v, int cnt, int dir);
+void kernel_sort_kv         (struct kernel_kv *v, int cnt, int dir); //one thread, cnt a power of two
+
+// the same on keys packed into 16 bits (twice the keys per vector)
+void kernel_compare_range_u16(unsigned short *v, int cnt, int dist, int dir);
+void kernel_merge_u16        (unsigned short *v, int cnt, int dir); //one thread, cnt a power of two
+void kernel_sort_u16         (unsigned short *v, int cnt, int dir); //one thread, cnt a power of two
+
+// Batcher's odd-even merge sort: both halves sorted in dir
+void kernel_oddeven_merge     (int *v, int cnt, int dir);
+void kernel_oddeven_sort_small(int *v, int cnt, int dir);
+
+// one level of kernel_oddeven_merge() (k = cnt/2, cnt/4, ..., 1), or
+// the pairs [p0,p1) of it, so that a level can be cut between threads
+void kernel_oddeven_level     (int *v, int cnt, int k, int p0, int p1, int dir);
+int  kernel_oddeven_pairs     (int cnt, int k);
+
+// comparators of a merge/sort network of cnt elements
+long long kernel_merge_comparators(int cnt, int oddeven);
+long long kernel_sort_comparators (int cnt, int oddeven);
+
+// vector extension the kernels were compiled for ("avx2", ...)
+const char* kernel_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,481 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#ifndef BITONIC_KERNELS_HPP
+#define BITONIC_KERNELS_HPP
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+
+// Template core of the bitonic sorter.
+//
+// The sort direction, the key type and the size of the small networks
+// are template parameters, so the innermost loops contain no branch on
+// the direction and the small merge/sort tails are straight-line code.
+//===========================================================
+
+namespace bitonic {
+
+// maximum size of the fully unrolled networks
+constexpr int MAX_NETWORK = 64;
+
+// one compare-exchange element of a network
+struct comparator {
+
+	int i;
+	int j;
+};
+
+constexpr int ilog2(int n)
+{
+	return (n <= 1) ? 0 : 1 + ilog2(n / 2);
+}
+
+// comparators of the networks for N = 2^k elements
+constexpr long long bitonic_merge_size(long long n)
+{
+	return (n / 2) * ilog2((int) n);
+}
+
+constexpr long long bitonic_sort_size(long long n)
+{
+	return (n / 2) * ilog2((int) n) * (ilog2((int) n) + 1) / 2;
+}
+
+constexpr long long oddeven_merge_size(long long n)
+{
+	return (n < 2) ? 0 : (ilog2((int) n) - 1) * (n / 2) + 1;
+}
+
+constexpr long long oddeven_sort_size(long long n)
+{
+	return (n < 2) ? 0 : (ilog2((int) n) * ilog2((int) n) - ilog2((int) n) + 4) * n / 4 - 1;
+}
+
+
+// Compare-Exchange
+//===========================================================
+
+// function : cmp_xchg()
+// description : Put the pair (x,y) in the order given by Asc. Written
+//               as a min/max pair so that it compiles to conditional
+//               moves (scalar) or min/max instructions (vectorized).
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void cmp_xchg(T &x, T &y)
+{
+	T lo = (y < x) ? y : x;
+	T hi = (y < x) ? x : y;
+
+	x = Asc ? lo : hi;
+	y = Asc ? hi : lo;
+}
+
+// function : compare_range()
+// description : Compare v[i] with v[i+dist] for every i in [0,cnt).
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void compare_range(T *v, int cnt, int dist)
+{
+	T *w = v + dist;
+	for (int i = 0; i < cnt; i++) {
+		cmp_xchg<T, Asc>(v[i], w[i]);
+	}
+}
+
+// function : compare_flip()
+// description : Compare v[i] with w[-i] for every i in [0,cnt): the
+//               first step of a merge of two sequences sorted the same
+//               way, one of them read backwards.
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void compare_flip(T *v, T *w, int cnt)
+{
+	for (int i = 0; i < cnt; i++) {
+		cmp_xchg<T, Asc>(v[i], w[-i]);
+	}
+}
+
+// function : compare_copy()
+// description : compare_range() out of place: the pairs (src[i],
+//               src[i+dist]) are written in order to dst[i] and
+//               dst[i+dist].
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void compare_copy(const T *src, T *dst, int cnt, int dist)
+{
+	for (int i = 0; i < cnt; i++) {
+		T x = src[i];
+		T y = src[i + dist];
+		cmp_xchg<T, Asc>(x, y);
+		dst[i]        = x;
+		dst[i + dist] = y;
+	}
+}
+
+// function : compare_level()
+// description : One level of the bitonic merge, i.e. compare v[i] with
+//               v[i+k] for every i in [0,k).
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void compare_level(T *v, int k)
+{
+	compare_range<T, Asc>(v, k, k);
+}
+
+
+// Network Generation (compile time)
+//===========================================================
+
+// function : make_merge_network()
+// description : The half-cleaner cascade that merges a bitonic sequence
+//               of N elements.
+//---------------------------------------------------------------------
+
+template <int N>
+constexpr std::array<comparator, (N / 2) * ilog2(N)> make_merge_network()
+{
+	std::array<comparator, (N / 2) * ilog2(N)> net{};
+
+	int c = 0;
+	for (int j = N / 2; j > 0; j /= 2) {
+		for (int i = 0; i < N; i++) {
+			if ((i & j) == 0) {
+				net[c++] = comparator{i, i + j};
+			}
+		}
+	}
+
+	return net;
+}
+
+// function : make_sort_network()
+// description : A bitonic sorting network of N elements where every
+//               comparator has the same direction. The first step of
+//               each stage compares i with its mirror inside the block
+//               instead of sorting the two halves in opposite order.
+//---------------------------------------------------------------------
+
+template <int N>
+constexpr std::array<comparator, (N / 2) * ilog2(N) * (ilog2(N) + 1) / 2>
+make_sort_network()
+{
+	std::array<comparator, (N / 2) * ilog2(N) * (ilog2(N) + 1) / 2> net{};
+
+	int c = 0;
+	for (int k = 2; k <= N; k *= 2) {
+
+		// flip step
+		for (int i = 0; i < N; i++) {
+			int m = i ^ (k - 1);
+			if (m > i) {
+				net[c++] = comparator{i, m};
+			}
+		}
+
+		// half-cleaners
+		for (int j = k / 4; j > 0; j /= 2) {
+			for (int i = 0; i < N; i++) {
+				if ((i & j) == 0) {
+					net[c++] = comparator{i, i + j};
+				}
+			}
+		}
+	}
+
+	return net;
+}
+
+// function : make_oddeven_network()
+// description : Batcher's odd-even merge sort of N elements, or only its
+//               last merge (two sorted halves) when MergeOnly. In merge
+//               p the pairs at distance k < p are taken from the odd
+//               positions of each 2k group, as long as both ends lie in
+//               the same 2p block.
+//---------------------------------------------------------------------
+
+template <int N, bool MergeOnly>
+constexpr std::array<comparator, MergeOnly ? oddeven_merge_size(N) : oddeven_sort_size(N)>
+make_oddeven_network()
+{
+	std::array<comparator, MergeOnly ? oddeven_merge_size(N) : oddeven_sort_size(N)> net{};
+
+	int c = 0;
+	for (int p = MergeOnly ? N / 2 : 1; p < N; p *= 2) {
+		for (int k = p; k >= 1; k /= 2) {
+			for (int j = k % p; j + k < N; j += 2 * k) {
+				for (int i = 0; i < k && i + j + k < N; i++) {
+					if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+						net[c++] = comparator{i + j, i + j + k};
+					}
+				}
+			}
+		}
+	}
+
+	return net;
+}
+
+template <int N>
+struct merge_network {
+
+	static constexpr auto table = make_merge_network<N>();
+};
+
+template <int N>
+struct sort_network {
+
+	static constexpr auto table = make_sort_network<N>();
+};
+
+template <int N>
+struct oddeven_merge_network {
+
+	static constexpr auto table = make_oddeven_network<N, true>();
+};
+
+template <int N>
+struct oddeven_sort_network {
+
+	static constexpr auto table = make_oddeven_network<N, false>();
+};
+
+
+// Network Execution (fully unrolled)
+//===========================================================
+
+template <typename Net, typename T, bool Asc, std::size_t... I>
+inline void run_network(T *v, std::index_sequence<I...>)
+{
+	(cmp_xchg<T, Asc>(v[Net::table[I].i], v[Net::table[I].j]), ...);
+}
+
+template <typename T, bool Asc, int N>
+inline void merge_small(T *v)
+{
+	run_network<merge_network<N>, T, Asc>(v,
+		std::make_index_sequence<merge_network<N>::table.size()>{});
+}
+
+template <typename T, bool Asc, int N>
+inline void sort_small(T *v)
+{
+	run_network<sort_network<N>, T, Asc>(v,
+		std::make_index_sequence<sort_network<N>::table.size()>{});
+}
+
+template <typename T, bool Asc, int N>
+inline void oddeven_merge_small(T *v)
+{
+	run_network<oddeven_merge_network<N>, T, Asc>(v,
+		std::make_index_sequence<oddeven_merge_network<N>::table.size()>{});
+}
+
+template <typename T, bool Asc, int N>
+inline void oddeven_sort_small(T *v)
+{
+	run_network<oddeven_sort_network<N>, T, Asc>(v,
+		std::make_index_sequence<oddeven_sort_network<N>::table.size()>{});
+}
+
+
+// Runtime Dispatch (once per call)
+//===========================================================
+
+// function : merge_small()
+// description : Pick the unrolled merge network for cnt (power of two,
+//               cnt <= MAX_NETWORK).
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void merge_small(T *v, int cnt)
+{
+	switch (cnt) {
+		case  2: merge_small<T, Asc,  2>(v); break;
+		case  4: merge_small<T, Asc,  4>(v); break;
+		case  8: merge_small<T, Asc,  8>(v); break;
+		case 16: merge_small<T, Asc, 16>(v); break;
+		case 32: merge_small<T, Asc, 32>(v); break;
+		case 64: merge_small<T, Asc, 64>(v); break;
+		default: break;
+	}
+}
+
+// function : sort_small()
+// description : Pick the unrolled sort network for cnt (power of two,
+//               cnt <= MAX_NETWORK).
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void sort_small(T *v, int cnt)
+{
+	switch (cnt) {
+		case  2: sort_small<T, Asc,  2>(v); break;
+		case  4: sort_small<T, Asc,  4>(v); break;
+		case  8: sort_small<T, Asc,  8>(v); break;
+		case 16: sort_small<T, Asc, 16>(v); break;
+		case 32: sort_small<T, Asc, 32>(v); break;
+		case 64: sort_small<T, Asc, 64>(v); break;
+		default: break;
+	}
+}
+
+// function : oddeven_merge_small()
+// description : Pick the unrolled odd-even merge for cnt (power of two,
+//               cnt <= MAX_NETWORK).
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void oddeven_merge_small(T *v, int cnt)
+{
+	switch (cnt) {
+		case  2: oddeven_merge_small<T, Asc,  2>(v); break;
+		case  4: oddeven_merge_small<T, Asc,  4>(v); break;
+		case  8: oddeven_merge_small<T, Asc,  8>(v); break;
+		case 16: oddeven_merge_small<T, Asc, 16>(v); break;
+		case 32: oddeven_merge_small<T, Asc, 32>(v); break;
+		case 64: oddeven_merge_small<T, Asc, 64>(v); break;
+		default: break;
+	}
+}
+
+// function : oddeven_sort_small()
+// description : Pick the unrolled odd-even sort for cnt (power of two,
+//               cnt <= MAX_NETWORK).
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void oddeven_sort_small(T *v, int cnt)
+{
+	switch (cnt) {
+		case  2: oddeven_sort_small<T, Asc,  2>(v); break;
+		case  4: oddeven_sort_small<T, Asc,  4>(v); break;
+		case  8: oddeven_sort_small<T, Asc,  8>(v); break;
+		case 16: oddeven_sort_small<T, Asc, 16>(v); break;
+		case 32: oddeven_sort_small<T, Asc, 32>(v); break;
+		case 64: oddeven_sort_small<T, Asc, 64>(v); break;
+		default: break;
+	}
+}
+
+// function : oddeven_merge()
+// description : Odd-even merge of two sorted halves of cnt elements
+//               (power of two), level by level like the generated
+//               network: the halves first, then at every distance k the
+//               odd k-blocks against their right neighbour. Each level
+//               is a sweep over contiguous ranges.
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void oddeven_merge(T *v, int cnt)
+{
+	if (cnt <= MAX_NETWORK) {
+		oddeven_merge_small<T, Asc>(v, cnt);
+		return;
+	}
+
+	compare_range<T, Asc>(v, cnt / 2, cnt / 2);
+
+	for (int k = cnt / 4; k >= 1; k /= 2) {
+		for (int j = k; j + k < cnt; j += 2 * k) {
+			compare_range<T, Asc>(v + j, k, k);
+		}
+	}
+}
+
+// function : oddeven_level()
+// description : Pairs [p0,p1) of one level of oddeven_merge(): the
+//               level at k = cnt/2 compares v[i] with v[i+k], every
+//               lower level the odd k-blocks with their right
+//               neighbour, so pair i is in the block at k + (i/k)*2k. The
+//               pairs of a level are independent, so any cut of them
+//               can run on its own thread.
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void oddeven_level(T *v, int cnt, int k, int p0, int p1)
+{
+	if (2 * k == cnt) {
+		compare_range<T, Asc>(v + p0, p1 - p0, k);
+		return;
+	}
+
+	while (p0 < p1) {
+
+		int j   = k + (p0 / k) * 2 * k + p0 % k;
+		int len = k - p0 % k;
+		if (len > p1 - p0)
+			len = p1 - p0;
+
+		compare_range<T, Asc>(v + j, len, k);
+		p0 += len;
+	}
+}
+
+// function : merge()
+// description : Bitonic merge of cnt (power of two) elements on one
+//               thread: the compare levels down to MAX_NETWORK, then the
+//               unrolled network, depth first so that the small levels
+//               run in cache.
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void merge(T *v, int cnt)
+{
+	if (cnt <= MAX_NETWORK) {
+		merge_small<T, Asc>(v, cnt);
+		return;
+	}
+
+	compare_level<T, Asc>(v, cnt / 2);
+
+	merge<T, Asc>(v, cnt / 2);
+	merge<T, Asc>(v + cnt / 2, cnt / 2);
+}
+
+// function : sort()
+// description : Bitonic sort of cnt (power of two) elements on one
+//               thread. Every level is a branch free min/max sweep.
+//---------------------------------------------------------------------
+
+template <typename T, bool Asc>
+inline void sort(T *v, int cnt)
+{
+	if (cnt <= MAX_NETWORK) {
+		sort_small<T, Asc>(v, cnt);
+		return;
+	}
+
+	sort<T, true>(v, cnt / 2);
+	sort<T, false>(v + cnt / 2, cnt / 2);
+
+	merge<T, Asc>(v, cnt);
+}
+
+} // namespace bitonic
+
+#endif
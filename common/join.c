@@ -0,0 +1,276 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "join.h"
+#include "merge_path.h"
+#include "bitonic_engine.h"
+#include "bitonic_kernels.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int join_par_min = 1<<16; //below this many keys, one thread
+
+
+// Function Declaration
+//===========================================================
+
+static int       join_sort_column(const int*, int, int*, int*, int);
+static int       join_lower_bound(const int*, int, int);
+static long long join_piece      (const int*, const int*, int, int, int, int,
+                                  const int*, const int*, int, int*, int*);
+
+
+// Function Definition
+//===========================================================
+
+// function : join_sort_merge()
+// description : 1. sort both columns (key and row) with the engine,
+//               2. cut the merge into pieces with merge path, moved to
+//                  the start of a key group,
+//               3. count the output of every piece, prefix sum,
+//               4. write every piece at its offset.
+//---------------------------------------------------------------------
+
+int join_sort_merge(const int *r, int nr, const int *s, int ns, int kind,
+                    int nthreads, struct join_result *res)
+{
+	int       *mem, *rk, *rr, *sk, *sr, *cut;
+	long long *off;
+	double     t0;
+	int        t, T, err;
+
+	memset(res, 0, sizeof(*res));
+	if (nthreads < 1)
+		nthreads = 1;
+	T = (nr + ns < join_par_min) ? 1 : nthreads;
+
+	// both columns sorted (keys and rows), and the cuts
+	mem = (int*) malloc((2 * (size_t) nr + 2 * (size_t) ns + 2 * (size_t) T + 2) * sizeof(int));
+	off = (long long*) malloc(((size_t) T + 1) * sizeof(long long));
+	if (mem == NULL || off == NULL) {
+		free(mem);
+		free(off);
+		return -1;
+	}
+	rk  = mem;
+	rr  = rk + nr;
+	sk  = rr + nr;
+	sr  = sk + ns;
+	cut = sr + ns;
+
+	// 1.
+	t0  = omp_get_wtime();
+	err = join_sort_column(r, nr, rk, rr, nthreads) != 0 ||
+	      join_sort_column(s, ns, sk, sr, nthreads) != 0;
+	res->sort_time = omp_get_wtime() - t0;
+
+	if (err) {
+		free(mem);
+		free(off);
+		return -1;
+	}
+
+	t0 = omp_get_wtime();
+
+	// 2. piece t joins r[cut[2t]..cut[2t+2]) with s[cut[2t+1]..cut[2t+3])
+	for (t = 0; t <= T; t++) {
+
+		int d = (int) ((long long) (nr + ns) * t / T);
+		int i = merge_path_split(rk, nr, sk, ns, d, 1);
+		int j = d - i;
+
+		if (i < nr || j < ns) {
+			int x = (j >= ns || (i < nr && rk[i] <= sk[j])) ? rk[i] : sk[j];
+			i = join_lower_bound(rk, nr, x);
+			j = join_lower_bound(sk, ns, x);
+		}
+		cut[2*t]   = i;
+		cut[2*t+1] = j;
+	}
+
+	// 3.
+	#pragma omp parallel for num_threads(T) if(T > 1)
+	for (t = 0; t < T; t++)
+		off[t+1] = join_piece(rk, rr, cut[2*t], cut[2*t+2], cut[2*t+1], cut[2*t+3],
+		                      sk, sr, kind, NULL, NULL);
+
+	off[0] = 0;
+	for (t = 1; t <= T; t++)
+		off[t] += off[t-1];
+
+	res->n    = off[T];
+	res->left = (int*) malloc(((size_t) res->n + 1) * sizeof(int));
+	if (kind == JOIN_INNER)
+		res->right = (int*) malloc(((size_t) res->n + 1) * sizeof(int));
+
+	if (res->left == NULL || (kind == JOIN_INNER && res->right == NULL)) {
+		join_result_free(res);
+		free(mem);
+		free(off);
+		return -1;
+	}
+
+	// 4.
+	#pragma omp parallel for num_threads(T) if(T > 1)
+	for (t = 0; t < T; t++)
+		join_piece(rk, rr, cut[2*t], cut[2*t+2], cut[2*t+1], cut[2*t+3],
+		           sk, sr, kind, res->left + off[t], res->right ? res->right + off[t] : NULL);
+
+	res->join_time = omp_get_wtime() - t0;
+
+	free(mem);
+	free(off);
+	return 0;
+}
+
+// function : join_result_free()
+// description : Release the output of join_sort_merge().
+//---------------------------------------------------------------------
+
+void join_result_free(struct join_result *res)
+{
+	free(res->left);
+	free(res->right);
+	res->left  = NULL;
+	res->right = NULL;
+	res->n     = 0;
+}
+
+// function : join_sort_column()
+// description : Sort the keys of v together with their row numbers:
+//               the key, sign bit flipped so that it orders as unsigned,
+//               and the row go into key-value records for the engine,
+//               and come back out as two arrays.
+//---------------------------------------------------------------------
+
+static int join_sort_column(const int *v, int n, int *keys, int *rows, int nthreads)
+{
+	struct kernel_kv *kv;
+	int i;
+
+	if (n < 1)
+		return 0;
+
+	kv = (struct kernel_kv*) malloc((size_t) n * sizeof(struct kernel_kv));
+	if (kv == NULL)
+		return -1;
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1 && n >= join_par_min)
+	for (i = 0; i < n; i++) {
+		kv[i].key = (unsigned int) v[i] ^ 0x80000000u;
+		kv[i].val = (unsigned int) i;
+	}
+
+	engine_sort_kv(kv, n, ENGINE_ASCENDING, nthreads);
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1 && n >= join_par_min)
+	for (i = 0; i < n; i++) {
+		keys[i] = (int) ((unsigned int) kv[i].key ^ 0x80000000u);
+		rows[i] = (int) kv[i].val;
+	}
+
+	free(kv);
+	return 0;
+}
+
+// function : join_lower_bound()
+// description : First position in v[0..n) with key >= x.
+//---------------------------------------------------------------------
+
+static int join_lower_bound(const int *v, int n, int x)
+{
+	int lo = 0, hi = n;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (v[mid] < x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// function : join_piece()
+// description : Merge join of r[i0..i1) and s[j0..j1): step past the
+//               smaller key, and on equal keys take the two groups
+//               whole. Writes the output to left/right unless left is
+//               NULL, and returns its size.
+//---------------------------------------------------------------------
+
+static long long join_piece(const int *rk, const int *rr, int i0, int i1, int j0, int j1,
+                            const int *sk, const int *sr, int kind, int *left, int *right)
+{
+	long long cnt = 0;
+	int i = i0, j = j0;
+
+	while (i < i1 && j < j1) {
+
+		if (rk[i] < sk[j]) {
+			i++;
+			continue;
+		}
+		if (rk[i] > sk[j]) {
+			j++;
+			continue;
+		}
+
+		int ie = i + 1, je = j + 1, a, b;
+		while (ie < i1 && rk[ie] == rk[i])
+			ie++;
+		while (je < j1 && sk[je] == sk[j])
+			je++;
+
+		if (kind == JOIN_SEMI) {
+			if (left)
+				for (a = i; a < ie; a++)
+					left[cnt++] = rr[a];
+			else
+				cnt += ie - i;
+		}
+		else {
+			if (left) {
+				for (a = i; a < ie; a++) {
+					for (b = j; b < je; b++) {
+						left[cnt]  = rr[a];
+						right[cnt] = sr[b];
+						cnt++;
+					}
+				}
+			}
+			else
+				cnt += (long long) (ie - i) * (je - j);
+		}
+
+		i = ie;
+		j = je;
+	}
+
+	return cnt;
+}
@@ -0,0 +1,61 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef JOIN_H
+#define JOIN_H
+
+// Parallel sort-merge join of two int key columns r[0..nr) and s[0..ns)
+// (OpenMP, nr+ns < 2^31). Both columns are sorted with their row numbers
+// as payload by the key-value bitonic engine. The merge of the two is
+// then cut into nthreads equal pieces with merge path, each moved back
+// to the start of its key's group so that no group of equal keys is
+// split, and every thread joins its piece: once to count its output,
+// once to write it at its offset.
+//
+//   JOIN_INNER every pair of rows (i,j) with r[i] == s[j]
+//   JOIN_SEMI  every row i of r with a match in s, once (right is NULL)
+//
+// The pairs come out in key order. join_sort_merge() returns 0, or -1
+// if it could not allocate memory.
+//===========================================================
+
+#define JOIN_INNER 0
+#define JOIN_SEMI  1
+
+struct join_result {
+
+	int       *left;      //rows of r
+	int       *right;     //rows of s (JOIN_INNER)
+	long long  n;         //pairs (rows for JOIN_SEMI)
+	double     sort_time; //seconds to sort both columns
+	double     join_time; //seconds to partition, count and write
+};
+
+int  join_sort_merge  (const int *r, int nr, const int *s, int ns, int kind,
+                       int nthreads, struct join_result *res);
+void join_result_free (struct join_result *res);
+
+static inline const char* join_kind_name(int kind)
+{
+	return (kind == JOIN_SEMI) ? "semi" : "inner";
+}
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <omp.h>
+
+#include "keyrange.h"
+#include "bitonic_kernels.h"
+#include "bitonic_engine.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int keyrange_samples   = 4096;    //sampled keys for the distinct estimate
+const int keyrange_packed    = 1<<16;   //largest range that fits 16-bit lanes
+const int keyrange_block_min = 1<<12;   //smallest block a thread sorts (packed)
+
+
+// Function Declaration
+//===========================================================
+
+static double keyrange_distinct(const int*, int, long long);
+static int    keyrange_count   (int*, int, int, int, int, int);
+static int    keyrange_pack    (int*, int, int, int, int);
+
+
+// Function Definition
+//===========================================================
+
+// function : keyrange_sort()
+// description : Find min and max in one parallel scan, estimate the
+//               distinct keys, then take the cheapest path. Counting
+//               needs one histogram of range entries per thread, so it
+//               is taken when they hold no more entries than there are
+//               keys. Returns the path; v is sorted unless it is
+//               KEYRANGE_FULL.
+//---------------------------------------------------------------------
+
+int keyrange_sort(int *v, int n, int dir, int nthreads, struct keyrange_stats *st)
+{
+	struct keyrange_stats s;
+	int lo = INT_MAX, hi = INT_MIN;
+	int i;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) reduction(min:lo) reduction(max:hi)
+	for (i = 0; i < n; i++) {
+		lo = (v[i] < lo) ? v[i] : lo;
+		hi = (v[i] > hi) ? v[i] : hi;
+	}
+
+	s.min      = lo;
+	s.max      = hi;
+	s.range    = (n > 0) ? (long long) hi - lo + 1 : 0;
+	s.distinct = keyrange_distinct(v, n, s.range);
+	s.path     = KEYRANGE_FULL;
+
+	if (n >= 2) {
+		if (s.range * nthreads <= n &&
+		    keyrange_count(v, n, dir, nthreads, lo, (int) s.range) == 0)
+			s.path = KEYRANGE_COUNT;
+		else if (s.range <= keyrange_packed &&
+		         keyrange_pack(v, n, dir, nthreads, lo) == 0)
+			s.path = KEYRANGE_PACKED;
+	}
+
+	if (st)
+		*st = s;
+	return s.path;
+}
+
+// function : keyrange_report()
+// description : One line with the path taken and why.
+//---------------------------------------------------------------------
+
+void keyrange_report(const struct keyrange_stats *st)
+{
+	printf("keyrange: %s (min %d, max %d, range %lld, distinct %.0lf estimated)\n",
+	       keyrange_path_name(st->path), st->min, st->max, st->range, st->distinct);
+}
+
+// function : keyrange_distinct()
+// description : Distinct keys among keyrange_samples sampled ones (the
+//               whole array if it is smaller), extended to n with the
+//               Chao1 estimate d + f1^2/(2 f2), f1 and f2 being the
+//               keys seen once and twice. At most min(n, range).
+//---------------------------------------------------------------------
+
+static double keyrange_distinct(const int *v, int n, long long range)
+{
+	int s = (n < keyrange_samples) ? n : keyrange_samples;
+	int i, d = 0, f1 = 0, f2 = 0;
+	double est;
+
+	if (n < 1)
+		return 0.0;
+
+	int *x = (int*) malloc(s * sizeof(int));
+	if (x == NULL)
+		return 0.0;
+
+	// fixed LCG, so runs are repeatable
+	unsigned int seed = 12345u;
+	for (i = 0; i < s; i++) {
+		seed = seed * 1103515245u + 12345u;
+		x[i] = (s == n) ? v[i] : v[(size_t) (seed >> 1) % n];
+	}
+	qsort(x, s, sizeof(int), engine_cmp_asc);
+
+	for (i = 0; i < s; ) {
+		int e = i + 1;
+		while (e < s && x[e] == x[i])
+			e++;
+		d++;
+		f1 += (e - i == 1);
+		f2 += (e - i == 2);
+		i = e;
+	}
+	free(x);
+
+	if (s == n)
+		return d;
+
+	est = d + (f2 > 0 ? (double) f1 * f1 / (2.0 * f2) : (double) f1 * (f1 - 1) / 2.0);
+	if (est > n)
+		est = n;
+	if (est > range)
+		est = range;
+	return est;
+}
+
+// function : keyrange_count()
+// description : Parallel counting sort of keys in [lo,lo+range):
+//               1. every thread counts its chunk in its own histogram,
+//               2. the histograms are added up per key, and the totals
+//                  prefix summed in the order of dir,
+//               3. every thread writes an equal share of the output,
+//                  starting at the key that covers its first position.
+//               Returns -1 if the histograms cannot be allocated.
+//---------------------------------------------------------------------
+
+static int keyrange_count(int *v, int n, int dir, int nthreads, int lo, int range)
+{
+	int *hist  = (int*) calloc((size_t) nthreads * range, sizeof(int));
+	int *start = (int*) malloc(((size_t) range + 1) * sizeof(int));
+
+	if (hist == NULL || start == NULL) {
+		free(hist);
+		free(start);
+		return -1;
+	}
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+	{
+		int t  = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+		int a  = (int) ((long long) n * t / nt);
+		int b  = (int) ((long long) n * (t + 1) / nt);
+		int *h = hist + (size_t) t * range;
+		int i, r, s;
+
+		// 1.
+		for (i = a; i < b; i++)
+			h[v[i] - lo]++;
+
+		#pragma omp barrier
+
+		// 2. start[r] counts rank r: key lo+r ascending, lo+range-1-r descending
+		#pragma omp for
+		for (r = 0; r < range; r++) {
+			int k = dir ? r : range - 1 - r, c = 0;
+			for (s = 0; s < nt; s++)
+				c += hist[(size_t) s * range + k];
+			start[r] = c;
+		}
+
+		#pragma omp single
+		{
+			int sum = 0;
+			for (r = 0; r < range; r++) {
+				int c = start[r];
+				start[r] = sum;
+				sum += c;
+			}
+			start[range] = sum;
+		}
+
+		// 3. the last rank that starts at or before a
+		int l = 0, u = range;
+		while (u - l > 1) {
+			int m = (l + u) / 2;
+			if (start[m] <= a)
+				l = m;
+			else
+				u = m;
+		}
+		for (r = l, i = a; i < b; i++) {
+			while (start[r+1] <= i)
+				r++;
+			v[i] = dir ? lo + r : lo + (range - 1 - r);
+		}
+	}
+
+	free(hist);
+	free(start);
+	return 0;
+}
+
+// function : keyrange_pack()
+// description : Sort keys in [lo,lo+2^16) as v[i]-lo in 16-bit lanes,
+//               padded to a power of two with 0xffff (which sorts last,
+//               so the first n are the keys). T threads, a power of two,
+//               sort blocks of m/T keys; every later stage splits its
+//               levels above the block size evenly between them and
+//               merges the blocks in parallel. The sorted lanes are
+//               widened back into v in direction dir.
+//               Returns -1 if the lanes cannot be allocated.
+//---------------------------------------------------------------------
+
+static int keyrange_pack(int *v, int n, int dir, int nthreads, int lo)
+{
+	int m = 1, T = 1, B, i;
+
+	while (m < n)
+		m <<= 1;
+	while (2 * T <= nthreads && m / (2 * T) >= keyrange_block_min)
+		T <<= 1;
+	B = m / T;
+
+	unsigned short *w = (unsigned short*) malloc((size_t) m * sizeof(unsigned short));
+	if (w == NULL)
+		return -1;
+
+	#pragma omp parallel num_threads(T) if(T > 1) private(i)
+	{
+		int t, k, j, c;
+		int half = B / 2 > 0 ? B / 2 : 1; //pairs per compare task
+
+		#pragma omp for
+		for (i = 0; i < m; i++)
+			w[i] = (i < n) ? (unsigned short) (v[i] - lo) : 0xffff;
+
+		// block t ascending if t is even, the first stage's bitonic pairs
+		#pragma omp for
+		for (t = 0; t < T; t++)
+			kernel_sort_u16(w + (size_t) t * B, B, (t & 1) == 0);
+
+		for (k = 2 * B; k <= m; k *= 2) {
+
+			for (j = k / 2; j >= B; j /= 2) {
+
+				#pragma omp for
+				for (c = 0; c < m / 2 / half; c++) {
+					int p    = c * half;
+					int base = (p / j) * 2 * j + p % j;
+					kernel_compare_range_u16(w + base, half, j, (base & k) == 0);
+				}
+			}
+
+			#pragma omp for
+			for (t = 0; t < T; t++)
+				kernel_merge_u16(w + (size_t) t * B, B, (((size_t) t * B) & k) == 0);
+		}
+
+		#pragma omp for
+		for (i = 0; i < n; i++)
+			v[i] = lo + (dir ? w[i] : w[n - 1 - i]);
+	}
+
+	free(w);
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef KEYRANGE_H
+#define KEYRANGE_H
+
+// Key-range pre-pass, for the drivers' -keyrange flag. keyrange_sort()
+// finds the smallest and largest key of v[0..n) with one parallel scan,
+// estimates the number of distinct keys from a sample, and finishes the
+// sort itself when the keys span a narrow range:
+//
+//   KEYRANGE_COUNT  range*nthreads <= n: parallel counting sort
+//   KEYRANGE_PACKED range <= 2^16: bitonic sort of key-min in 16 bits
+//
+// Otherwise it is KEYRANGE_FULL and v is left to the full sort.
+//===========================================================
+
+#define KEYRANGE_FULL   0
+#define KEYRANGE_COUNT  1
+#define KEYRANGE_PACKED 2
+
+struct keyrange_stats {
+
+	int       min;
+	int       max;
+	long long range;    //max-min+1
+	double    distinct; //estimated distinct keys (exact for small n)
+	int       path;     //KEYRANGE_*
+};
+
+int  keyrange_sort  (int *v, int n, int dir, int nthreads, struct keyrange_stats *st);
+void keyrange_report(const struct keyrange_stats *st);
+
+static inline const char* keyrange_path_name(int path)
+{
+	switch (path) {
+	case KEYRANGE_COUNT:  return "counting";
+	case KEYRANGE_PACKED: return "packed16";
+	default:              return "full";
+	}
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "merge_path.h"
+
+
+// x goes before y in direction dir
+#define MP_BEFORE(x,y,dir) ((dir) ? (x) < (y) : (x) > (y))
+
+
+// Function Definition
+//===========================================================
+
+// function : merge_path_split()
+// description : Binary search along the k-th cross diagonal of the
+//               merge grid: the smallest i such that a[i] does not
+//               belong to the first k keys.
+//---------------------------------------------------------------------
+
+int merge_path_split(const int *a, int na, const int *b, int nb, int k, int dir)
+{
+	int lo = (k > nb) ? k - nb : 0;
+	int hi = (k < na) ? k : na;
+
+	while (lo < hi) {
+
+		int i = lo + (hi - lo) / 2;
+
+		// a[i] is taken before b[k-i-1] (ties go to a): i is too small
+		if (!MP_BEFORE(b[k-i-1], a[i], dir))
+			lo = i + 1;
+		else
+			hi = i;
+	}
+
+	return lo;
+}
+
+// function : merge_path_range()
+// description : Write keys k0..k1-1 of the merge of a and b to
+//               out[k0..k1).
+//---------------------------------------------------------------------
+
+void merge_path_range(const int *a, int na, const int *b, int nb,
+                      int *out, int k0, int k1, int dir)
+{
+	int i = merge_path_split(a, na, b, nb, k0, dir);
+	int j = k0 - i;
+	int k;
+
+	for (k = k0; k < k1; k++) {
+
+		if (j >= nb || (i < na && !MP_BEFORE(b[j], a[i], dir)))
+			out[k] = a[i++];
+		else
+			out[k] = b[j++];
+	}
+}
+
+// function : merge_path_merge()
+// description : Merge a and b into out with nthreads equal pieces of
+//               the output.
+//---------------------------------------------------------------------
+
+void merge_path_merge(const int *a, int na, const int *b, int nb,
+                      int *out, int dir, int nthreads)
+{
+	int n = na + nb;
+	int t;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1)
+	for (t = 0; t < nthreads; t++) {
+
+		int k0 = (int) ((long long) n * t / nthreads);
+		int k1 = (int) ((long long) n * (t + 1) / nthreads);
+
+		merge_path_range(a, na, b, nb, out, k0, k1, dir);
+	}
+}
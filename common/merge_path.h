@@ -0,0 +1,38 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef MERGE_PATH_H
+#define MERGE_PATH_H
+
+// Merge path (Odeh, Green, Mwassi, Shmueli, Birk): the first k keys of
+// the merge of the sorted arrays a and b are a[0..i) and b[0..k-i) for
+// i = merge_path_split(a,na,b,nb,k,dir). Any range of the output can be
+// merged on its own, so one merge is cut into equal independent pieces.
+// On ties a goes first. dir is 1 for ascending, 0 for descending.
+//===========================================================
+
+int  merge_path_split(const int *a, int na, const int *b, int nb, int k, int dir);
+void merge_path_range(const int *a, int na, const int *b, int nb,
+                      int *out, int k0, int k1, int dir);
+void merge_path_merge(const int *a, int na, const int *b, int nb,
+                      int *out, int dir, int nthreads);
+
+#endif
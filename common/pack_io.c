@@ -0,0 +1,496 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#include "pack_io.h"
+
+
+// Constants & Variables
+//===========================================================
+
+#define PACK_BLOCK  (1<<16) //keys per block
+#define PACK_CHUNK  256     //keys per chunk, one bit width each
+#define PACK_LANES  8       //vertical lanes of a chunk
+#define PACK_CHUNKS (PACK_BLOCK / PACK_CHUNK)
+
+static const char pack_magic[4] = { 'B', 'S', 'P', '1' };
+
+struct pack_header {
+
+	char     magic[4];
+	uint32_t block;   //keys per block
+	uint64_t n;
+	uint64_t nblocks;
+}; // start of the file
+
+struct pack_entry {
+
+	uint64_t offset;  //of the block's data, from the end of the index
+	int32_t  first;   //first key of the block
+	uint32_t pad;
+}; // one block of the index
+
+
+// Function Declaration
+//===========================================================
+
+static int    pack_widths (const int*, int, unsigned char*);
+static size_t pack_size   (const unsigned char*, int);
+static void   pack_block  (const int*, int, const unsigned char*, unsigned char*);
+static void   unpack_block(const unsigned char*, int, int, int*);
+static void   pack_chunk  (const uint32_t*, uint32_t*, int);
+static void   unpack_chunk(const uint32_t*, uint32_t*, int);
+
+
+// Function Definition
+//===========================================================
+
+// function : pack_write()
+// description : Write v[0..n) to path:
+//               1. every block's chunk widths, hence its size,
+//               2. prefix sum of the sizes into the index,
+//               3. every thread encodes its blocks into one buffer and
+//                  writes them at their offsets with pwrite.
+//               Returns 0, or -1 on an allocation or write error.
+//---------------------------------------------------------------------
+
+int pack_write(const char *path, const int *v, int n, int nthreads, struct pack_stats *st)
+{
+	struct pack_header hdr;
+	struct pack_entry *index;
+	unsigned char     *widths, *buf;
+	int                nblocks = (n + PACK_BLOCK - 1) / PACK_BLOCK;
+	int                b, fd, err = 0;
+	size_t             total = 0, head;
+	double             t0, t_size;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	index  = (struct pack_entry*) calloc((size_t) nblocks + 1, sizeof(struct pack_entry));
+	widths = (unsigned char*) malloc(((size_t) nblocks + 1) * PACK_CHUNKS);
+	if (index == NULL || widths == NULL) {
+		free(index);
+		free(widths);
+		return -1;
+	}
+
+	t0 = omp_get_wtime();
+
+	// 1.
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1 && nblocks > 1) schedule(static)
+	for (b = 0; b < nblocks; b++) {
+		int lo  = b * PACK_BLOCK;
+		int cnt = (n - lo < PACK_BLOCK) ? n - lo : PACK_BLOCK;
+		pack_widths(v + lo, cnt, widths + (size_t) b * PACK_CHUNKS);
+		index[b].offset = pack_size(widths + (size_t) b * PACK_CHUNKS, cnt);
+		index[b].first  = v[lo];
+	}
+
+	// 2.
+	for (b = 0; b < nblocks; b++) {
+		size_t sz = index[b].offset;
+		index[b].offset = total;
+		total += sz;
+	}
+	t_size = omp_get_wtime() - t0;
+
+	buf = (unsigned char*) malloc(total + 1);
+	if (buf == NULL) {
+		free(index);
+		free(widths);
+		return -1;
+	}
+
+	memcpy(hdr.magic, pack_magic, 4);
+	hdr.block   = PACK_BLOCK;
+	hdr.n       = n;
+	hdr.nblocks = nblocks;
+	head = sizeof(hdr) + (size_t) nblocks * sizeof(struct pack_entry);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 ||
+	    pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr) ||
+	    pwrite(fd, index, head - sizeof(hdr), sizeof(hdr)) != (ssize_t) (head - sizeof(hdr))) {
+		if (fd >= 0)
+			close(fd);
+		free(index);
+		free(widths);
+		free(buf);
+		return -1;
+	}
+
+	// 3. the blocks of a thread are contiguous, one pwrite each
+	double t_enc = 0, t_wr = 0;
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1 && nblocks > 1) reduction(|:err) reduction(max:t_enc,t_wr)
+	{
+		int t  = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+		int b0 = (int) ((long long) nblocks * t / nt);
+		int b1 = (int) ((long long) nblocks * (t + 1) / nt);
+		int k;
+		double t1 = omp_get_wtime();
+
+		for (k = b0; k < b1; k++) {
+			int lo  = k * PACK_BLOCK;
+			int cnt = (n - lo < PACK_BLOCK) ? n - lo : PACK_BLOCK;
+			pack_block(v + lo, cnt, widths + (size_t) k * PACK_CHUNKS, buf + index[k].offset);
+		}
+		double t2 = omp_get_wtime();
+
+		if (b1 > b0) {
+			size_t off = index[b0].offset;
+			size_t len = (b1 < nblocks ? index[b1].offset : total) - off;
+			size_t done = 0;
+			while (done < len && !err) {
+				ssize_t w = pwrite(fd, buf + off + done, len - done, head + off + done);
+				if (w <= 0)
+					err = 1;
+				else
+					done += w;
+			}
+		}
+
+		t_enc = t2 - t1;
+		t_wr  = omp_get_wtime() - t2;
+	}
+
+	if (close(fd) != 0)
+		err = 1;
+
+	if (st) {
+		st->raw_bytes    = (long long) n * sizeof(int);
+		st->packed_bytes = head + total;
+		st->encode_time  = t_size + t_enc;
+		st->write_time   = t_wr;
+	}
+
+	free(index);
+	free(widths);
+	free(buf);
+	return err ? -1 : 0;
+}
+
+// function : pack_report()
+// description : One line with the sizes and times of pack_write().
+//---------------------------------------------------------------------
+
+void pack_report(const struct pack_stats *st)
+{
+	printf("pack: %lld -> %lld bytes (%.1fx, %.2f bits/key), encode %lf s, write %lf s\n",
+	       st->raw_bytes, st->packed_bytes,
+	       st->packed_bytes ? (double) st->raw_bytes / st->packed_bytes : 0.0,
+	       st->raw_bytes ? 32.0 * st->packed_bytes / st->raw_bytes : 0.0,
+	       st->encode_time, st->write_time);
+}
+
+// function : pack_open()
+// description : Map a file written by pack_write() and check its
+//               header. Returns 0, or -1 if it is not such a file.
+//---------------------------------------------------------------------
+
+int pack_open(struct pack_file *pf, const char *path)
+{
+	struct pack_header hdr;
+	struct stat        sb;
+
+	memset(pf, 0, sizeof(*pf));
+	pf->fd = open(path, O_RDONLY);
+	if (pf->fd < 0)
+		return -1;
+
+	if (fstat(pf->fd, &sb) != 0 || (size_t) sb.st_size < sizeof(hdr)) {
+		pack_close(pf);
+		return -1;
+	}
+	pf->size = sb.st_size;
+	pf->map  = (const unsigned char*) mmap(NULL, pf->size, PROT_READ, MAP_SHARED, pf->fd, 0);
+	if (pf->map == MAP_FAILED) {
+		pf->map = NULL;
+		pack_close(pf);
+		return -1;
+	}
+
+	memcpy(&hdr, pf->map, sizeof(hdr));
+	if (memcmp(hdr.magic, pack_magic, 4) != 0 || hdr.block != PACK_BLOCK ||
+	    hdr.n > 0x7fffffff || hdr.nblocks != (hdr.n + PACK_BLOCK - 1) / PACK_BLOCK ||
+	    sizeof(hdr) + hdr.nblocks * sizeof(struct pack_entry) > pf->size) {
+		pack_close(pf);
+		return -1;
+	}
+
+	pf->n       = (int) hdr.n;
+	pf->nblocks = (int) hdr.nblocks;
+	pf->index   = pf->map + sizeof(hdr);
+	pf->data    = pf->map + sizeof(hdr) + hdr.nblocks * sizeof(struct pack_entry);
+	return 0;
+}
+
+// function : pack_read()
+// description : Decode keys lo..lo+cnt-1 into out[0..cnt): only the
+//               blocks that hold them are unpacked. Returns 0, or -1
+//               if the range is outside the file.
+//---------------------------------------------------------------------
+
+int pack_read(const struct pack_file *pf, int lo, int cnt, int *out)
+{
+	const struct pack_entry *index = (const struct pack_entry*) pf->index;
+	int *tmp;
+	int  b;
+
+	if (lo < 0 || cnt < 0 || lo > pf->n - cnt)
+		return -1;
+
+	tmp = (int*) malloc(PACK_BLOCK * sizeof(int));
+	if (tmp == NULL)
+		return -1;
+
+	for (b = lo / PACK_BLOCK; cnt > 0; b++) {
+
+		int b0  = b * PACK_BLOCK;
+		int bn  = (pf->n - b0 < PACK_BLOCK) ? pf->n - b0 : PACK_BLOCK;
+		int off = lo - b0;
+		int len = (bn - off < cnt) ? bn - off : cnt;
+
+		unpack_block(pf->data + index[b].offset, bn, index[b].first, tmp);
+		memcpy(out, tmp + off, (size_t) len * sizeof(int));
+
+		out += len;
+		lo  += len;
+		cnt -= len;
+	}
+
+	free(tmp);
+	return 0;
+}
+
+// function : pack_read_all()
+// description : Decode the whole file into out[0..n), the blocks split
+//               between the threads.
+//---------------------------------------------------------------------
+
+int pack_read_all(const struct pack_file *pf, int *out, int nthreads)
+{
+	const struct pack_entry *index = (const struct pack_entry*) pf->index;
+	int b;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1 && pf->nblocks > 1) schedule(static)
+	for (b = 0; b < pf->nblocks; b++) {
+		int lo  = b * PACK_BLOCK;
+		int cnt = (pf->n - lo < PACK_BLOCK) ? pf->n - lo : PACK_BLOCK;
+		unpack_block(pf->data + index[b].offset, cnt, index[b].first, out + lo);
+	}
+	return 0;
+}
+
+// function : pack_close()
+// description : Unmap and close a file opened by pack_open().
+//---------------------------------------------------------------------
+
+void pack_close(struct pack_file *pf)
+{
+	if (pf->map)
+		munmap((void*) pf->map, pf->size);
+	if (pf->fd >= 0)
+		close(pf->fd);
+	memset(pf, 0, sizeof(*pf));
+	pf->fd = -1;
+}
+
+// function : pack_widths()
+// description : Bit width of every chunk of a block: the width of the
+//               OR of its deltas (the first key's delta is 0).
+//---------------------------------------------------------------------
+
+static int pack_widths(const int *v, int cnt, unsigned char *widths)
+{
+	int c, i, nch = (cnt + PACK_CHUNK - 1) / PACK_CHUNK;
+
+	for (c = 0; c < nch; c++) {
+
+		int      lo = c * PACK_CHUNK;
+		int      hi = (cnt - lo < PACK_CHUNK) ? cnt : lo + PACK_CHUNK;
+		uint32_t m  = 0;
+
+		for (i = (lo > 0 ? lo : 1); i < hi; i++)
+			m |= (uint32_t) v[i] - (uint32_t) v[i-1];
+
+		widths[c] = (unsigned char) (m ? 32 - __builtin_clz(m) : 0);
+	}
+	return nch;
+}
+
+// function : pack_size()
+// description : Bytes of a block: its widths, rounded up to 4, and
+//               8 lanes times width words per chunk.
+//---------------------------------------------------------------------
+
+static size_t pack_size(const unsigned char *widths, int cnt)
+{
+	int    c, nch = (cnt + PACK_CHUNK - 1) / PACK_CHUNK;
+	size_t sz = (nch + 3) & ~3;
+
+	for (c = 0; c < nch; c++)
+		sz += (size_t) widths[c] * PACK_LANES * sizeof(uint32_t);
+	return sz;
+}
+
+// function : pack_block()
+// description : Encode one block: the widths, then every chunk's
+//               deltas (zero padded to a full chunk), packed.
+//---------------------------------------------------------------------
+
+static void pack_block(const int *v, int cnt, const unsigned char *widths, unsigned char *out)
+{
+	int       c, i, nch = (cnt + PACK_CHUNK - 1) / PACK_CHUNK;
+	uint32_t  d[PACK_CHUNK];
+	uint32_t *w;
+
+	memcpy(out, widths, nch);
+	memset(out + nch, 0, ((nch + 3) & ~3) - nch);
+	w = (uint32_t*) (out + ((nch + 3) & ~3));
+
+	for (c = 0; c < nch; c++) {
+
+		int lo = c * PACK_CHUNK;
+		int hi = (cnt - lo < PACK_CHUNK) ? cnt : lo + PACK_CHUNK;
+
+		for (i = lo; i < hi; i++)
+			d[i-lo] = (i > 0) ? (uint32_t) v[i] - (uint32_t) v[i-1] : 0;
+		for (; i < lo + PACK_CHUNK; i++)
+			d[i-lo] = 0;
+
+		pack_chunk(d, w, widths[c]);
+		w += widths[c] * PACK_LANES;
+	}
+}
+
+// function : unpack_block()
+// description : Decode one block of cnt keys starting at first: unpack
+//               every chunk, then add the deltas up.
+//---------------------------------------------------------------------
+
+static void unpack_block(const unsigned char *in, int cnt, int first, int *out)
+{
+	int             c, i, nch = (cnt + PACK_CHUNK - 1) / PACK_CHUNK;
+	uint32_t        d[PACK_CHUNK];
+	uint32_t        x = (uint32_t) first;
+	const uint32_t *w = (const uint32_t*) (in + ((nch + 3) & ~3));
+
+	for (c = 0; c < nch; c++) {
+
+		int lo = c * PACK_CHUNK;
+		int hi = (cnt - lo < PACK_CHUNK) ? cnt : lo + PACK_CHUNK;
+
+		unpack_chunk(w, d, in[c]);
+		w += in[c] * PACK_LANES;
+
+		for (i = lo; i < hi; i++) {
+			x += d[i-lo];
+			out[i] = (int) x;
+		}
+	}
+}
+
+// function : pack_chunk()
+// description : Pack 256 values of the given width into 8*width words:
+//               value j*8+l goes to lane l, bits j*width onwards of the
+//               lane, and word k of lane l is out[k*8+l]. Every step
+//               handles the 8 lanes the same way, so the lane loops
+//               vectorize.
+//---------------------------------------------------------------------
+
+static void pack_chunk(const uint32_t *in, uint32_t *out, int width)
+{
+	uint32_t acc[PACK_LANES] = { 0 };
+	int      j, l, shift = 0;
+
+	if (width == 0)
+		return;
+
+	for (j = 0; j < PACK_CHUNK / PACK_LANES; j++) {
+
+		const uint32_t *x = in + j * PACK_LANES;
+
+		for (l = 0; l < PACK_LANES; l++)
+			acc[l] |= x[l] << shift;
+		shift += width;
+
+		if (shift >= 32) {
+			shift -= 32;
+			for (l = 0; l < PACK_LANES; l++) {
+				out[l] = acc[l];
+				acc[l] = shift ? x[l] >> (width - shift) : 0;
+			}
+			out += PACK_LANES;
+		}
+	}
+}
+
+// function : unpack_chunk()
+// description : The inverse of pack_chunk().
+//---------------------------------------------------------------------
+
+static void unpack_chunk(const uint32_t *in, uint32_t *out, int width)
+{
+	uint32_t mask = (width == 32) ? 0xffffffffu : (1u << width) - 1;
+	int      j, l, shift = 0;
+
+	if (width == 0) {
+		memset(out, 0, PACK_CHUNK * sizeof(uint32_t));
+		return;
+	}
+
+	for (j = 0; j < PACK_CHUNK / PACK_LANES; j++) {
+
+		uint32_t *x = out + j * PACK_LANES;
+
+		if (shift + width <= 32) {
+			for (l = 0; l < PACK_LANES; l++)
+				x[l] = (in[l] >> shift) & mask;
+			shift += width;
+			if (shift == 32) {
+				shift = 0;
+				in   += PACK_LANES;
+			}
+		}
+		else {
+			for (l = 0; l < PACK_LANES; l++)
+				x[l] = ((in[l] >> shift) | (in[l + PACK_LANES] << (32 - shift))) & mask;
+			shift += width - 32;
+			in    += PACK_LANES;
+		}
+	}
+}
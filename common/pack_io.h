@@ -0,0 +1,69 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef PACK_IO_H
+#define PACK_IO_H
+
+// Compressed files of sorted int keys (the drivers' --pack).
+//
+// The keys are cut into blocks of 2^16. A block keeps its first key in
+// the block index and the differences to the previous key as unsigned
+// 32-bit deltas, bit-packed in chunks of 256 with the width of the
+// chunk's largest delta (0..32 bits). A chunk is packed in 8 vertical
+// lanes: lane l holds the deltas i = l mod 8, and the words of the 8
+// lanes are interleaved, so packing and unpacking run on 8 lanes at
+// once. Sorted keys with small gaps take a few bits each; any other
+// input still round-trips, just with wide chunks.
+//
+// File: a header, the block index (byte offset of the block's data and
+// its first key), then the blocks. Every block can be decoded on its
+// own, so the threads encode, write and decode whole blocks in
+// parallel, and pack_read() decodes any range without the rest.
+//===========================================================
+
+struct pack_stats {
+
+	long long raw_bytes;    //n * sizeof(int)
+	long long packed_bytes; //file size
+	double    encode_time;  //seconds
+	double    write_time;
+};
+
+struct pack_file {
+
+	int                  fd;
+	const unsigned char *map;
+	size_t               size;
+	int                  n;
+	int                  nblocks;
+	const void          *index;
+	const unsigned char *data;
+};
+
+int  pack_write   (const char *path, const int *v, int n, int nthreads, struct pack_stats *st);
+void pack_report  (const struct pack_stats *st);
+
+int  pack_open    (struct pack_file *pf, const char *path);
+int  pack_read    (const struct pack_file *pf, int lo, int cnt, int *out);
+int  pack_read_all(const struct pack_file *pf, int *out, int nthreads);
+void pack_close   (struct pack_file *pf);
+
+#endif
@@ -0,0 +1,333 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "presort.h"
+#include "merge_path.h"
+#include "bitonic_engine.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int presort_min_run    = 64;   //average run length the run merge needs
+const int presort_samples    = 4096; //sampled pairs for the inversion estimate
+const int presort_pieces_thr = 4;    //merge pieces per thread and pass
+
+// x goes before y in direction dir
+#define PS_BEFORE(x,y,dir) ((dir) ? (x) < (y) : (x) > (y))
+
+
+// Function Declaration
+//===========================================================
+
+static void presort_reverse   (int*, int, int);
+static void presort_merge_runs(int*, int, int, int, int);
+static int  presort_find_runs (const int*, int, int, int, int*);
+
+
+// Function Definition
+//===========================================================
+
+// function : presort_sort()
+// description : Count the adjacent pairs out of order in both
+//               directions (runs = breaks + 1), estimate the inversions
+//               from random pairs, then take the cheapest path. Returns
+//               the path; v is sorted unless it is PRESORT_RANDOM.
+//---------------------------------------------------------------------
+
+int presort_sort(int *v, int n, int dir, int nthreads, struct presort_stats *st)
+{
+	struct presort_stats s;
+	long long breaks = 0, rbreaks = 0;
+	int i;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	// the comparisons are added, not branched on, so the scan vectorizes
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) reduction(+:breaks,rbreaks)
+	for (i = 0; i < n - 1; i++) {
+		breaks  += PS_BEFORE(v[i+1], v[i], dir);
+		rbreaks += PS_BEFORE(v[i], v[i+1], dir);
+	}
+
+	s.runs       = breaks + 1;
+	s.desc_runs  = rbreaks + 1;
+	s.inversions = 0.0;
+
+	// sampled inversions (fixed LCG, so runs are repeatable)
+	if (n > 1) {
+
+		unsigned int seed = 12345u;
+		int out = 0, k;
+
+		for (k = 0; k < presort_samples; k++) {
+
+			seed = seed * 1103515245u + 12345u;
+			int x = (int) ((seed >> 1) % (unsigned int) n);
+			seed = seed * 1103515245u + 12345u;
+			int y = (int) ((seed >> 1) % (unsigned int) n);
+
+			if (x > y) { int t = x; x = y; y = t; }
+			out += (x != y && PS_BEFORE(v[y], v[x], dir));
+		}
+		s.inversions = (double) out / presort_samples;
+	}
+
+	if (breaks == 0) {
+		s.path = PRESORT_SORTED;
+	}
+	else if (rbreaks == 0) {
+		presort_reverse(v, n, nthreads);
+		s.path = PRESORT_REVERSED;
+	}
+	else if (s.runs <= n / presort_min_run) {
+		presort_merge_runs(v, n, dir, nthreads, (int) s.runs);
+		s.path = PRESORT_RUNS;
+	}
+	else if (s.desc_runs <= n / presort_min_run) {
+		// nearly reversed: reversing turns the descending runs into runs
+		presort_reverse(v, n, nthreads);
+		presort_merge_runs(v, n, dir, nthreads, (int) s.desc_runs);
+		s.path = PRESORT_RUNS;
+	}
+	else {
+		s.path = PRESORT_RANDOM;
+	}
+
+	if (st != NULL)
+		*st = s;
+
+	return s.path;
+}
+
+// function : presort_report()
+// description : One line with the path taken and the measurements.
+//---------------------------------------------------------------------
+
+void presort_report(const struct presort_stats *st)
+{
+	printf("presort: %s (runs %lld, descending runs %lld, inversions %.4lf sampled)\n",
+	       presort_path_name(st->path), st->runs, st->desc_runs, st->inversions);
+}
+
+// function : presort_reverse()
+// description : Reverse v[0..n) in place, in parallel.
+//---------------------------------------------------------------------
+
+static void presort_reverse(int *v, int n, int nthreads)
+{
+	int i;
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1)
+	for (i = 0; i < n / 2; i++) {
+		int t = v[i];
+		v[i] = v[n-1-i];
+		v[n-1-i] = t;
+	}
+}
+
+// function : presort_find_runs()
+// description : Starts of the nruns natural runs of v in start[0..nruns),
+//               start[nruns] = n. Each thread counts the breaks in its
+//               chunk, a prefix sum gives it its slots in start[].
+//---------------------------------------------------------------------
+
+static int presort_find_runs(const int *v, int n, int dir, int nthreads, int *start)
+{
+	int *offset = (int*) calloc(nthreads + 1, sizeof(int));
+	int  nruns  = 1;
+
+	if (offset == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	start[0] = 0;
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+	{
+		int t  = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+		int lo = (int) ((long long) (n - 1) * t / nt);
+		int hi = (int) ((long long) (n - 1) * (t + 1) / nt);
+		int i, c = 0;
+
+		for (i = lo; i < hi; i++)
+			c += PS_BEFORE(v[i+1], v[i], dir);
+		offset[t+1] = c;
+
+		#pragma omp barrier
+		#pragma omp single
+		{
+			int s;
+			for (s = 0; s < nt; s++)
+				offset[s+1] += offset[s];
+			nruns += offset[nt];
+		}
+
+		c = offset[t] + 1;
+		for (i = lo; i < hi; i++)
+			if (PS_BEFORE(v[i+1], v[i], dir))
+				start[c++] = i + 1;
+	}
+
+	free(offset);
+
+	start[nruns] = n;
+	return nruns;
+}
+
+// function : presort_merge_runs()
+// description : 1. find the run starts,
+//               2. sort every group of adjacent short runs as one run
+//                  (a random tail appended to sorted keys becomes one
+//                  run instead of thousands),
+//               3. merge neighbouring runs pairwise, ping-ponging
+//                  between v and a buffer. Each pass is cut into equal
+//                  pieces of its output with merge path, so a long run
+//                  merged with a short one is split like any other.
+//---------------------------------------------------------------------
+
+static void presort_merge_runs(int *v, int n, int dir, int nthreads, int nruns)
+{
+	int *start = (int*) malloc((size_t) (nruns + 1) * sizeof(int));
+	int *tmp   = (int*) malloc((size_t) n * sizeof(int));
+	int  r, g, u;
+
+	if (start == NULL || tmp == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	// 1. run starts
+	nruns = presort_find_runs(v, n, dir, nthreads, start);
+
+	// 2. groups of short runs (serial, there are at most n/64 runs)
+	char *mixed = (char*) malloc(nruns);
+	int   big   = (nthreads > 1) ? n / (2 * nthreads) : n;
+	int   ng    = 0;
+
+	if (mixed == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	for (r = 0; r < nruns; ) {
+
+		int s = r;
+		while (r < nruns && start[r+1] - start[r] < presort_min_run)
+			r++;
+
+		if (r == s)
+			r++; // a long run on its own
+
+		mixed[ng]   = (r - s > 1);
+		start[ng++] = start[s];
+	}
+	start[ng] = n;
+	nruns = ng;
+
+	#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) schedule(dynamic,1)
+	for (g = 0; g < nruns; g++) {
+
+		int len = start[g+1] - start[g];
+
+		if (mixed[g] && len <= big)
+			qsort(v + start[g], len, sizeof(int),
+			      dir ? engine_cmp_asc : engine_cmp_des);
+	}
+
+	// groups too large for one thread get the whole pool
+	for (g = 0; g < nruns; g++) {
+
+		int len = start[g+1] - start[g];
+
+		if (mixed[g] && len > big)
+			engine_sort(v + start[g], len, dir, nthreads);
+	}
+
+	free(mixed);
+
+	// 3. pairwise merge passes
+	int *src = v, *dst = tmp;
+	int  pieces = nthreads * presort_pieces_thr;
+
+	while (nruns > 1) {
+
+		int pairs = (nruns + 1) / 2;
+
+		#pragma omp parallel for num_threads(nthreads) if(nthreads > 1) schedule(dynamic,1)
+		for (u = 0; u < pieces; u++) {
+
+			int k0 = (int) ((long long) n * u / pieces);
+			int k1 = (int) ((long long) n * (u + 1) / pieces);
+
+			// first pair that overlaps [k0,k1): binary search on its start
+			int lo = 0, hi = pairs - 1;
+			while (lo < hi) {
+				int m = (lo + hi + 1) / 2;
+				if (start[2*m] <= k0)
+					lo = m;
+				else
+					hi = m - 1;
+			}
+
+			int p;
+			for (p = lo; p < pairs && start[2*p] < k1; p++) {
+
+				int a0 = start[2*p];
+				int b0 = start[(2*p + 1 < nruns) ? 2*p + 1 : nruns];
+				int b1 = start[(2*p + 2 < nruns) ? 2*p + 2 : nruns];
+
+				int c0 = (k0 > a0) ? k0 - a0 : 0;
+				int c1 = (k1 < b1) ? k1 - a0 : b1 - a0;
+
+				merge_path_range(src + a0, b0 - a0, src + b0, b1 - b0,
+				                 dst + a0, c0, c1, dir);
+			}
+		}
+
+		// run p of the next pass is pair p of this one
+		for (r = 0; r < pairs; r++)
+			start[r] = start[2*r];
+		start[pairs] = n;
+		nruns = pairs;
+
+		int *t = src; src = dst; dst = t;
+	}
+
+	if (src != v) {
+
+		int i;
+		#pragma omp parallel for num_threads(nthreads) if(nthreads > 1)
+		for (i = 0; i < n; i++)
+			v[i] = src[i];
+	}
+
+	free(start);
+	free(tmp);
+}
@@ -0,0 +1,62 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef PRESORT_H
+#define PRESORT_H
+
+// Presortedness pre-pass, for the drivers' -presort flag and the sort
+// daemon. presort_sort() measures v[0..n) with one parallel scan and
+// finishes the sort itself when the keys are already (nearly) in order:
+//
+//   PRESORT_SORTED   nothing to do
+//   PRESORT_REVERSED one run the wrong way round, reversed in parallel
+//   PRESORT_RUNS     few natural runs, merged pairwise (merge path)
+//
+// Anything else is PRESORT_RANDOM and v is left to the full sort.
+//===========================================================
+
+#define PRESORT_RANDOM   0
+#define PRESORT_SORTED   1
+#define PRESORT_REVERSED 2
+#define PRESORT_RUNS     3
+
+struct presort_stats {
+
+	long long runs;       //maximal runs in direction dir
+	long long desc_runs;  //maximal runs in the opposite direction
+	double    inversions; //fraction of sampled pairs out of order
+	int       path;       //PRESORT_*
+};
+
+int  presort_sort  (int *v, int n, int dir, int nthreads, struct presort_stats *st);
+void presort_report(const struct presort_stats *st);
+
+static inline const char* presort_path_name(int path)
+{
+	switch (path) {
+	case PRESORT_SORTED:   return "sorted";
+	case PRESORT_REVERSED: return "reversed";
+	case PRESORT_RUNS:     return "runs";
+	default:               return "random";
+	}
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include "remap.h"
+#include "bitonic_kernels.h"
+
+
+// Function Definition
+//===========================================================
+
+// function : remap_threads()
+// description : Threads the schedule can use: the largest power of two
+//               up to nthreads with 4*T*T <= n, so that a thread's share
+//               holds at least one key of every thread in either layout.
+//---------------------------------------------------------------------
+
+int remap_threads(int n, int nthreads)
+{
+	int T = 1;
+
+	while (2 * T <= nthreads && (long long) 4 * T * T <= n)
+		T *= 2;
+
+	return T;
+}
+
+// function : remap_to_cyclic()
+// description : Thread r's part of the blocked to cyclic transpose. Key
+//               c of my block (global index r*M + c) goes to thread
+//               c % T, at local index r*(M/T) + c/T. I read my block in
+//               order and write T sequential streams, one range of M/T
+//               keys in every other thread's part.
+//---------------------------------------------------------------------
+
+void remap_to_cyclic(const int *blk, int *cyc, int n, int T, int r)
+{
+	int        M   = n / T;
+	int        Q   = M / T;
+	const int *row = blk + (long long) r * M;
+	int        q, s;
+
+	for (q = 0; q < Q; q++) {
+		for (s = 0; s < T; s++) {
+			cyc[(long long) s * M + (long long) r * Q + q] = row[q * T + s];
+		}
+	}
+}
+
+// function : remap_to_blocked()
+// description : Thread r's part of the cyclic to blocked transpose: my
+//               block is gathered from the range r*(M/T).. of every
+//               thread's part (T sequential streams) and written in order.
+//---------------------------------------------------------------------
+
+void remap_to_blocked(const int *cyc, int *blk, int n, int T, int r)
+{
+	int  M   = n / T;
+	int  Q   = M / T;
+	int *row = blk + (long long) r * M;
+	int  q, s;
+
+	for (q = 0; q < Q; q++) {
+		for (s = 0; s < T; s++) {
+			row[q * T + s] = cyc[(long long) s * M + (long long) r * Q + q];
+		}
+	}
+}
+
+// function : remap_cyclic_steps()
+// description : Steps j = k/2..T of stage k on thread s's cyclic part.
+//               Global index i = li*T + s, so distance j is local
+//               distance j/T, and these steps are full bitonic merges of
+//               the local blocks of K = k/T keys. Bit k of i is bit K of
+//               li: the blocks alternate ascending/descending.
+//---------------------------------------------------------------------
+
+void remap_cyclic_steps(int *cyc, int n, int T, int s, int k)
+{
+	int  M   = n / T;
+	int  K   = k / T;
+	int *loc = cyc + (long long) s * M;
+	int  b;
+
+	for (b = 0; b < M / K; b++)
+		kernel_merge(loc + (long long) b * K, K, (b % 2 == 0) ? 1 : 0);
+}
+
+// function : remap_blocked_steps()
+// description : Steps j = T/2..1 of stage k on thread r's block: merges
+//               of the T-key blocks, all in the direction of bit k of
+//               r*M (k > M, so it is the same for the whole block).
+//---------------------------------------------------------------------
+
+void remap_blocked_steps(int *blk, int n, int T, int r, int k)
+{
+	int  M   = n / T;
+	int *row = blk + (long long) r * M;
+	int  dir = (((long long) r * M) & k) == 0 ? 1 : 0;
+	int  x;
+
+	if (T < 2)
+		return;
+
+	for (x = 0; x < M / T; x++)
+		kernel_merge(row + (long long) x * T, T, dir);
+}
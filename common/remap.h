@@ -0,0 +1,44 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef REMAP_H
+#define REMAP_H
+
+// Blocked <-> cyclic remapping for the drivers' -remap schedule.
+//
+// T threads (a power of two, T*T <= n) own M = n/T keys each. In the
+// blocked layout thread r owns v[r*M..(r+1)*M), so the compare-exchanges
+// at distance j < M are local. In the cyclic layout (a second array of
+// n keys, thread s's part at s*M) thread s owns the keys with index
+// i % T == s, so those at distance j >= T are local. A stage k > M of
+// the sort then runs as: remap to cyclic, steps j = k/2..T as local
+// merges, remap back, steps j < T as local merges. Between the remaps
+// a thread touches only its own M keys. Every function is one thread's
+// share; the caller puts a barrier between the phases.
+//===========================================================
+
+int  remap_threads      (int n, int nthreads);
+void remap_to_cyclic    (const int *blk, int *cyc, int n, int T, int r);
+void remap_to_blocked   (const int *cyc, int *blk, int n, int T, int r);
+void remap_cyclic_steps (int *cyc, int n, int T, int s, int k);
+void remap_blocked_steps(int *blk, int n, int T, int r, int k);
+
+#endif
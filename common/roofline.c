@@ -0,0 +1,260 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "roofline.h"
+#include "bitonic_kernels.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int roofline_triad_n  = 1<<22; //doubles per triad array (32 MB)
+const int roofline_cache_n  = 1<<12; //keys per thread for the min/max peak (16 KB)
+const int roofline_cache_it = 2000;  //compare levels per thread and rep
+const int roofline_reps     = 5;     //peaks: best of this many runs
+
+#define ROOFLINE_LEVELS 32
+
+static int    roofline_threads;
+static double roofline_gbs; //triad bandwidth
+static double roofline_gcx; //compare-exchanges per ns, all threads
+
+// seconds, bytes and compare-exchanges per phase: the levels by log2
+// of the distance, then the block merges and the leaves
+static double roofline_secs [ROOFLINE_LEVELS + 2];
+static double roofline_bytes[ROOFLINE_LEVELS + 2];
+static double roofline_cx   [ROOFLINE_LEVELS + 2];
+static int    roofline_size [ROOFLINE_LEVELS + 2]; //block / leaf size
+
+#define ROOFLINE_BLOCKS ROOFLINE_LEVELS
+#define ROOFLINE_LEAVES (ROOFLINE_LEVELS + 1)
+
+
+// Function Declaration
+//===========================================================
+
+static int  roofline_log2(int);
+static void roofline_add (int, double, double, double);
+
+
+// Function Definition
+//===========================================================
+
+// function : roofline_init()
+// description : Measure the peaks with nthreads threads, the best of
+//               roofline_reps runs each:
+//               1. triad a[i] = b[i] + s*c[i] over arrays well beyond
+//                  the caches (STREAM counting: 24 bytes per i),
+//               2. each thread compares the two halves of its own 16 KB
+//                  of keys back and forth with kernel_compare_range().
+//---------------------------------------------------------------------
+
+void roofline_init(int nthreads)
+{
+	int     n = roofline_triad_n, i, r;
+	double *x;
+	int    *k;
+
+	if (nthreads < 1)
+		nthreads = 1;
+	roofline_threads = nthreads;
+
+	x = (double*) malloc(3 * (size_t) n * sizeof(double));
+	k = (int*) malloc((size_t) nthreads * roofline_cache_n * sizeof(int));
+	if (x == NULL || k == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	double *a = x, *b = x + n, *c = x + 2 * (size_t) n;
+
+	#pragma omp parallel for num_threads(nthreads) schedule(static)
+	for (i = 0; i < n; i++) {
+		a[i] = 0;
+		b[i] = i;
+		c[i] = n - i;
+	}
+
+	// 1.
+	roofline_gbs = 0;
+	for (r = 0; r < roofline_reps; r++) {
+
+		double t = omp_get_wtime();
+
+		#pragma omp parallel for num_threads(nthreads) schedule(static)
+		for (i = 0; i < n; i++)
+			a[i] = b[i] + 3.0 * c[i];
+
+		t = omp_get_wtime() - t;
+		if (t > 0 && 24.0 * n / t / 1e9 > roofline_gbs)
+			roofline_gbs = 24.0 * n / t / 1e9;
+	}
+
+	// 2.
+	roofline_gcx = 0;
+	for (r = 0; r < roofline_reps; r++) {
+
+		double t = omp_get_wtime();
+
+		#pragma omp parallel num_threads(nthreads)
+		{
+			int *v = k + (size_t) omp_get_thread_num() * roofline_cache_n;
+			int  j, h = roofline_cache_n / 2;
+
+			for (j = 0; j < roofline_cache_n; j++)
+				v[j] = (j * 2654435761u) >> 8;
+
+			for (j = 0; j < roofline_cache_it; j++)
+				kernel_compare_range(v, h, h, j & 1);
+		}
+
+		t = omp_get_wtime() - t;
+		double cx = (double) nthreads * roofline_cache_it * (roofline_cache_n / 2);
+		if (t > 0 && cx / t / 1e9 > roofline_gcx)
+			roofline_gcx = cx / t / 1e9;
+	}
+
+	memset(roofline_secs,  0, sizeof(roofline_secs));
+	memset(roofline_bytes, 0, sizeof(roofline_bytes));
+	memset(roofline_cx,    0, sizeof(roofline_cx));
+	memset(roofline_size,  0, sizeof(roofline_size));
+
+	free(x);
+	free(k);
+}
+
+// function : roofline_leaves()
+// description : The qsort leaves of size leaf covering n keys took secs.
+//---------------------------------------------------------------------
+
+void roofline_leaves(int n, int leaf, double secs)
+{
+	int l = roofline_log2(leaf);
+
+	roofline_size[ROOFLINE_LEAVES] = leaf;
+	roofline_add(ROOFLINE_LEAVES, secs, 2.0 * sizeof(int) * n * l, (double) n * l);
+}
+
+// function : roofline_level()
+// description : One compare level at distance dist over n keys took
+//               secs.
+//---------------------------------------------------------------------
+
+void roofline_level(int n, int dist, double secs)
+{
+	roofline_add(roofline_log2(dist), secs, 2.0 * sizeof(int) * n, n / 2.0);
+}
+
+// function : roofline_blocks()
+// description : The merges of the blocks of size block covering n keys
+//               (log2 block levels each) took secs.
+//---------------------------------------------------------------------
+
+void roofline_blocks(int n, int block, double secs)
+{
+	int l = roofline_log2(block);
+
+	roofline_size[ROOFLINE_BLOCKS] = block;
+	roofline_add(ROOFLINE_BLOCKS, secs, 2.0 * sizeof(int) * n * l, n / 2.0 * l);
+}
+
+// function : roofline_report()
+// description : One line per phase: time, achieved GB/s and
+//               compare-exchanges/s against the peaks, the share of
+//               the roof at the phase's intensity, and what bounds it:
+//               "cache" when it moves more bytes than the triad can
+//               (so its keys come from the cache), else "memory" or
+//               "compute" by which roof is lower at its intensity.
+//---------------------------------------------------------------------
+
+void roofline_report(void)
+{
+	int i, shown = 0;
+
+	printf("roofline: peaks triad %.2f GB/s, min/max %.2f Gcx/s (ridge %.3f cx/byte), %d threads\n",
+	       roofline_gbs, roofline_gcx, roofline_gcx / roofline_gbs, roofline_threads);
+	printf("roofline: %-16s %10s %9s %7s %9s %7s %8s %6s  %s\n",
+	       "phase", "time (s)", "GB/s", "%triad", "Gcx/s", "%peak", "cx/byte", "%roof", "bound");
+
+	// leaves, levels from the largest distance down, block merges
+	for (i = 0; i < ROOFLINE_LEVELS + 2; i++) {
+
+		int    l = (i == 0) ? ROOFLINE_LEAVES : (i > ROOFLINE_LEVELS) ? ROOFLINE_BLOCKS : ROOFLINE_LEVELS - i;
+		char   name[32];
+		double s = roofline_secs[l];
+
+		if (s <= 0 || roofline_bytes[l] <= 0)
+			continue;
+
+		if (l == ROOFLINE_LEAVES)
+			snprintf(name, sizeof(name), "leaves 2^%d", roofline_log2(roofline_size[l]));
+		else if (l == ROOFLINE_BLOCKS)
+			snprintf(name, sizeof(name), "blocks 2^%d", roofline_log2(roofline_size[l]));
+		else
+			snprintf(name, sizeof(name), "level 2^%d", l);
+
+		double gbs  = roofline_bytes[l] / s / 1e9;
+		double gcx  = roofline_cx[l] / s / 1e9;
+		double ai   = roofline_cx[l] / roofline_bytes[l];
+		double roof = (ai * roofline_gbs < roofline_gcx) ? ai * roofline_gbs : roofline_gcx;
+
+		const char *bound =
+			(gbs > roofline_gbs)                ? "cache: vectorize" :
+			(ai * roofline_gbs < roofline_gcx)  ? "memory: blocking" :
+			                                      "compute: vectorize";
+
+		printf("roofline: %-16s %10.6f %9.2f %6.0f%% %9.3f %6.0f%% %8.4f %5.0f%%  %s\n",
+		       name, s, gbs, 100.0 * gbs / roofline_gbs, gcx, 100.0 * gcx / roofline_gcx,
+		       ai, 100.0 * gcx / roof, bound);
+		shown++;
+	}
+
+	if (!shown)
+		printf("roofline: no phase timed (the sort did not run the iterative schedule)\n");
+}
+
+// function : roofline_log2()
+// description : log2 of a power of two (floor otherwise).
+//---------------------------------------------------------------------
+
+static int roofline_log2(int n)
+{
+	int l = 0;
+	while ((2 << l) <= n)
+		l++;
+	return l;
+}
+
+// function : roofline_add()
+// description : Add a run of phase l.
+//---------------------------------------------------------------------
+
+static void roofline_add(int l, double secs, double bytes, double cx)
+{
+	roofline_secs [l] += secs;
+	roofline_bytes[l] += bytes;
+	roofline_cx   [l] += cx;
+}
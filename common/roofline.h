@@ -0,0 +1,51 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef ROOFLINE_H
+#define ROOFLINE_H
+
+// Roofline of the sort phases for the OpenMP driver's -roofline flag.
+//
+// roofline_init() measures two peaks with the sort's threads, before
+// the timer starts: the memory bandwidth of a STREAM triad and the
+// compare-exchanges per second of kernel_compare_range() on data that
+// stays in L1. The iterative schedule then reports every phase with
+// its measured time; bytes and compare-exchanges come from a model:
+//
+//   level at distance d   N/2 compare-exchanges, each key read and
+//                         written once: 2*4*N bytes
+//   block merges of B     log2 B such levels over all N keys
+//   qsort leaves of L     L log2 L comparisons, log2 L passes that
+//                         read and write the leaf: 2*4*L log2 L bytes
+//
+// roofline_report() prints GB/s and compare-exchanges/s of every phase
+// against the peaks, and whether the phase is held back by memory (it
+// needs blocking) or runs from the cache or at the compute roof (it
+// needs vectorization).
+//===========================================================
+
+void roofline_init  (int nthreads);
+void roofline_leaves(int n, int leaf,  double secs);
+void roofline_level (int n, int dist,  double secs);
+void roofline_blocks(int n, int block, double secs);
+void roofline_report(void);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <omp.h>
+
+#include "sample_sort.h"
+#include "bitonic_engine.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int sample_oversampling     = 32;    //samples per bucket
+const int sample_buckets_per_thr  = 8;     //buckets per thread (load balance)
+const int sample_max_buckets      = 1<<12;
+const int sample_min_n            = 1<<16; //below this, one qsort
+
+
+// Function Declaration
+//===========================================================
+
+static void sample_build_tree(const int*, int*, int, int, int*);
+static int  sample_classify  (const int*, int, int, int);
+
+
+// Function Definition
+//===========================================================
+
+// function : sample_sort()
+// description : 1. pick nb-1 splitters from nb*oversampling samples,
+//               2. classify every key with a branch free walk down the
+//                  splitter tree, counting per thread and bucket,
+//               3. prefix sum the counts and scatter the keys into
+//                  their buckets,
+//               4. sort each bucket with the engine's leaf (qsort).
+//---------------------------------------------------------------------
+
+void sample_sort(int *v, int n, int nthreads)
+{
+	if (nthreads < 1)
+		nthreads = 1;
+
+	if (n < sample_min_n || nthreads == 1) {
+		qsort(v, n, sizeof(int), engine_cmp_asc);
+		return;
+	}
+
+	// number of buckets: a power of two, so the tree is complete
+	int nb = 2, levels = 1;
+	while (nb < nthreads * sample_buckets_per_thr && nb < sample_max_buckets) {
+		nb <<= 1;
+		levels++;
+	}
+
+	int       ns      = nb * sample_oversampling;
+	int      *samples = (int*) malloc(ns * sizeof(int));
+	int      *tree    = (int*) malloc(nb * sizeof(int));
+	int      *tmp     = (int*) malloc((size_t) n * sizeof(int));
+	uint16_t *oracle  = (uint16_t*) malloc((size_t) n * sizeof(uint16_t));
+	int      *count   = (int*) calloc((size_t) nthreads * nb, sizeof(int));
+	int      *bstart  = (int*) malloc((nb + 1) * sizeof(int));
+
+	if (samples == NULL || tree == NULL || tmp == NULL || oracle == NULL ||
+	    count == NULL || bstart == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	// 1. oversampled splitters (fixed LCG, so runs are repeatable)
+	unsigned int seed = 12345u;
+	int i, b, t;
+	for (i = 0; i < ns; i++) {
+		seed = seed * 1103515245u + 12345u;
+		samples[i] = v[(size_t) (seed >> 1) % n];
+	}
+	qsort(samples, ns, sizeof(int), engine_cmp_asc);
+
+	// splitter i is the upper bound of bucket i; keep them in samples[]
+	for (i = 0; i < nb - 1; i++)
+		samples[i] = samples[(i + 1) * sample_oversampling - 1];
+
+	int next = 0;
+	sample_build_tree(samples, tree, 1, nb, &next);
+
+	#pragma omp parallel num_threads(nthreads) private(i,b,t)
+	{
+		t = omp_get_thread_num();
+
+		int  lo  = (int) ((long long) n * t / nthreads);
+		int  hi  = (int) ((long long) n * (t + 1) / nthreads);
+		int *cnt = count + (size_t) t * nb;
+
+		// 2. classify my chunk
+		for (i = lo; i < hi; i++) {
+			b = sample_classify(tree, levels, nb, v[i]);
+			oracle[i] = (uint16_t) b;
+			cnt[b]++;
+		}
+
+		#pragma omp barrier
+
+		// 3. prefix sum: bucket-major, then thread order inside a bucket
+		#pragma omp single
+		{
+			int sum = 0, s;
+			for (b = 0; b < nb; b++) {
+				bstart[b] = sum;
+				for (s = 0; s < nthreads; s++) {
+					int c = count[(size_t) s * nb + b];
+					count[(size_t) s * nb + b] = sum;
+					sum += c;
+				}
+			}
+			bstart[nb] = sum;
+		}
+
+		for (i = lo; i < hi; i++)
+			tmp[cnt[oracle[i]]++] = v[i];
+
+		#pragma omp barrier
+
+		// 4. sort the buckets and copy them back
+		#pragma omp for schedule(dynamic,1)
+		for (b = 0; b < nb; b++) {
+
+			int len = bstart[b+1] - bstart[b];
+
+			qsort(tmp + bstart[b], len, sizeof(int), engine_cmp_asc);
+			memcpy(v + bstart[b], tmp + bstart[b], (size_t) len * sizeof(int));
+		}
+	}
+
+	free(samples);
+	free(tree);
+	free(tmp);
+	free(oracle);
+	free(count);
+	free(bstart);
+}
+
+// function : sample_build_tree()
+// description : Lay the sorted splitters out as an implicit search tree
+//               (node i has children 2i and 2i+1) by an in-order walk.
+//---------------------------------------------------------------------
+
+static void sample_build_tree(const int *splitters, int *tree, int node, int nb, int *next)
+{
+	if (node >= nb)
+		return;
+
+	sample_build_tree(splitters, tree, 2*node, nb, next);
+	tree[node] = splitters[(*next)++];
+	sample_build_tree(splitters, tree, 2*node+1, nb, next);
+}
+
+// function : sample_classify()
+// description : Bucket of key x: one step down the tree per level, the
+//               comparison result is added to the index instead of
+//               branching on it.
+//---------------------------------------------------------------------
+
+static inline int sample_classify(const int *tree, int levels, int nb, int x)
+{
+	int node = 1, l;
+
+	for (l = 0; l < levels; l++)
+		node = 2*node + (x > tree[node]);
+
+	return node - nb;
+}
@@ -0,0 +1,239 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "search_index.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int search_batch     = 16;    //queries interleaved per lookup loop
+const int search_task_deep = 6;     //tree levels built as separate tasks
+const int search_par_min   = 1<<14; //fewer queries than this, one thread
+
+
+// Function Declaration
+//===========================================================
+
+static long long search_subtree (int, int);
+static void      search_fill    (struct search_index*, const int*, int, int, int);
+static void      search_inorder (struct search_index*, const int*, int, int*);
+static void      search_batch_lb(const struct search_index*, const int*, int, int*, int);
+
+
+// Function Definition
+//===========================================================
+
+// function : search_index_build()
+// description : Lay the sorted keys out in BFS order. e is aligned so
+//               that e+16k starts a cache line. The top levels of the
+//               tree are split into tasks (the rank of a subtree's first
+//               key is known from the sizes of the subtrees before it),
+//               and each task walks its subtree in order.
+//---------------------------------------------------------------------
+
+int search_index_build(struct search_index *si, const int *sorted, int n, int nthreads)
+{
+	memset(si, 0, sizeof(*si));
+	if (n < 0)
+		return -1;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	// e line aligned, so e[16k..16k+15] is one line
+	if (posix_memalign(&si->mem, 64, ((size_t) n + 1) * sizeof(int)) != 0) {
+		si->mem = NULL;
+		return -1;
+	}
+	si->e        = (int*) si->mem;
+	si->rank     = (int*) malloc(((size_t) n + 1) * sizeof(int));
+	si->n        = n;
+	si->nthreads = nthreads;
+
+	if (si->rank == NULL) {
+		search_index_free(si);
+		return -1;
+	}
+
+	#pragma omp parallel num_threads(nthreads) if(nthreads > 1 && n >= search_par_min)
+	#pragma omp single nowait
+	search_fill(si, sorted, 1, 0, search_task_deep);
+
+	return 0;
+}
+
+// function : search_index_free()
+// description : Release the index.
+//---------------------------------------------------------------------
+
+void search_index_free(struct search_index *si)
+{
+	free(si->mem);
+	free(si->rank);
+	memset(si, 0, sizeof(*si));
+}
+
+// function : search_fill()
+// description : Fill the subtree of node k, whose smallest key is
+//               sorted[lo]: the left subtree as a task, the right one
+//               inline, down to depth levels; below that in order.
+//---------------------------------------------------------------------
+
+static void search_fill(struct search_index *si, const int *sorted, int k, int lo, int depth)
+{
+	if (k > si->n)
+		return;
+
+	if (depth == 0) {
+		search_inorder(si, sorted, k, &lo);
+		return;
+	}
+
+	int left = (int) search_subtree(2 * k, si->n);
+
+	si->e[k]    = sorted[lo + left];
+	si->rank[k] = lo + left;
+
+	#pragma omp task
+	search_fill(si, sorted, 2 * k, lo, depth - 1);
+
+	search_fill(si, sorted, 2 * k + 1, lo + left + 1, depth - 1);
+
+	#pragma omp taskwait
+}
+
+// function : search_inorder()
+// description : In-order walk of the subtree of node k, taking the
+//               sorted keys from *next on.
+//---------------------------------------------------------------------
+
+static void search_inorder(struct search_index *si, const int *sorted, int k, int *next)
+{
+	if (k > si->n)
+		return;
+
+	search_inorder(si, sorted, 2 * k, next);
+	si->e[k]    = sorted[*next];
+	si->rank[k] = (*next)++;
+	search_inorder(si, sorted, 2 * k + 1, next);
+}
+
+// function : search_subtree()
+// description : Number of nodes in the subtree of node k: the part of
+//               [k*2^d, (k+1)*2^d) within [1,n] on every level d.
+//---------------------------------------------------------------------
+
+static long long search_subtree(int k, int n)
+{
+	long long first = k, width = 1, size = 0;
+
+	while (first <= n) {
+		long long last = first + width - 1;
+		size  += ((last < n) ? last : n) - first + 1;
+		first *= 2;
+		width *= 2;
+	}
+	return size;
+}
+
+// function : search_lower_bound()
+// description : Batched lower bounds, the batches split between the
+//               threads.
+//---------------------------------------------------------------------
+
+void search_lower_bound(const struct search_index *si, const int *q, int m, int *out)
+{
+	int i;
+
+	#pragma omp parallel for num_threads(si->nthreads) if(si->nthreads > 1 && m >= search_par_min) schedule(static)
+	for (i = 0; i < m; i += search_batch) {
+		int cnt = (m - i < search_batch) ? m - i : search_batch;
+		search_batch_lb(si, q + i, cnt, out + i, 0);
+	}
+}
+
+// function : search_range_count()
+// description : Upper bound of hi minus lower bound of lo, per query.
+//---------------------------------------------------------------------
+
+void search_range_count(const struct search_index *si, const int *lo, const int *hi, int m, int *out)
+{
+	int i;
+
+	#pragma omp parallel for num_threads(si->nthreads) if(si->nthreads > 1 && m >= search_par_min) schedule(static)
+	for (i = 0; i < m; i += search_batch) {
+
+		int cnt = (m - i < search_batch) ? m - i : search_batch;
+		int lb[search_batch], j;
+
+		search_batch_lb(si, lo + i, cnt, lb, 0);
+		search_batch_lb(si, hi + i, cnt, out + i, 1);
+		for (j = 0; j < cnt; j++)
+			out[i+j] = (out[i+j] > lb[j]) ? out[i+j] - lb[j] : 0;
+	}
+}
+
+// function : search_batch_lb()
+// description : Walk cnt <= search_batch queries down the tree
+//               together, one level per step: k goes to 2k+1 when the
+//               node is before the query (< for lower bounds, <= for
+//               upper bounds), and stops once past n. The line four
+//               levels below is prefetched at every step. The answer is
+//               the last node where the walk went left: k with its
+//               trailing ones and one more bit shifted out (0 if none).
+//---------------------------------------------------------------------
+
+static void search_batch_lb(const struct search_index *si, const int *q, int cnt, int *out, int upper)
+{
+	const int *e = si->e;
+	int        n = si->n;
+	unsigned   k[search_batch];
+	int        j, more = 1;
+
+	for (j = 0; j < cnt; j++)
+		k[j] = 1;
+
+	while (more) {
+		more = 0;
+		for (j = 0; j < cnt; j++) {
+			unsigned kj = k[j];
+			if (kj <= (unsigned) n) {
+				__builtin_prefetch(e + 16 * (size_t) kj);
+				int key = e[kj];
+				int go  = upper ? (key <= q[j]) : (key < q[j]);
+				k[j] = 2 * kj + go;
+				more = 1;
+			}
+		}
+	}
+
+	for (j = 0; j < cnt; j++) {
+		int      s  = __builtin_ffs(~k[j]);
+		unsigned kj = s ? (unsigned) ((unsigned long long) k[j] >> s) : 0;
+		out[j] = kj ? si->rank[kj] : n;
+	}
+}
@@ -0,0 +1,55 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+// Search index over a sorted int array, in Eytzinger (BFS) order: node k
+// has children 2k and 2k+1, so a lookup walks down one array and the 16
+// nodes four levels below k share one cache line (16k..16k+15), which is
+// prefetched while the next three levels are compared. The lookups are
+// branch free and take queries in batches, interleaving several of them
+// level by level so that their cache misses overlap.
+//
+// search_index_build() builds the index from the sorted output of the
+// engine with nthreads OpenMP threads, which the batched lookups use
+// too. It returns 0, or -1 if it could not allocate memory.
+//===========================================================
+
+struct search_index {
+
+	int *e;        //e[1..n], the keys in BFS order (e[0] unused, e line aligned)
+	int *rank;     //rank[k], position of e[k] in the sorted array
+	int  n;
+	int  nthreads;
+	void *mem;     //allocation behind e
+};
+
+int  search_index_build(struct search_index *si, const int *sorted, int n, int nthreads);
+void search_index_free (struct search_index *si);
+
+// out[i] = first position in the sorted array with key >= q[i] (n if none)
+void search_lower_bound(const struct search_index *si, const int *q, int m, int *out);
+
+// out[i] = number of keys in [lo[i], hi[i]]
+void search_range_count(const struct search_index *si, const int *lo, const int *hi, int m, int *out);
+
+#endif
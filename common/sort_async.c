@@ -0,0 +1,531 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "sort_async.h"
+#include "bitonic_engine.h"
+#include "bitonic_kernels.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int async_block = 1<<15; //leaf and in-cache merge block (keys)
+const int async_grain = 1<<15; //pairs per task of a large merge level
+
+// phases of a sort
+#define ASYNC_LEAVES  0 //sort the blocks of async_block keys
+#define ASYNC_FLIP    1 //first level of stage k (distance k/2, mirrored)
+#define ASYNC_STRIDE  2 //level j of stage k, async_block <= j < k/2
+#define ASYNC_BLOCKS  3 //levels below async_block, one block per task
+#define ASYNC_REVERSE 4 //descending sorts only
+#define ASYNC_DONE    5
+
+struct sort_future {
+
+	int *v;
+	int  n;
+	int  dir;
+	int  n2;    //n rounded up to a power of two
+	int  B;     //block size, min(async_block, n2)
+	int  logB;
+
+	int  phase; //ASYNC_*
+	int  k;     //stage of the phase
+	int  j;     //distance of an ASYNC_STRIDE phase
+	int  tasks; //tasks of the phase
+	int  next;  //next task to hand out
+	int  ended; //tasks finished
+
+	int  levels_done;
+	int  levels_total;
+	int  done;
+
+	sort_async_callback cb;
+	void               *arg;
+	pthread_cond_t      cond;
+
+	struct sort_future *ring_next; //in-flight sorts, a ring
+	struct sort_future *ring_prev;
+}; // one submitted sort
+
+static pthread_mutex_t     async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t      async_work  = PTHREAD_COND_INITIALIZER;
+static pthread_t          *async_workers  = NULL;
+static int                 async_nworkers = 0;
+static int                 async_stop     = 0;
+static struct sort_future *async_cursor   = NULL; //next sort to give a task
+
+
+// Function Declaration
+//===========================================================
+
+static void*               async_worker (void*);
+static struct sort_future* async_pick   (void);
+static void                async_run    (struct sort_future*, int, int, int, int);
+static void                async_advance(struct sort_future*);
+static void                async_phase  (struct sort_future*, int);
+static void                async_unlink (struct sort_future*);
+
+
+// Function Definition
+//===========================================================
+
+// function : sort_async_init()
+// description : Start the pool with nworkers threads. Returns 0, or -1
+//               if a thread cannot be created.
+//---------------------------------------------------------------------
+
+int sort_async_init(int nworkers)
+{
+	int i;
+
+	if (nworkers < 1)
+		nworkers = 1;
+
+	async_workers = (pthread_t*) malloc(nworkers * sizeof(pthread_t));
+	if (async_workers == NULL)
+		return -1;
+
+	async_stop     = 0;
+	async_nworkers = 0;
+
+	for (i = 0; i < nworkers; i++) {
+		if (pthread_create(&async_workers[i], NULL, async_worker, NULL) != 0) {
+			sort_async_shutdown();
+			return -1;
+		}
+		async_nworkers++;
+	}
+
+	return 0;
+}
+
+// function : sort_async_shutdown()
+// description : Let the workers finish the sorts in flight, then stop
+//               and join them.
+//---------------------------------------------------------------------
+
+void sort_async_shutdown(void)
+{
+	int i;
+
+	pthread_mutex_lock(&async_mutex);
+	async_stop = 1;
+	pthread_cond_broadcast(&async_work);
+	pthread_mutex_unlock(&async_mutex);
+
+	for (i = 0; i < async_nworkers; i++)
+		pthread_join(async_workers[i], NULL);
+
+	free(async_workers);
+	async_workers  = NULL;
+	async_nworkers = 0;
+}
+
+// function : sort_async_submit()
+// description : Queue the sort of v[0..n) in direction dir and return
+//               its future (NULL if out of memory). cb, if not NULL, is
+//               called with arg when the keys are sorted.
+//---------------------------------------------------------------------
+
+struct sort_future* sort_async_submit(int *v, int n, int dir, sort_async_callback cb, void *arg)
+{
+	struct sort_future *f = (struct sort_future*) calloc(1, sizeof(struct sort_future));
+	if (f == NULL)
+		return NULL;
+
+	f->v   = v;
+	f->n   = (n > 0) ? n : 0;
+	f->dir = dir;
+	f->cb  = cb;
+	f->arg = arg;
+	pthread_cond_init(&f->cond, NULL);
+
+	int Q;
+	for (f->n2 = 1, Q = 0; f->n2 < f->n; f->n2 <<= 1, Q++);
+	f->B = (f->n2 < async_block) ? f->n2 : async_block;
+	for (f->logB = 0; (1 << f->logB) < f->B; f->logB++);
+	f->levels_total = Q * (Q + 1) / 2;
+
+	pthread_mutex_lock(&async_mutex);
+
+	async_phase(f, (f->n < 2) ? ASYNC_DONE : ASYNC_LEAVES);
+
+	if (f->phase == ASYNC_DONE) {
+
+		// nothing to sort
+		pthread_mutex_unlock(&async_mutex);
+		if (f->cb != NULL)
+			f->cb(f, f->arg);
+		pthread_mutex_lock(&async_mutex);
+		f->done = 1;
+	}
+	else {
+
+		// join the ring of sorts in flight, just behind the cursor
+		if (async_cursor == NULL) {
+			f->ring_next = f->ring_prev = f;
+			async_cursor = f;
+		}
+		else {
+			f->ring_next = async_cursor;
+			f->ring_prev = async_cursor->ring_prev;
+			f->ring_prev->ring_next = f;
+			async_cursor->ring_prev = f;
+		}
+		pthread_cond_broadcast(&async_work);
+	}
+
+	pthread_mutex_unlock(&async_mutex);
+
+	return f;
+}
+
+// function : sort_async_wait()
+// description : Block until the sort (and its callback) is done.
+//---------------------------------------------------------------------
+
+void sort_async_wait(struct sort_future *f)
+{
+	pthread_mutex_lock(&async_mutex);
+	while (!f->done)
+		pthread_cond_wait(&f->cond, &async_mutex);
+	pthread_mutex_unlock(&async_mutex);
+}
+
+// function : sort_async_try_wait()
+// description : 1 if the sort (and its callback) is done, else 0.
+//---------------------------------------------------------------------
+
+int sort_async_try_wait(struct sort_future *f)
+{
+	int done;
+
+	pthread_mutex_lock(&async_mutex);
+	done = f->done;
+	pthread_mutex_unlock(&async_mutex);
+
+	return done;
+}
+
+// function : sort_async_progress()
+// description : Merge levels done so far, out of log2(n2)(log2(n2)+1)/2.
+//---------------------------------------------------------------------
+
+void sort_async_progress(struct sort_future *f, int *levels_done, int *levels_total)
+{
+	pthread_mutex_lock(&async_mutex);
+	*levels_done  = f->levels_done;
+	*levels_total = f->levels_total;
+	pthread_mutex_unlock(&async_mutex);
+}
+
+// function : sort_async_release()
+// description : Wait for the sort, then free its future.
+//---------------------------------------------------------------------
+
+void sort_async_release(struct sort_future *f)
+{
+	if (f == NULL)
+		return;
+
+	sort_async_wait(f);
+	pthread_cond_destroy(&f->cond);
+	free(f);
+}
+
+// function : async_worker()
+// description : Take the next task in turn, run it outside the lock,
+//               and move its sort on when it was the last of a phase.
+//               A finished sort leaves the ring, runs its callback and
+//               only then is marked done.
+//---------------------------------------------------------------------
+
+static void* async_worker(void *ptr)
+{
+	pthread_mutex_lock(&async_mutex);
+
+	while (1) {
+
+		struct sort_future *f = async_pick();
+
+		if (f == NULL) {
+			if (async_stop)
+				break;
+			pthread_cond_wait(&async_work, &async_mutex);
+			continue;
+		}
+
+		int task  = f->next++;
+		int phase = f->phase;
+		int k     = f->k;
+		int j     = f->j;
+
+		pthread_mutex_unlock(&async_mutex);
+		async_run(f, phase, k, j, task);
+		pthread_mutex_lock(&async_mutex);
+
+		if (++f->ended < f->tasks)
+			continue;
+
+		async_advance(f);
+
+		if (f->phase == ASYNC_DONE) {
+
+			async_unlink(f);
+
+			pthread_mutex_unlock(&async_mutex);
+			if (f->cb != NULL)
+				f->cb(f, f->arg);
+			pthread_mutex_lock(&async_mutex);
+
+			f->done = 1;
+			pthread_cond_broadcast(&f->cond);
+		}
+		else {
+			pthread_cond_broadcast(&async_work);
+		}
+	}
+
+	pthread_mutex_unlock(&async_mutex);
+
+	return NULL;
+}
+
+// function : async_pick()
+// description : The first sort from the cursor on with a task left in
+//               its phase; the cursor moves past it, so the sorts in
+//               flight get their tasks in turn. Called with the lock.
+//---------------------------------------------------------------------
+
+static struct sort_future* async_pick(void)
+{
+	struct sort_future *f = async_cursor;
+
+	if (f == NULL)
+		return NULL;
+
+	do {
+		if (f->next < f->tasks) {
+			async_cursor = f->ring_next;
+			return f;
+		}
+		f = f->ring_next;
+	} while (f != async_cursor);
+
+	return NULL;
+}
+
+// function : async_unlink()
+// description : Take a finished sort out of the ring. Called with the
+//               lock.
+//---------------------------------------------------------------------
+
+static void async_unlink(struct sort_future *f)
+{
+	if (f->ring_next == f) {
+		async_cursor = NULL;
+	}
+	else {
+		f->ring_prev->ring_next = f->ring_next;
+		f->ring_next->ring_prev = f->ring_prev;
+		if (async_cursor == f)
+			async_cursor = f->ring_next;
+	}
+	f->ring_next = f->ring_prev = NULL;
+}
+
+// function : async_phase()
+// description : Enter a phase and count its tasks. Called with the lock.
+//---------------------------------------------------------------------
+
+static void async_phase(struct sort_future *f, int phase)
+{
+	int blocks = (f->n + f->B - 1) / f->B;
+	int pairs  = (f->n2 / 2 + async_grain - 1) / async_grain;
+
+	f->phase = phase;
+	f->next  = 0;
+	f->ended = 0;
+
+	switch (phase) {
+	case ASYNC_LEAVES:
+	case ASYNC_BLOCKS:  f->tasks = blocks; break;
+	case ASYNC_FLIP:
+	case ASYNC_STRIDE:  f->tasks = pairs;  break;
+	case ASYNC_REVERSE: f->tasks = (f->n / 2 + async_grain - 1) / async_grain; break;
+	default:            f->tasks = 0;      break;
+	}
+}
+
+// function : async_advance()
+// description : All tasks of the phase are done: count its levels and
+//               enter the next one. Stage k is the mirrored level, the
+//               levels k/4..B, then the block merges. Called with the
+//               lock.
+//---------------------------------------------------------------------
+
+static void async_advance(struct sort_future *f)
+{
+	int last = (f->dir == ENGINE_DESCENDING) ? ASYNC_REVERSE : ASYNC_DONE;
+
+	switch (f->phase) {
+
+	case ASYNC_LEAVES:
+		f->levels_done += f->logB * (f->logB + 1) / 2;
+		f->k = 2 * f->B;
+		async_phase(f, (f->k <= f->n2) ? ASYNC_FLIP : last);
+		break;
+
+	case ASYNC_FLIP:
+	case ASYNC_STRIDE:
+		f->levels_done++;
+		f->j = (f->phase == ASYNC_FLIP) ? f->k / 4 : f->j / 2;
+		async_phase(f, (f->j >= f->B) ? ASYNC_STRIDE : ASYNC_BLOCKS);
+		break;
+
+	case ASYNC_BLOCKS:
+		f->levels_done += f->logB;
+		f->k *= 2;
+		async_phase(f, (f->k <= f->n2) ? ASYNC_FLIP : last);
+		break;
+
+	default:
+		async_phase(f, ASYNC_DONE);
+		break;
+	}
+}
+
+// function : async_run()
+// description : One task. Keys at n and beyond do not exist; they count
+//               as +infinity, so every comparator that reaches them is
+//               skipped.
+//---------------------------------------------------------------------
+
+static void async_run(struct sort_future *f, int phase, int k, int j, int task)
+{
+	int      *v  = f->v;
+	int       n  = f->n;
+	int       B  = f->B;
+	long long p0 = (long long) task * async_grain;
+	long long p1 = p0 + async_grain;
+	long long p, i;
+
+	switch (phase) {
+
+	case ASYNC_LEAVES: {
+
+		// block task, ascending (all comparators are)
+		long long s   = (long long) task * B;
+		int       len = (s + B <= n) ? B : (int) (n - s);
+
+		if (len == B)
+			kernel_sort(v + s, B, ENGINE_ASCENDING);
+		else
+			qsort(v + s, len, sizeof(int), engine_cmp_asc);
+		break;
+	}
+
+	case ASYNC_FLIP:
+
+		// pair p: position t = p % (k/2) of block p / (k/2), against
+		// position k-1-t of the same block
+		if (p1 > f->n2 / 2)
+			p1 = f->n2 / 2;
+
+		for (p = p0; p < p1; ) {
+
+			long long s   = (p / (k / 2)) * k;
+			long long t   = p % (k / 2);
+			long long run = k / 2 - t;
+			if (run > p1 - p)
+				run = p1 - p;
+
+			// partners below n: k-1-t < n-s
+			long long t0 = (s + k - n > t) ? s + k - n : t;
+			if (t0 < t + run)
+				kernel_compare_flip(v + s + t0, v + s + k - 1 - t0, (int) (t + run - t0), ENGINE_ASCENDING);
+
+			p += run;
+		}
+		break;
+
+	case ASYNC_STRIDE:
+
+		// pair p: (i, i+j) with i = (p/j)*2j + p%j
+		if (p1 > f->n2 / 2)
+			p1 = f->n2 / 2;
+
+		for (p = p0; p < p1; ) {
+
+			long long run = j - p % j;
+			if (run > p1 - p)
+				run = p1 - p;
+
+			i = (p / j) * 2 * j + p % j;
+
+			long long cnt = (i + j + run <= n) ? run : n - j - i;
+			if (cnt > 0)
+				kernel_compare_range(v + i, (int) cnt, j, ENGINE_ASCENDING);
+
+			p += run;
+		}
+		break;
+
+	case ASYNC_BLOCKS: {
+
+		long long s   = (long long) task * B;
+		int       len = (s + B <= n) ? B : (int) (n - s);
+
+		if (len == B) {
+			kernel_merge(v + s, B, ENGINE_ASCENDING);
+		}
+		else {
+
+			// the last, partial block, level by level
+			int d, x;
+			for (d = B / 2; d >= 1; d /= 2) {
+				for (x = 0; x + d < len; x += 2 * d) {
+					int cnt = (x + 2 * d <= len) ? d : len - x - d;
+					kernel_compare_range(v + s + x, cnt, d, ENGINE_ASCENDING);
+				}
+			}
+		}
+		break;
+	}
+
+	case ASYNC_REVERSE:
+
+		if (p1 > n / 2)
+			p1 = n / 2;
+
+		for (p = p0; p < p1; p++) {
+			int tmp      = v[p];
+			v[p]         = v[n - 1 - p];
+			v[n - 1 - p] = tmp;
+		}
+		break;
+	}
+}
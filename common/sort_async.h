@@ -0,0 +1,56 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef SORT_ASYNC_H
+#define SORT_ASYNC_H
+
+// Asynchronous sorts on a shared worker pool.
+//
+// sort_async_submit() queues v[0..n) (any n) and returns at once with a
+// future. The sort is cut into phases of small tasks: the leaf blocks,
+// then one phase per level of the large merges, then the in-cache block
+// merges of each stage. The workers take one task at a time from the
+// in-flight sorts in turn, so concurrent sorts share the pool fairly.
+// A sort that finishes calls its callback (on a worker thread) before
+// sort_async_wait()/sort_async_try_wait() report it done, and
+// sort_async_progress() can be polled for the levels done so far. The
+// caller owns the future and releases it once the sort is done.
+//
+// n need not be a power of two: all comparators are ascending (the
+// first level of a merge compares each half against the other one read
+// backwards), so the missing keys of the padded size act as +infinity
+// and their comparators are skipped. Descending sorts are reversed at
+// the end.
+//===========================================================
+
+struct sort_future;
+
+typedef void (*sort_async_callback)(struct sort_future *f, void *arg);
+
+int                 sort_async_init    (int nworkers);
+void                sort_async_shutdown(void);
+struct sort_future* sort_async_submit  (int *v, int n, int dir, sort_async_callback cb, void *arg);
+void                sort_async_wait    (struct sort_future *f);
+int                 sort_async_try_wait(struct sort_future *f);
+void                sort_async_progress(struct sort_future *f, int *levels_done, int *levels_total);
+void                sort_async_release (struct sort_future *f);
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "sort_dispatch.h"
+#include "bitonic_kernels.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int dispatch_calib_q    = 13; //2^13 keys for the sort probes
+const int dispatch_calib_thr  = 4;  //threads started per probe round
+const int dispatch_calib_reps = 5;  //best of this many rounds
+
+struct dispatch_model {
+
+	double sort_ns [DISPATCH_KEYS]; //serial kernel sort, per key and level
+	double qsort_ns[DISPATCH_KEYS]; //qsort, per key and log2 n
+	double thread_ns;               //start and join one thread
+	int    cores;     //cores the process may run on
+}; // measured once per process
+
+static struct dispatch_model dispatch_m;
+static pthread_once_t        dispatch_once = PTHREAD_ONCE_INIT;
+
+
+// Function Declaration
+//===========================================================
+
+static void   dispatch_measure(void);
+static void   dispatch_fill   (int*, struct kernel_kv*, int, unsigned int*);
+static void*  dispatch_noop   (void*);
+static double dispatch_now    (void);
+static double dispatch_levels (long long);
+static int    dispatch_log2   (long long);
+static int    dispatch_cmp    (const void*, const void*);
+static int    dispatch_cmp_kv (const void*, const void*);
+
+
+// Function Definition
+//===========================================================
+
+// function : dispatch_calibrate()
+// description : Measure the cost model (only the first call does).
+//               Programs call it before timing so that the probe is not
+//               charged to the first sort.
+//---------------------------------------------------------------------
+
+void dispatch_calibrate(void)
+{
+	pthread_once(&dispatch_once, dispatch_measure);
+}
+
+// function : dispatch_plan()
+// description : Cheapest thread count for n keys of type key, on a
+//               backend whose leaves are sorted by leaf.
+//---------------------------------------------------------------------
+
+struct dispatch_plan dispatch_plan(long long n, int key, int leaf, int max_threads)
+{
+	struct dispatch_plan plan;
+
+	dispatch_calibrate();
+
+	if (max_threads < 1)
+		max_threads = 1;
+
+	int limit = (max_threads < dispatch_m.cores) ? max_threads : dispatch_m.cores;
+
+	double sort_ns  = dispatch_m.sort_ns [key] * 1e-9;
+	double qsort_ns = dispatch_m.qsort_ns[key] * 1e-9;
+	double levels   = dispatch_levels(n);
+
+	double serial = ((n & (n - 1)) == 0) ? sort_ns  * (double) n * levels
+	                                     : qsort_ns * (double) n * dispatch_log2(n);
+
+	plan.threads  = 1;
+	plan.estimate = serial;
+	plan.key      = key;
+	plan.leaf     = leaf;
+
+	int t;
+	for (t = 2; t <= limit; t = (t < limit && 2*t > limit) ? limit : 2*t) {
+
+		// leaves of about n/4t keys, then the merge levels above them
+		long long b   = n / (4LL * t);
+		double    lvl = dispatch_levels(b < 2 ? 2 : b);
+		double    lf  = (leaf == DISPATCH_LEAF_QSORT) ? qsort_ns * (double) n * dispatch_log2(b)
+		                                              : sort_ns  * (double) n * lvl;
+		double    mrg = sort_ns * (double) n * (levels - lvl);
+
+		double par = (lf + mrg) / t + t * dispatch_m.thread_ns * 1e-9;
+
+		if (par < plan.estimate) {
+			plan.threads  = t;
+			plan.estimate = par;
+		}
+	}
+
+	if (plan.threads == 1)
+		plan.path = DISPATCH_SERIAL;
+	else if (plan.threads < max_threads)
+		plan.path = DISPATCH_LIMITED;
+	else
+		plan.path = DISPATCH_PARALLEL;
+
+	return plan;
+}
+
+// function : dispatch_report()
+// description : One line with the plan and the model behind it.
+//---------------------------------------------------------------------
+
+void dispatch_report(const struct dispatch_plan *plan)
+{
+	printf("dispatch: %s, %d threads, predicted %lf s (%.3lf ns per key and level, %s leaves %.3lf ns, %.1lf us per thread, %d cores)\n",
+	       dispatch_path_name(plan->path), plan->threads, plan->estimate,
+	       dispatch_m.sort_ns[plan->key],
+	       (plan->leaf == DISPATCH_LEAF_QSORT) ? "qsort" : "kernel",
+	       (plan->leaf == DISPATCH_LEAF_QSORT) ? dispatch_m.qsort_ns[plan->key] : dispatch_m.sort_ns[plan->key],
+	       dispatch_m.thread_ns * 1e-3, dispatch_m.cores);
+}
+
+// function : dispatch_measure()
+// description : Best of a few rounds each: kernel_sort and qsort of
+//               2^13 random keys of either type, and starting/joining a
+//               few no-op threads.
+//---------------------------------------------------------------------
+
+static void dispatch_measure(void)
+{
+	// cores this process may run on (cpusets, taskset), else online
+	cpu_set_t set;
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		cores = CPU_COUNT(&set);
+	dispatch_m.cores = (cores < 1) ? 1 : (int) cores;
+
+	int  n = 1 << dispatch_calib_q;
+	int *v = (int*) malloc(n * sizeof(int));
+	struct kernel_kv *kv = (struct kernel_kv*) malloc(n * sizeof(struct kernel_kv));
+	pthread_t th[dispatch_calib_thr];
+
+	if (v == NULL || kv == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	unsigned int seed = 12345u;
+	double best_sort[DISPATCH_KEYS]  = { 1e30, 1e30 };
+	double best_qsort[DISPATCH_KEYS] = { 1e30, 1e30 };
+	double best_thr = 1e30, t0, t1;
+	int r, i;
+
+	for (r = 0; r < dispatch_calib_reps; r++) {
+
+		// the serial and merge kernel
+		dispatch_fill(v, kv, n, &seed);
+
+		t0 = dispatch_now();
+		kernel_sort(v, n, 1);
+		t1 = dispatch_now();
+		if (t1 - t0 < best_sort[DISPATCH_KEY_INT])
+			best_sort[DISPATCH_KEY_INT] = t1 - t0;
+
+		t0 = dispatch_now();
+		kernel_sort_kv(kv, n, 1);
+		t1 = dispatch_now();
+		if (t1 - t0 < best_sort[DISPATCH_KEY_KV])
+			best_sort[DISPATCH_KEY_KV] = t1 - t0;
+
+		// the qsort leaves
+		dispatch_fill(v, kv, n, &seed);
+
+		t0 = dispatch_now();
+		qsort(v, n, sizeof(int), dispatch_cmp);
+		t1 = dispatch_now();
+		if (t1 - t0 < best_qsort[DISPATCH_KEY_INT])
+			best_qsort[DISPATCH_KEY_INT] = t1 - t0;
+
+		t0 = dispatch_now();
+		qsort(kv, n, sizeof(struct kernel_kv), dispatch_cmp_kv);
+		t1 = dispatch_now();
+		if (t1 - t0 < best_qsort[DISPATCH_KEY_KV])
+			best_qsort[DISPATCH_KEY_KV] = t1 - t0;
+
+		t0 = dispatch_now();
+		for (i = 0; i < dispatch_calib_thr; i++)
+			if (pthread_create(&th[i], NULL, dispatch_noop, NULL) != 0)
+				break;
+		int started = i;
+		for (i = 0; i < started; i++)
+			pthread_join(th[i], NULL);
+		t1 = dispatch_now();
+
+		if (started > 0 && (t1 - t0) / started < best_thr)
+			best_thr = (t1 - t0) / started;
+	}
+
+	free(v);
+	free(kv);
+
+	for (i = 0; i < DISPATCH_KEYS; i++) {
+		dispatch_m.sort_ns[i]  = best_sort[i]  * 1e9 / ((double) n * dispatch_levels(n));
+		dispatch_m.qsort_ns[i] = best_qsort[i] * 1e9 / ((double) n * dispatch_calib_q);
+	}
+	dispatch_m.thread_ns = (best_thr < 1e30) ? best_thr * 1e9 : 1e9;
+}
+
+// function : dispatch_fill()
+// description : Fresh random keys for the probes, the same in both
+//               types.
+//---------------------------------------------------------------------
+
+static void dispatch_fill(int *v, struct kernel_kv *kv, int n, unsigned int *seed)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		*seed = *seed * 1103515245u + 12345u;
+		v[i]      = (int) (*seed >> 1);
+		kv[i].key = *seed >> 1;
+		kv[i].val = i;
+	}
+}
+
+// function : dispatch_levels()
+// description : Compare levels per key of a bitonic sort, L(L+1)/2.
+//---------------------------------------------------------------------
+
+static double dispatch_levels(long long n)
+{
+	int l = 0;
+	while ((1LL << l) < n)
+		l++;
+
+	return (l < 1) ? 1.0 : l * (l + 1) / 2.0;
+}
+
+// function : dispatch_log2()
+// description : Levels of a comparison sort of n keys, ceil(log2 n).
+//---------------------------------------------------------------------
+
+static int dispatch_log2(long long n)
+{
+	int l = 0;
+	while ((1LL << l) < n)
+		l++;
+
+	return (l < 1) ? 1 : l;
+}
+
+// function : dispatch_cmp()
+// description : qsort order of the int probe.
+//---------------------------------------------------------------------
+
+static int dispatch_cmp(const void *x, const void *y)
+{
+	int p = *(const int*) x, q = *(const int*) y;
+	return (p > q) - (p < q);
+}
+
+// function : dispatch_cmp_kv()
+// description : qsort order of the key-value probe (key, then val).
+//---------------------------------------------------------------------
+
+static int dispatch_cmp_kv(const void *x, const void *y)
+{
+	const struct kernel_kv *p = x, *q = y;
+	if (p->key != q->key)
+		return (p->key > q->key) - (p->key < q->key);
+	return (p->val > q->val) - (p->val < q->val);
+}
+
+// function : dispatch_noop()
+// description : Body of the probe threads.
+//---------------------------------------------------------------------
+
+static void* dispatch_noop(void *ptr)
+{
+	return ptr;
+}
+
+// function : dispatch_now()
+// description : Monotonic time in seconds.
+//---------------------------------------------------------------------
+
+static double dispatch_now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
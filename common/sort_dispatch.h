@@ -0,0 +1,81 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef SORT_DISPATCH_H
+#define SORT_DISPATCH_H
+
+// Size and hardware aware dispatcher in front of the backends. It picks
+// the number of threads for a sort of n keys from a cost model measured
+// once per process on this machine, for each key type:
+//
+//   serial(n)   = sort_ns * n * L(L+1)/2                    (L = log2 n)
+//   par(n, T)   = (leaf(n, b) + sort_ns * n * (L(L+1)/2 - l(l+1)/2)) / T
+//               + T * thread_ns                      (b = 2^l = n/4T)
+//
+// sort_ns is the serial vectorized bitonic sort (kernel_sort) per key
+// and level, which is what runs inline and in the merges. The parallel
+// backends first sort leaves of about b keys with their own leaf
+// kernel: leaf(n, b) is sort_ns * n * l(l+1)/2 for the bitonic kernels
+// and qsort_ns * n * l for qsort, each measured on that key type.
+// thread_ns is the cost to start and join one thread. T runs over the
+// powers of two below min(max_threads, usable cores) and that bound
+// itself (which need not be a power of two). An n that is not a power
+// of two is sorted inline by qsort, and costs qsort_ns * n * L.
+//
+//   DISPATCH_SERIAL   T = 1: sort inline with kernel_sort, no team
+//   DISPATCH_LIMITED  1 < T < max_threads
+//   DISPATCH_PARALLEL T = max_threads: the full parallel engine
+//===========================================================
+
+#define DISPATCH_SERIAL   0
+#define DISPATCH_LIMITED  1
+#define DISPATCH_PARALLEL 2
+
+#define DISPATCH_KEY_INT  0 //int keys
+#define DISPATCH_KEY_KV   1 //struct kernel_kv records
+#define DISPATCH_KEYS     2
+
+#define DISPATCH_LEAF_KERNEL 0 //leaves sorted by the bitonic kernels
+#define DISPATCH_LEAF_QSORT  1 //leaves sorted by qsort
+
+struct dispatch_plan {
+
+	int    path;     //DISPATCH_*
+	int    threads;  //threads to sort with
+	double estimate; //predicted seconds
+	int    key;      //DISPATCH_KEY_*
+	int    leaf;     //DISPATCH_LEAF_* of the backend
+};
+
+void                 dispatch_calibrate(void);
+struct dispatch_plan dispatch_plan     (long long n, int key, int leaf, int max_threads);
+void                 dispatch_report   (const struct dispatch_plan *plan);
+
+static inline const char* dispatch_path_name(int path)
+{
+	switch (path) {
+	case DISPATCH_SERIAL:  return "serial";
+	case DISPATCH_LIMITED: return "limited";
+	default:               return "parallel";
+	}
+}
+
+#endif
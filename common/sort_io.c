@@ -0,0 +1,652 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "sort_io.h"
+
+
+// Constants & Variables
+//===========================================================
+
+#define IO_ALIGN   4096     //O_DIRECT alignment of buffers, offsets and sizes
+#define IO_BLOCK   (1<<20)  //bytes per read/write request
+#define IO_DEPTH   32       //requests in flight
+
+struct uring {
+
+	int fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void  *sq_ptr, *cq_ptr;
+	size_t sq_len, cq_len, sqes_len;
+}; // a raw io_uring instance (no liburing)
+
+struct io_state {
+
+	int    direct;      //direct mode (otherwise mmap)
+	int    out_fd;      //file the sorted keys end up in
+	char  *buf;         //keys (mapping or aligned buffer)
+	size_t bytes;       //file size
+	size_t map_bytes;   //mapping/buffer size
+
+	// background read (direct mode)
+	int    in_fd;
+	int    o_direct;    //in_fd really bypasses the page cache
+	int    use_uring;
+	int    nblocks;
+	unsigned char *loaded; //per block: read completed
+	int    pending;     //reads not yet completed
+	pthread_t reader;
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;
+
+	// statistics
+	double t_open;
+	double read_time;   //open -> all keys in memory
+	double write_time;  //sorted keys -> file
+	double wait_time;   //time the leaves spent waiting for reads
+};
+
+static struct io_state io;
+static int io_active = 0; //a background read is running
+
+static const char *out_path = NULL; //where the sorted keys go
+
+
+// Function Declaration
+//===========================================================
+
+static int    map_open      (const char*, const char*);
+static int    direct_open   (const char*);
+static void*  direct_reader (void*);
+static void   direct_write  (void);
+static int    uring_init    (struct uring*, unsigned);
+static void   uring_exit    (struct uring*);
+static void   uring_prep    (struct uring*, int, int, char*, size_t, off_t, unsigned long long);
+static int    uring_reap    (struct uring*, unsigned long long*, int*);
+static int    block_range   (int, size_t*, size_t*);
+static double io_now        (void);
+
+
+// Function Definition
+//===========================================================
+
+// function : sort_io_keys()
+// description : Number of int keys in the file, -1 if it cannot be
+//               used (missing, not a whole number of keys).
+//---------------------------------------------------------------------
+
+int sort_io_keys(const char *in)
+{
+	struct stat st;
+
+	if (stat(in, &st) != 0 || st.st_size % sizeof(int) != 0 ||
+	    st.st_size / sizeof(int) > 0x7fffffff)
+		return -1;
+
+	return (int) (st.st_size / sizeof(int));
+}
+
+// function : sort_io_open()
+// description : Make the n keys of in available for sorting. The result
+//               is written to out (or back to in) by sort_io_close().
+//---------------------------------------------------------------------
+
+int* sort_io_open(const char *in, const char *out, int direct, int n)
+{
+	memset(&io, 0, sizeof(io));
+	io.direct = direct;
+	io.bytes  = (size_t) n * sizeof(int);
+	io.t_open = io_now();
+	out_path  = (out != NULL) ? out : in;
+
+	int ok = direct ? direct_open(in) : map_open(in, out);
+	if (!ok) {
+		printf("Error opening %s.\n", in);
+		exit(4);
+	}
+
+	return (int*) io.buf;
+}
+
+// function : map_open()
+// description : mmap mode. With an output file the input is copied to
+//               it inside the kernel (copy_file_range), then the output
+//               is mapped shared and populated up front; the sort runs
+//               in place on those pages.
+//---------------------------------------------------------------------
+
+static int map_open(const char *in, const char *out)
+{
+	int in_fd = open(in, (out == NULL) ? O_RDWR : O_RDONLY);
+	if (in_fd < 0)
+		return 0;
+
+	if (out == NULL) {
+		io.out_fd = in_fd;
+	}
+	else {
+
+		io.out_fd = open(out, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (io.out_fd < 0 || ftruncate(io.out_fd, io.bytes) != 0)
+			return 0;
+
+		size_t done = 0;
+		while (done < io.bytes) {
+
+			ssize_t r = copy_file_range(in_fd, NULL, io.out_fd, NULL, io.bytes - done, 0);
+			if (r <= 0)
+				break;
+			done += r;
+		}
+
+		// no copy_file_range (e.g. across filesystems): plain copy
+		if (done < io.bytes) {
+
+			char *tmp = (char*) malloc(IO_BLOCK);
+			if (tmp == NULL)
+				return 0;
+
+			while (done < io.bytes) {
+				ssize_t r = pread(in_fd, tmp, IO_BLOCK, done);
+				if (r <= 0 || pwrite(io.out_fd, tmp, r, done) != r) {
+					free(tmp);
+					return 0;
+				}
+				done += r;
+			}
+			free(tmp);
+		}
+
+		close(in_fd);
+	}
+
+	io.map_bytes = (io.bytes > 0) ? io.bytes : 1;
+	io.buf = (char*) mmap(NULL, io.map_bytes, PROT_READ | PROT_WRITE,
+	                      MAP_SHARED | MAP_POPULATE, io.out_fd, 0);
+	if (io.buf == MAP_FAILED)
+		return 0;
+
+	// the sort touches the whole file several times
+	madvise(io.buf, io.map_bytes, MADV_WILLNEED);
+	madvise(io.buf, io.map_bytes, MADV_HUGEPAGE);
+
+	io.read_time = io_now() - io.t_open;
+
+	return 1;
+}
+
+// function : direct_open()
+// description : direct mode. Allocate an aligned buffer and start the
+//               background reader.
+//---------------------------------------------------------------------
+
+static int direct_open(const char *in)
+{
+	io.o_direct = 1;
+	io.in_fd = open(in, O_RDONLY | O_DIRECT);
+	if (io.in_fd < 0) {
+
+		// e.g. tmpfs has no O_DIRECT: keep going through the page cache
+		io.o_direct = 0;
+		io.in_fd = open(in, O_RDONLY);
+		if (io.in_fd < 0)
+			return 0;
+		posix_fadvise(io.in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+
+	io.map_bytes = (io.bytes + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN;
+	if (io.map_bytes == 0)
+		io.map_bytes = IO_ALIGN;
+
+	if (posix_memalign((void**) &io.buf, IO_ALIGN, io.map_bytes) != 0)
+		return 0;
+
+	// some filesystems accept the flag but reject the reads
+	if (io.o_direct && pread(io.in_fd, io.buf, IO_ALIGN, 0) < 0 && errno == EINVAL) {
+		close(io.in_fd);
+		io.o_direct = 0;
+		io.in_fd = open(in, O_RDONLY);
+		if (io.in_fd < 0)
+			return 0;
+	}
+
+	io.nblocks = (int) ((io.bytes + IO_BLOCK - 1) / IO_BLOCK);
+	io.pending = io.nblocks;
+	io.loaded  = (unsigned char*) calloc(io.nblocks + 1, 1);
+	if (io.loaded == NULL)
+		return 0;
+
+	pthread_mutex_init(&io.mutex, NULL);
+	pthread_cond_init(&io.cond, NULL);
+
+	io_active = 1;
+	if (pthread_create(&io.reader, NULL, direct_reader, NULL) != 0)
+		return 0;
+
+	return 1;
+}
+
+// function : direct_reader()
+// description : Read all blocks, IO_DEPTH at a time, and publish every
+//               completed block to sort_io_wait().
+//---------------------------------------------------------------------
+
+static void* direct_reader(void *ptr)
+{
+	struct uring ring;
+	int next = 0, inflight = 0;
+
+	io.use_uring = uring_init(&ring, IO_DEPTH);
+
+	while (next < io.nblocks || inflight > 0) {
+
+		if (io.use_uring) {
+
+			// keep the queue full
+			int queued = 0;
+			while (next < io.nblocks && inflight < IO_DEPTH) {
+
+				size_t off, len;
+				block_range(next, &off, &len);
+				len = (len + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN;
+				uring_prep(&ring, IORING_OP_READ, io.in_fd, io.buf + off, len, off, next);
+				next++; inflight++; queued++;
+			}
+
+			if (syscall(__NR_io_uring_enter, ring.fd, queued, 1,
+			            IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+				printf("io_uring_enter failed: %s\n", strerror(errno));
+				exit(4);
+			}
+
+			unsigned long long id;
+			int res;
+			while (uring_reap(&ring, &id, &res)) {
+
+				size_t off, len;
+				block_range((int) id, &off, &len);
+				if (res < 0 || (off + res < io.bytes && (size_t) res < len)) {
+					printf("Error reading block %llu: %s\n", id, strerror(-res));
+					exit(4);
+				}
+
+				inflight--;
+				pthread_mutex_lock(&io.mutex);
+				__atomic_store_n(&io.loaded[id], 1, __ATOMIC_RELEASE);
+				io.pending--;
+				pthread_cond_broadcast(&io.cond);
+				pthread_mutex_unlock(&io.mutex);
+			}
+		}
+		else {
+
+			size_t off, len;
+			block_range(next, &off, &len);
+			len = (len + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN;
+
+			size_t done = 0;
+			while (done < len) {
+				ssize_t r = pread(io.in_fd, io.buf + off + done, len - done, off + done);
+				if (r < 0) {
+					printf("Error reading block %d: %s\n", next, strerror(errno));
+					exit(4);
+				}
+				if (r == 0)
+					break;
+				done += r;
+			}
+
+			pthread_mutex_lock(&io.mutex);
+			__atomic_store_n(&io.loaded[next], 1, __ATOMIC_RELEASE);
+			io.pending--;
+			pthread_cond_broadcast(&io.cond);
+			pthread_mutex_unlock(&io.mutex);
+			next++;
+		}
+	}
+
+	if (io.use_uring)
+		uring_exit(&ring);
+
+	close(io.in_fd);
+	io.read_time = io_now() - io.t_open;
+
+	return NULL;
+}
+
+// function : sort_io_wait()
+// description : Block until keys [lo,lo+cnt) have been read. Returns at
+//               once in mmap mode or when everything is loaded.
+//---------------------------------------------------------------------
+
+void sort_io_wait(int lo, int cnt)
+{
+	if (!io_active || cnt <= 0)
+		return;
+
+	int b0 = (int) ((size_t) lo * sizeof(int) / IO_BLOCK);
+	int b1 = (int) (((size_t) (lo + cnt) * sizeof(int) - 1) / IO_BLOCK);
+	int b;
+
+	// fast path: the small leaves call this often
+	for (b = b0; b <= b1; b++)
+		if (!__atomic_load_n(&io.loaded[b], __ATOMIC_ACQUIRE))
+			break;
+	if (b > b1)
+		return;
+
+	pthread_mutex_lock(&io.mutex);
+
+	double t0 = 0;
+	for (b = b0; b <= b1; b++) {
+		while (!io.loaded[b]) {
+			if (t0 == 0)
+				t0 = io_now();
+			pthread_cond_wait(&io.cond, &io.mutex);
+		}
+	}
+	if (t0 != 0)
+		io.wait_time += io_now() - t0;
+
+	pthread_mutex_unlock(&io.mutex);
+}
+
+// function : sort_io_close()
+// description : Store the sorted keys (msync of the mapping, or direct
+//               writes) and release everything.
+//---------------------------------------------------------------------
+
+void sort_io_close(int *v, int n)
+{
+	double t0;
+
+	if (io.direct) {
+
+		// the reader has finished once every leaf has been sorted, but
+		// wait for it anyway (e.g. n smaller than a leaf)
+		sort_io_wait(0, n);
+		pthread_join(io.reader, NULL);
+		io_active = 0;
+
+		t0 = io_now();
+		direct_write();
+		io.write_time = io_now() - t0;
+
+		pthread_mutex_destroy(&io.mutex);
+		pthread_cond_destroy(&io.cond);
+		free(io.loaded);
+		free(io.buf);
+	}
+	else {
+
+		t0 = io_now();
+		msync(io.buf, io.map_bytes, MS_SYNC);
+		io.write_time = io_now() - t0;
+
+		munmap(io.buf, io.map_bytes);
+		close(io.out_fd);
+	}
+}
+
+// function : direct_write()
+// description : Write the buffer to the output (the input file when
+//               there is no --out) with O_DIRECT, through io_uring when
+//               possible. The buffer is padded to IO_ALIGN,
+//               so the file is truncated to the real size afterwards.
+//---------------------------------------------------------------------
+
+static void direct_write(void)
+{
+	const char *path = out_path;
+	struct uring ring;
+	int next = 0, inflight = 0;
+
+	io.out_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+	if (io.out_fd < 0)
+		io.out_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (io.out_fd < 0) {
+		printf("Error creating %s.\n", path);
+		exit(4);
+	}
+
+	int use_uring = uring_init(&ring, IO_DEPTH);
+
+	while (next < io.nblocks || inflight > 0) {
+
+		if (use_uring) {
+
+			int queued = 0;
+			while (next < io.nblocks && inflight < IO_DEPTH) {
+
+				size_t off, len;
+				block_range(next, &off, &len);
+				len = (len + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN;
+				uring_prep(&ring, IORING_OP_WRITE, io.out_fd, io.buf + off, len, off, next);
+				next++; inflight++; queued++;
+			}
+
+			syscall(__NR_io_uring_enter, ring.fd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+			unsigned long long id;
+			int res;
+			while (uring_reap(&ring, &id, &res)) {
+				if (res < 0) {
+					printf("Error writing block %llu: %s\n", id, strerror(-res));
+					exit(4);
+				}
+				inflight--;
+			}
+		}
+		else {
+
+			size_t off, len;
+			block_range(next, &off, &len);
+			len = (len + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN;
+
+			if (pwrite(io.out_fd, io.buf + off, len, off) != (ssize_t) len) {
+				printf("Error writing %s.\n", path);
+				exit(4);
+			}
+			next++;
+		}
+	}
+
+	if (use_uring)
+		uring_exit(&ring);
+
+	if (ftruncate(io.out_fd, io.bytes) != 0) {
+		printf("Error writing %s.\n", path);
+		exit(4);
+	}
+	fsync(io.out_fd);
+	close(io.out_fd);
+}
+
+// function : sort_io_report()
+// description : Print the time spent in I/O.
+//---------------------------------------------------------------------
+
+void sort_io_report(void)
+{
+	if (io.direct) {
+		printf("io: direct (%s, %s), read %lf s, write %lf s, leaves waited %lf s for reads\n",
+		       io.o_direct ? "O_DIRECT" : "page cache",
+		       io.use_uring ? "io_uring" : "pread",
+		       io.read_time, io.write_time, io.wait_time);
+	}
+	else {
+		printf("io: mmap, read %lf s, write %lf s\n", io.read_time, io.write_time);
+	}
+}
+
+// function : block_range()
+// description : Byte range of block b.
+//---------------------------------------------------------------------
+
+static int block_range(int b, size_t *off, size_t *len)
+{
+	*off = (size_t) b * IO_BLOCK;
+	*len = (io.bytes - *off < IO_BLOCK) ? io.bytes - *off : IO_BLOCK;
+
+	return 1;
+}
+
+// function : uring_init()
+// description : Set up an io_uring and map its rings. Returns 0 when the
+//               kernel does not offer io_uring.
+//---------------------------------------------------------------------
+
+static int uring_init(struct uring *r, unsigned entries)
+{
+	struct io_uring_params p;
+
+	memset(r, 0, sizeof(*r));
+	memset(&p, 0, sizeof(p));
+
+	r->fd = (int) syscall(__NR_io_uring_setup, entries, &p);
+	if (r->fd < 0)
+		return 0;
+
+	r->sq_len   = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_len   = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_len > r->sq_len)
+			r->sq_len = r->cq_len;
+		r->cq_len = r->sq_len;
+	}
+
+	r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+	                 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED) {
+		close(r->fd);
+		return 0;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ptr = r->sq_ptr;
+	}
+	else {
+		r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+		                 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED) {
+			munmap(r->sq_ptr, r->sq_len);
+			close(r->fd);
+			return 0;
+		}
+	}
+
+	r->sqes = (struct io_uring_sqe*) mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+	                                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		uring_exit(r);
+		return 0;
+	}
+
+	r->sq_head  = (unsigned*) ((char*) r->sq_ptr + p.sq_off.head);
+	r->sq_tail  = (unsigned*) ((char*) r->sq_ptr + p.sq_off.tail);
+	r->sq_mask  = (unsigned*) ((char*) r->sq_ptr + p.sq_off.ring_mask);
+	r->sq_array = (unsigned*) ((char*) r->sq_ptr + p.sq_off.array);
+	r->cq_head  = (unsigned*) ((char*) r->cq_ptr + p.cq_off.head);
+	r->cq_tail  = (unsigned*) ((char*) r->cq_ptr + p.cq_off.tail);
+	r->cq_mask  = (unsigned*) ((char*) r->cq_ptr + p.cq_off.ring_mask);
+	r->cqes     = (struct io_uring_cqe*) ((char*) r->cq_ptr + p.cq_off.cqes);
+
+	return 1;
+}
+
+static void uring_exit(struct uring *r)
+{
+	if (r->sqes != NULL && r->sqes != MAP_FAILED)
+		munmap(r->sqes, r->sqes_len);
+	if (r->cq_ptr != NULL && r->cq_ptr != r->sq_ptr)
+		munmap(r->cq_ptr, r->cq_len);
+	munmap(r->sq_ptr, r->sq_len);
+	close(r->fd);
+}
+
+// function : uring_prep()
+// description : Queue one read/write (submitted by the next enter).
+//---------------------------------------------------------------------
+
+static void uring_prep(struct uring *r, int op, int fd, char *buf, size_t len,
+                       off_t off, unsigned long long id)
+{
+	unsigned tail = *r->sq_tail;
+	unsigned idx  = tail & *r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode    = op;
+	sqe->fd        = fd;
+	sqe->addr      = (unsigned long long) (uintptr_t) buf;
+	sqe->len       = (unsigned) len;
+	sqe->off       = (unsigned long long) off;
+	sqe->user_data = id;
+
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// function : uring_reap()
+// description : Take one completion, 0 if there is none.
+//---------------------------------------------------------------------
+
+static int uring_reap(struct uring *r, unsigned long long *id, int *res)
+{
+	unsigned head = *r->cq_head;
+
+	if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE))
+		return 0;
+
+	struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+	*id  = cqe->user_data;
+	*res = cqe->res;
+
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+static double io_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
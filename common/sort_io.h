@@ -0,0 +1,41 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#ifndef SORT_IO_H
+#define SORT_IO_H
+
+// Binary file input/output for the drivers (--in/--out).
+//
+// mmap mode: the keys are sorted in place on the mapped pages of the
+//            output file (the input itself when there is no --out).
+// direct mode: O_DIRECT reads through io_uring (pread from a helper
+//            thread if io_uring is unavailable) into an aligned buffer.
+//            The reads run in the background; a leaf calls
+//            sort_io_wait() for its range before sorting it, so reading
+//            overlaps with the leaf sorts.
+//===========================================================
+
+int  sort_io_keys  (const char *in);
+int* sort_io_open  (const char *in, const char *out, int direct, int n);
+void sort_io_wait  (int lo, int cnt);
+void sort_io_close (int *v, int n);
+void sort_io_report(void);
+
+#endif
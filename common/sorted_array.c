@@ -0,0 +1,192 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sorted_array.h"
+#include "merge_path.h"
+#include "bitonic_engine.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int sorted_array_group_div = 64; //a group is at least n/64 keys
+
+
+// Function Declaration
+//===========================================================
+
+static int sorted_array_reserve(int**, int**, int*, int, int);
+
+
+// Function Definition
+//===========================================================
+
+// function : sorted_array_init()
+// description : Empty array; groups of at least group_min keys (and
+//               n/sorted_array_group_div) are merged on nthreads threads.
+//---------------------------------------------------------------------
+
+int sorted_array_init(struct sorted_array *sa, int nthreads, int group_min)
+{
+	memset(sa, 0, sizeof(*sa));
+
+	sa->nthreads  = (nthreads > 0) ? nthreads : 1;
+	sa->group_min = (group_min > 0) ? group_min : 1;
+
+	return 0;
+}
+
+// function : sorted_array_insert()
+// description : Buffer a batch of b keys, and merge the buffered keys
+//               in once they make up a group. Returns 0, or -1 if out
+//               of memory (the array is then left as it was).
+//---------------------------------------------------------------------
+
+int sorted_array_insert(struct sorted_array *sa, const int *batch, int b)
+{
+	if (b <= 0)
+		return 0;
+
+	if (sorted_array_reserve(&sa->pending, NULL, &sa->pcap, sa->npending + b, sa->npending) != 0)
+		return -1;
+
+	memcpy(sa->pending + sa->npending, batch, (size_t) b * sizeof(int));
+	sa->npending += b;
+
+	int group = sa->n / sorted_array_group_div;
+	if (group < sa->group_min)
+		group = sa->group_min;
+
+	// a failed flush stops before it touches the buffered keys, so
+	// the batch can be taken off again
+	if (sa->npending >= group && sorted_array_flush(sa) != 0) {
+		sa->npending -= b;
+		return -1;
+	}
+
+	return 0;
+}
+
+// function : sorted_array_flush()
+// description : Merge the buffered keys in now: sort them, merge them
+//               with the array into the spare buffer with merge path,
+//               and swap the two. Returns 0, or -1 if out of memory.
+//---------------------------------------------------------------------
+
+int sorted_array_flush(struct sorted_array *sa)
+{
+	int g = sa->npending;
+
+	if (g == 0)
+		return 0;
+
+	if (sorted_array_reserve(&sa->keys, &sa->spare, &sa->cap, sa->n + g, sa->n) != 0)
+		return -1;
+
+	engine_sort(sa->pending, g, ENGINE_ASCENDING, sa->nthreads);
+
+	if (sa->n == 0) {
+		memcpy(sa->keys, sa->pending, (size_t) g * sizeof(int));
+	}
+	else {
+		merge_path_merge(sa->keys, sa->n, sa->pending, g, sa->spare, ENGINE_ASCENDING, sa->nthreads);
+
+		int *tmp  = sa->keys;
+		sa->keys  = sa->spare;
+		sa->spare = tmp;
+	}
+
+	sa->n       += g;
+	sa->npending = 0;
+	sa->merges++;
+	sa->merged  += sa->n;
+
+	return 0;
+}
+
+// function : sorted_array_data()
+// description : Merge what is buffered and return the sorted keys and
+//               their number (NULL and 0 if out of memory).
+//---------------------------------------------------------------------
+
+int* sorted_array_data(struct sorted_array *sa, int *n)
+{
+	if (sorted_array_flush(sa) != 0) {
+		*n = 0;
+		return NULL;
+	}
+
+	*n = sa->n;
+	return sa->keys;
+}
+
+// function : sorted_array_free()
+// description : Free the keys and the buffers.
+//---------------------------------------------------------------------
+
+void sorted_array_free(struct sorted_array *sa)
+{
+	free(sa->keys);
+	free(sa->spare);
+	free(sa->pending);
+	memset(sa, 0, sizeof(*sa));
+}
+
+// function : sorted_array_reserve()
+// description : Grow *a (and *b, if given) to hold at least need keys,
+//               doubling the capacity; the first keep keys of *a are
+//               kept. Either both grow or neither does.
+//---------------------------------------------------------------------
+
+static int sorted_array_reserve(int **a, int **b, int *cap, int need, int keep)
+{
+	if (need <= *cap)
+		return 0;
+
+	int newcap = (*cap > 0) ? *cap : 1024;
+	while (newcap < need)
+		newcap = (newcap > (1 << 29)) ? need : 2 * newcap;
+
+	int *na = (int*) malloc((size_t) newcap * sizeof(int));
+	int *nb = (b != NULL) ? (int*) malloc((size_t) newcap * sizeof(int)) : NULL;
+	if (na == NULL || (b != NULL && nb == NULL)) {
+		free(na);
+		free(nb);
+		return -1;
+	}
+
+	if (keep > 0)
+		memcpy(na, *a, (size_t) keep * sizeof(int));
+
+	free(*a);
+	*a = na;
+	if (b != NULL) {
+		free(*b);
+		*b = nb;
+	}
+	*cap = newcap;
+
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef SORTED_ARRAY_H
+#define SORTED_ARRAY_H
+
+// Incrementally maintained sorted array of int keys (ascending).
+//
+// sorted_array_insert() only buffers a batch. Once the buffered keys
+// reach a group of max(group_min, n/group_div) keys, they are sorted
+// on their own (engine_sort) and merged into the array with the
+// parallel merge path merge, out of place into a second buffer. An
+// update then costs O(n + g log^2 g) for a group of g keys, instead of
+// a full O(n log^2 n) sort, and small batches share the O(n) merge.
+// sorted_array_data() merges what is still buffered and returns the
+// keys.
+//===========================================================
+
+struct sorted_array {
+
+	int *keys;     //the sorted keys
+	int *spare;    //merge target, swapped with keys after a merge
+	int  n;        //sorted keys
+	int  cap;      //capacity of keys and spare
+
+	int *pending;  //buffered, not yet merged keys
+	int  npending;
+	int  pcap;
+
+	int  group_min; //smallest group that is merged
+	int  nthreads;
+
+	long long merges;  //merges done
+	long long merged;  //keys that went through them
+};
+
+int  sorted_array_init  (struct sorted_array *sa, int nthreads, int group_min);
+int  sorted_array_insert(struct sorted_array *sa, const int *batch, int b);
+int  sorted_array_flush (struct sorted_array *sa);
+int* sorted_array_data  (struct sorted_array *sa, int *n);
+void sorted_array_free  (struct sorted_array *sa);
+
+#endif
@@ -0,0 +1,421 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <omp.h>
+
+#include "stream_merge.h"
+#include "bitonic_kernels.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int    stream_block     = 1<<18; //keys merged in cache (1 MB)
+const double stream_mem_share = 0.5;   //largest share of the free memory for the buffer
+const int    stream_reps      = 5;     //baseline: best of this many copies
+
+#define STREAM_LEVELS 32
+#define STREAM_BLOCKS STREAM_LEVELS //stats slot of the in-cache blocks
+
+static int       *stream_buf = NULL; //the second buffer, 64 byte aligned
+static double     stream_copy_gbs;   //baseline copy bandwidth
+static stream_for stream_run = NULL; //the driver's threads, or NULL for OpenMP
+
+// bytes moved per streamed level (by log2 of the distance) and by the
+// in-cache blocks, and the wall-clock time during which at least one
+// merge was running that level; concurrent merges of the same level
+// share one interval
+static double stream_bytes [STREAM_LEVELS + 1];
+static double stream_secs  [STREAM_LEVELS + 1];
+static double stream_since [STREAM_LEVELS + 1];
+static int    stream_active[STREAM_LEVELS + 1];
+static pthread_mutex_t stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// one streamed level, or the in-cache blocks, of a merge
+struct stream_pass {
+
+	const int *src;
+	int       *dst;
+	int       *v;      //the merge's keys, v + lo
+	int        cnt;
+	int        k;      //distance of the level, half a block
+	int        dir;
+	int        in_buf; //blocks: the keys are in the buffer
+	int        parts;
+};
+
+
+// Function Declaration
+//===========================================================
+
+static void stream_levels    (int*, int, int, int, int);
+static void stream_parts     (stream_part, void*, int);
+static void stream_level_part(void*, int);
+static void stream_block_part(void*, int);
+static void stream_touch_part(void*, int);
+static void stream_copy_part (void*, int);
+static void stream_pairs     (const int*, int*, long long, long long, int, int);
+static void stream_begin     (int);
+static void stream_end       (int, double);
+
+
+// Function Definition
+//===========================================================
+
+// function : stream_init()
+// description : Allocate the second buffer for n keys, unless it would
+//               take more than stream_mem_share of the free memory.
+//               Touch it, then time a copy of its first half to the
+//               second half (STREAM counting: one read and one write
+//               per key), both on nthreads threads of run. Returns 1 if
+//               the merges can stream, else 0.
+//---------------------------------------------------------------------
+
+int stream_init(int n, int nthreads, stream_for run)
+{
+	long   pages = sysconf(_SC_AVPHYS_PAGES);
+	long   psize = sysconf(_SC_PAGESIZE);
+	double need  = (double) n * sizeof(int);
+	double avail = (double) pages * psize;
+	int    r;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	stream_run = run;
+
+	if (!kernel_stream_nt())
+		printf("stream: warning, no non-temporal stores in this build, the merges use plain stores\n");
+
+	if (pages > 0 && need > stream_mem_share * avail) {
+		printf("stream: %.0f MB needed, %.0f MB free, merging in place\n",
+		       need / 1e6, avail / 1e6);
+		return 0;
+	}
+
+	if (posix_memalign((void**) &stream_buf, 64, (size_t) n * sizeof(int)) != 0) {
+		stream_buf = NULL;
+		printf("stream: cannot allocate %.0f MB, merging in place\n", need / 1e6);
+		return 0;
+	}
+
+	struct stream_pass pass;
+	pass.cnt   = n;
+	pass.parts = nthreads;
+
+	stream_parts(stream_touch_part, &pass, nthreads);
+
+	stream_copy_gbs = 0;
+
+	for (r = 0; r < stream_reps; r++) {
+
+		double t = omp_get_wtime();
+
+		stream_parts(stream_copy_part, &pass, nthreads);
+
+		t = omp_get_wtime() - t;
+		if (t > 0 && 2.0 * (n / 2) * sizeof(int) / t / 1e9 > stream_copy_gbs)
+			stream_copy_gbs = 2.0 * (n / 2) * sizeof(int) / t / 1e9;
+	}
+
+	memset(stream_bytes,  0, sizeof(stream_bytes));
+	memset(stream_secs,   0, sizeof(stream_secs));
+	memset(stream_active, 0, sizeof(stream_active));
+
+	return 1;
+}
+
+// function : stream_merge()
+// description : Merge the bitonic sequence v[lo..lo+cnt) in direction
+//               dir on nthreads threads. Returns 0, leaving v as it is,
+//               when the blocks fit in the cache anyway or there is no
+//               buffer. With the driver's run the parts go to its own
+//               threads. Without it, from inside a parallel region (the
+//               OpenMP driver's tasks) the levels run as tasks of the
+//               current team, otherwise on a team of their own.
+//---------------------------------------------------------------------
+
+int stream_merge(int *v, int lo, int cnt, int dir, int nthreads)
+{
+	if (stream_buf == NULL || cnt <= stream_block)
+		return 0;
+
+	if (nthreads < 1)
+		nthreads = 1;
+
+	if (stream_run != NULL || omp_in_parallel()) {
+		stream_levels(v, lo, cnt, dir, nthreads);
+	}
+	else {
+		#pragma omp parallel num_threads(nthreads)
+		#pragma omp single
+		stream_levels(v, lo, cnt, dir, nthreads);
+	}
+
+	return 1;
+}
+
+// function : stream_levels()
+// description : 1. the levels with blocks larger than stream_block,
+//                  ping-pong between v and the buffer, each one cut
+//                  into nthreads equal ranges of pairs,
+//               2. the blocks of stream_block keys, in nthreads equal
+//                  ranges; if the keys are in the buffer, the first
+//                  level of a block moves them back into v.
+//---------------------------------------------------------------------
+
+static void stream_levels(int *v, int lo, int cnt, int dir, int nthreads)
+{
+	struct stream_pass pass;
+	int   *src = v + lo;
+	int   *dst = stream_buf + lo;
+	int    k, l;
+
+	pass.v     = v + lo;
+	pass.cnt   = cnt;
+	pass.dir   = dir;
+	pass.parts = nthreads;
+
+	for (k = cnt / 2; 2 * k > stream_block; k /= 2) {
+
+		for (l = 0; (1 << l) < k; l++);
+
+		pass.src = src;
+		pass.dst = dst;
+		pass.k   = k;
+
+		stream_begin(l);
+		stream_parts(stream_level_part, &pass, nthreads);
+		stream_end(l, 2.0 * cnt * sizeof(int));
+
+		int *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	pass.src    = src;
+	pass.k      = k;
+	pass.in_buf = (src != v + lo);
+	if (pass.parts > cnt / (2 * k))
+		pass.parts = cnt / (2 * k);
+
+	stream_begin(STREAM_BLOCKS);
+	stream_parts(stream_block_part, &pass, pass.parts);
+	stream_end(STREAM_BLOCKS, 2.0 * cnt * sizeof(int));
+}
+
+// function : stream_parts()
+// description : part(arg, c) for c in [0,parts), on the driver's run,
+//               or as tasks of the current OpenMP team, or on a team
+//               of its own outside a parallel region.
+//---------------------------------------------------------------------
+
+static void stream_parts(stream_part part, void *arg, int parts)
+{
+	int c;
+
+	if (stream_run != NULL) {
+		stream_run(part, arg, parts);
+	}
+	else if (omp_in_parallel()) {
+		#pragma omp taskloop grainsize(1)
+		for (c = 0; c < parts; c++)
+			part(arg, c);
+	}
+	else {
+		#pragma omp parallel for num_threads(parts) schedule(static)
+		for (c = 0; c < parts; c++)
+			part(arg, c);
+	}
+}
+
+// function : stream_level_part()
+// description : Range c of the pairs of one streamed level.
+//---------------------------------------------------------------------
+
+static void stream_level_part(void *arg, int c)
+{
+	struct stream_pass *p = arg;
+
+	long long p0 = (long long) (p->cnt / 2) * c / p->parts;
+	long long p1 = (long long) (p->cnt / 2) * (c + 1) / p->parts;
+
+	stream_pairs(p->src, p->dst, p0, p1, p->k, p->dir);
+}
+
+// function : stream_block_part()
+// description : Range c of the in-cache blocks of 2k keys.
+//---------------------------------------------------------------------
+
+static void stream_block_part(void *arg, int c)
+{
+	struct stream_pass *p = arg;
+
+	int B  = 2 * p->k;
+	int b0 = (int) ((long long) (p->cnt / B) * c / p->parts);
+	int b1 = (int) ((long long) (p->cnt / B) * (c + 1) / p->parts);
+	int b;
+
+	for (b = b0; b < b1; b++) {
+
+		int *w = p->v + (size_t) b * B;
+
+		if (p->in_buf) {
+			kernel_compare_copy(p->src + (size_t) b * B, w, p->k, p->k, p->dir);
+			kernel_merge(w,        p->k, p->dir);
+			kernel_merge(w + p->k, p->k, p->dir);
+		}
+		else {
+			kernel_merge(w, B, p->dir);
+		}
+	}
+}
+
+// function : stream_touch_part()
+// description : Range c of the buffer's first touch.
+//---------------------------------------------------------------------
+
+static void stream_touch_part(void *arg, int c)
+{
+	struct stream_pass *p = arg;
+
+	long long i0 = (long long) p->cnt * c / p->parts;
+	long long i1 = (long long) p->cnt * (c + 1) / p->parts;
+	long long i;
+
+	for (i = i0; i < i1; i++)
+		stream_buf[i] = (int) i;
+}
+
+// function : stream_copy_part()
+// description : Range c of the baseline copy, first half of the buffer
+//               to the second half.
+//---------------------------------------------------------------------
+
+static void stream_copy_part(void *arg, int c)
+{
+	struct stream_pass *p = arg;
+
+	long long h  = p->cnt / 2;
+	long long i0 = h * c / p->parts;
+	long long i1 = h * (c + 1) / p->parts;
+	long long i;
+
+	for (i = i0; i < i1; i++)
+		stream_buf[h + i] = stream_buf[i];
+}
+
+// function : stream_pairs()
+// description : Pairs [p0,p1) of the level with distance k. Pair p
+//               compares position (p/k)*2k + p%k with the one k after
+//               it; consecutive pairs form runs of up to k positions,
+//               each streamed with one kernel call.
+//---------------------------------------------------------------------
+
+static void stream_pairs(const int *src, int *dst, long long p0, long long p1, int k, int dir)
+{
+	long long p = p0;
+
+	while (p < p1) {
+
+		long long pos = (p / k) * 2 * k + p % k;
+		long long run = k - p % k;
+		if (run > p1 - p)
+			run = p1 - p;
+
+		kernel_stream_range(src + pos, dst + pos, (int) run, k, dir);
+		p += run;
+	}
+}
+
+// function : stream_begin()
+// description : A merge starts level l (or the blocks): open its
+//               wall-clock interval unless another merge already has.
+//---------------------------------------------------------------------
+
+static void stream_begin(int l)
+{
+	pthread_mutex_lock(&stream_mutex);
+	if (stream_active[l]++ == 0)
+		stream_since[l] = omp_get_wtime();
+	pthread_mutex_unlock(&stream_mutex);
+}
+
+// function : stream_end()
+// description : A merge finished level l, having moved bytes; the last
+//               one running closes the interval.
+//---------------------------------------------------------------------
+
+static void stream_end(int l, double bytes)
+{
+	pthread_mutex_lock(&stream_mutex);
+	stream_bytes[l] += bytes;
+	if (--stream_active[l] == 0)
+		stream_secs[l] += omp_get_wtime() - stream_since[l];
+	pthread_mutex_unlock(&stream_mutex);
+}
+
+// function : stream_report()
+// description : Achieved bandwidth of every streamed level and of the
+//               in-cache blocks, bytes over wall-clock time, against
+//               the baseline copy.
+//---------------------------------------------------------------------
+
+void stream_report(void)
+{
+	int l;
+
+	if (stream_buf == NULL)
+		return;
+
+	printf("stream: baseline copy %.2f GB/s\n", stream_copy_gbs);
+
+	for (l = STREAM_LEVELS - 1; l >= 0; l--) {
+
+		if (stream_secs[l] > 0) {
+
+			double gbs = stream_bytes[l] / stream_secs[l] / 1e9;
+			printf("stream: level 2^%-2d %8.2f GB/s (%3.0f%% of copy)\n",
+			       l, gbs, 100.0 * gbs / stream_copy_gbs);
+		}
+	}
+
+	if (stream_secs[STREAM_BLOCKS] > 0) {
+
+		double gbs = stream_bytes[STREAM_BLOCKS] / stream_secs[STREAM_BLOCKS] / 1e9;
+		for (l = 0; (1 << l) < stream_block; l++);
+		printf("stream: blocks    %8.2f GB/s (%3.0f%% of copy, %d levels in cache)\n",
+		       gbs, 100.0 * gbs / stream_copy_gbs, l);
+	}
+}
+
+// function : stream_free()
+// description : Free the second buffer.
+//---------------------------------------------------------------------
+
+void stream_free(void)
+{
+	free(stream_buf);
+	stream_buf = NULL;
+}
@@ -0,0 +1,52 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef STREAM_MERGE_H
+#define STREAM_MERGE_H
+
+// Out-of-place bitonic merge for the drivers' -stream flag.
+//
+// The levels of a merge whose blocks do not fit in the cache are
+// streamed: each one reads v or a second buffer of n keys and writes
+// the other one with non-temporal stores, so a level is one read and
+// one write pass and nothing is written through the cache. The blocks
+// that fit (stream_block keys) are then merged in cache on their way
+// back into v. stream_init() allocates the buffer and times a
+// STREAM-like copy as the baseline for stream_report(); without the
+// memory for the buffer it returns 0 and the drivers merge in place.
+//
+// The parallelism comes from the driver's backend, as in -abs. run
+// calls part(arg, c) for every c in [0,parts), at the same time if it
+// can, and returns when all are done (helper pthreads, cilk_for). With
+// run NULL the parts are OpenMP tasks of the caller's team, or of a
+// team of their own outside a parallel region. stream_report() gives
+// every level its bytes over the wall-clock time it was running.
+//===========================================================
+
+typedef void (*stream_part)(void *arg, int c);
+typedef void (*stream_for) (stream_part part, void *arg, int parts);
+
+int  stream_init  (int n, int nthreads, stream_for run);
+int  stream_merge (int *v, int lo, int cnt, int dir, int nthreads);
+void stream_report(void);
+void stream_free  (void);
+
+#endif
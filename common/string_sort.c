@@ -0,0 +1,268 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "string_sort.h"
+#include "bitonic_engine.h"
+#include "bitonic_kernels.h"
+
+
+// Constants & Variables
+//===========================================================
+
+const int string_direct_max = 16;    //equal-key ranges up to this size are compared directly
+const int string_par_min    = 1<<16; //ranges from this size are refined by all threads
+
+struct string_set {
+
+	const char      *arena;
+	const long long *offsets;
+	long long        depth; //bytes already known to be equal (direct comparison)
+}; // the strings being sorted
+
+
+// Function Declaration
+//===========================================================
+
+static unsigned long long string_key   (const struct string_set*, int, long long);
+static int                string_runs  (struct string_set*, struct kernel_kv*, int, long long, int);
+static int                string_refine(struct string_set*, struct kernel_kv*, int, long long, int);
+static int                string_cmp_kv(const void*, const void*, void*);
+
+
+// Function Definition
+//===========================================================
+
+// function : string_sort()
+// description : Sort the indices as one range of strings whose first 0
+//               bytes are equal, then copy them out.
+//---------------------------------------------------------------------
+
+int string_sort(const char *arena, const long long *offsets, int n, int *order, int nthreads)
+{
+	struct string_set  set = { arena, offsets, 0 };
+	struct kernel_kv  *kv;
+	int                i, err;
+
+	if (n < 1)
+		return 0;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	kv = (struct kernel_kv*) malloc((size_t) n * sizeof(struct kernel_kv));
+	if (kv == NULL)
+		return -1;
+
+	#pragma omp parallel for num_threads(nthreads) if(n >= string_par_min)
+	for (i = 0; i < n; i++)
+		kv[i].val = (unsigned int) i;
+
+	err = string_refine(&set, kv, n, 0, nthreads);
+
+	#pragma omp parallel for num_threads(nthreads) if(n >= string_par_min)
+	for (i = 0; i < n; i++)
+		order[i] = (int) kv[i].val;
+
+	free(kv);
+	return err;
+}
+
+// function : string_refine()
+// description : Sort kv[0..cnt), strings whose first depth bytes (zero
+//               padded) are equal:
+//               1. small ranges, and ranges where every string has
+//                  ended, are sorted by comparing the rest of the
+//                  strings,
+//               2. the others are keyed with their next 8 bytes; while
+//                  all keys are equal (a common prefix), the next 8,
+//               3. the keys are sorted with the key-value engine and
+//                  the runs of equal keys refined in turn.
+//---------------------------------------------------------------------
+
+static int string_refine(struct string_set *set, struct kernel_kv *kv, int cnt, long long depth, int nthreads)
+{
+	int i, same;
+
+	if (cnt < string_par_min)
+		nthreads = 1;
+
+	for (;;) {
+
+		// 1.
+		int direct = (cnt <= string_direct_max);
+
+		for (i = 0; i < cnt && !direct; i++) {
+			int j = (int) kv[i].val;
+			if (set->offsets[j+1] - set->offsets[j] > depth)
+				break;
+		}
+		if (direct || i == cnt) {
+			set->depth = depth;
+			qsort_r(kv, cnt, sizeof(struct kernel_kv), string_cmp_kv, set);
+			return 0;
+		}
+
+		// 2.
+		same = 1;
+		#pragma omp parallel for num_threads(nthreads) if(nthreads > 1)
+		for (i = 0; i < cnt; i++)
+			kv[i].key = string_key(set, (int) kv[i].val, depth);
+
+		for (i = 1; i < cnt && same; i++)
+			same = (kv[i].key == kv[0].key);
+
+		if (!same)
+			break;
+		depth += 8;
+	}
+
+	// 3.
+	engine_sort_kv(kv, cnt, ENGINE_ASCENDING, nthreads);
+
+	return string_runs(set, kv, cnt, depth + 8, nthreads);
+}
+
+// function : string_runs()
+// description : Refine every run of equal keys in kv[0..cnt). With
+//               several threads, the large runs are refined one after
+//               the other by all of them, and the small ones in
+//               parallel, one thread each.
+//---------------------------------------------------------------------
+
+static int string_runs(struct string_set *set, struct kernel_kv *kv, int cnt, long long depth, int nthreads)
+{
+	int s, e, i, nruns = 0, err = 0;
+	int *runs;
+
+	if (nthreads == 1) {
+		for (s = 0; s < cnt && !err; s = e) {
+			e = s + 1;
+			while (e < cnt && kv[e].key == kv[s].key)
+				e++;
+			if (e - s > 1)
+				err = string_refine(set, kv + s, e - s, depth, 1);
+		}
+		return err;
+	}
+
+	runs = (int*) malloc(((size_t) cnt / 2 + 1) * 2 * sizeof(int));
+	if (runs == NULL)
+		return -1;
+
+	for (s = 0; s < cnt && !err; s = e) {
+		e = s + 1;
+		while (e < cnt && kv[e].key == kv[s].key)
+			e++;
+		if (e - s >= string_par_min)
+			err = string_refine(set, kv + s, e - s, depth, nthreads);
+		else if (e - s > 1) {
+			runs[2*nruns]   = s;
+			runs[2*nruns+1] = e - s;
+			nruns++;
+		}
+	}
+
+	#pragma omp parallel for num_threads(nthreads) schedule(dynamic,1) reduction(|:err)
+	for (i = 0; i < nruns; i++) {
+
+		struct string_set my = *set;
+		err |= string_refine(&my, kv + runs[2*i], runs[2*i+1], depth, 1);
+	}
+
+	free(runs);
+	return err ? -1 : 0;
+}
+
+// function : string_key()
+// description : Bytes [depth, depth+8) of string i as a big-endian
+//               number, zero padded past the end of the string, so that
+//               the keys compare like the bytes.
+//---------------------------------------------------------------------
+
+static unsigned long long string_key(const struct string_set *set, int i, long long depth)
+{
+	const unsigned char *s   = (const unsigned char*) set->arena + set->offsets[i] + depth;
+	long long            len = set->offsets[i+1] - set->offsets[i] - depth;
+	unsigned long long   k   = 0;
+	int                  b;
+
+	if (len >= 8) {
+		memcpy(&k, s, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		k = __builtin_bswap64(k);
+#endif
+		return k;
+	}
+
+	for (b = 0; b < 8; b++)
+		k = (k << 8) | (b < len ? s[b] : 0);
+	return k;
+}
+
+// function : string_cmp()
+// description : Compare strings i and j: bytes first, then length, so
+//               a string comes before the strings it is a prefix of.
+//---------------------------------------------------------------------
+
+int string_cmp(const char *arena, const long long *offsets, int i, int j)
+{
+	long long li = offsets[i+1] - offsets[i];
+	long long lj = offsets[j+1] - offsets[j];
+	int       c  = memcmp(arena + offsets[i], arena + offsets[j], li < lj ? li : lj);
+
+	if (c != 0)
+		return c;
+	return (li > lj) - (li < lj);
+}
+
+// function : string_cmp_kv()
+// description : qsort_r comparator of string_refine(): the strings from
+//               set->depth on (the bytes before are equal, or zero past
+//               the end of the shorter one), then the full lengths, then
+//               the indices.
+//---------------------------------------------------------------------
+
+static int string_cmp_kv(const void *x, const void *y, void *arg)
+{
+	const struct string_set *set = (const struct string_set*) arg;
+
+	int       i  = (int) ((const struct kernel_kv*) x)->val;
+	int       j  = (int) ((const struct kernel_kv*) y)->val;
+	long long li = set->offsets[i+1] - set->offsets[i];
+	long long lj = set->offsets[j+1] - set->offsets[j];
+	long long ri = li > set->depth ? li - set->depth : 0;
+	long long rj = lj > set->depth ? lj - set->depth : 0;
+	int       c  = 0;
+
+	if (ri > 0 && rj > 0)
+		c = memcmp(set->arena + set->offsets[i] + set->depth,
+		           set->arena + set->offsets[j] + set->depth, ri < rj ? ri : rj);
+	if (c != 0)
+		return c;
+	if (li != lj)
+		return (li > lj) - (li < lj);
+	return (i > j) - (i < j);
+}
@@ -0,0 +1,44 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#ifndef STRING_SORT_H
+#define STRING_SORT_H
+
+// Parallel sort of variable-length byte strings (OpenMP).
+//
+// String i is arena[offsets[i] .. offsets[i+1]), so offsets has n+1
+// entries; the strings may hold any byte, including 0. Each string is
+// sorted as a 64-bit key (its first 8 bytes, big-endian, zero padded)
+// and its index, with the key-value bitonic engine. Ranges of equal keys
+// are then sorted again on the next 8 bytes, and small ranges, or ranges
+// where all strings have ended, by comparing the strings directly.
+//
+// string_sort() writes the indices of the strings to order[0..n) in
+// ascending byte order, shorter strings first on a common prefix, equal
+// strings by index. It returns 0, or -1 if it could not allocate memory.
+//===========================================================
+
+int string_sort(const char *arena, const long long *offsets, int n, int *order, int nthreads);
+
+// the order of string_sort(): <0, 0 or >0 like memcmp
+int string_cmp (const char *arena, const long long *offsets, int i, int j);
+
+#endif
@@ -0,0 +1,697 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "../common/bitonic_engine.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+const char* GEN_FLAG = "-gen\0";
+const int GEN_FLAG_LENGTH = 4;
+
+int TEST_MODE = 0;
+int GEN_Q     = -1; //write 2^GEN_Q random keys to the input file first
+
+// for time measurements
+struct timeval startwtime, endwtime;
+double seq_time;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int P;       //number of sorting threads
+int p;       //log2(number of threads)
+int C;       //chunk size in keys (sorted in memory)
+int c;       //log2(chunk size)
+
+const char *in_path;
+const char *out_path;
+const char *tmp_dir = ".";
+
+const int min_merge_buffer = 1<<16; //keys per run buffer in the merge
+
+int nruns = 0;       //sorted runs written in phase 1
+long long nkeys = 0; //keys in the input
+long long temp_bytes = 0; //bytes of run files on disk
+
+// checksums of the input and of the output (test mode)
+uint64_t in_sum = 0, out_sum = 0;
+
+// per phase statistics
+struct phase_stats {
+
+	double    time;
+	long long bytes_read;
+	long long bytes_written;
+	long long temp_peak; //bytes of temporary files alive at once
+};
+
+struct phase_stats phase1, phase2;
+
+
+// Constants & Variables (Run Formation Pipeline)
+//===========================================================
+
+#define NBUFFERS 3 //read next / sort current / write previous
+
+#define BUF_EMPTY  0
+#define BUF_FILLED 1
+#define BUF_SORTED 2
+
+struct chunk_buffer {
+
+	int *keys;
+	int  len;   //keys in the buffer, 0 marks the end of the input
+	int  run;   //run number of the chunk
+	int  state;
+};
+
+struct chunk_buffer buffers[NBUFFERS];
+
+pthread_mutex_t buf_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t  buf_cond  = PTHREAD_COND_INITIALIZER;
+
+
+// Constants & Variables (Merge)
+//===========================================================
+
+struct run_reader {
+
+	int  fd;
+	int *buf;
+	int  cap;
+	int  len;
+	int  pos;
+	int  done;
+};
+
+
+// Function Declaration
+//===========================================================
+
+void  parse_arguments(int argc,char *argv[]);
+void  generate       (void);
+void  form_runs      (void);
+void  merge_runs     (void);
+void  report         (void);
+void  test           (void);
+void* reader_thread  (void*);
+void* writer_thread  (void*);
+void  wait_state     (struct chunk_buffer*, int);
+void  set_state      (struct chunk_buffer*, int);
+void  run_path       (char*, size_t, int);
+long long read_full  (int, void*, long long);
+long long write_full (int, const void*, long long);
+int   run_refill     (struct run_reader*);
+int   run_beats      (struct run_reader*, int, int);
+double elapsed       (struct timeval*, struct timeval*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+
+	if (GEN_Q >= 0)
+		generate();
+
+	// start measuring time
+	gettimeofday(&startwtime,NULL);
+
+	form_runs();
+	merge_runs();
+
+	// stop measuring time
+	gettimeofday(&endwtime,NULL);
+	seq_time = elapsed(&startwtime, &endwtime);
+
+	report();
+	test();
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],GEN_FLAG,GEN_FLAG_LENGTH+1) && arg+1 < argc) {
+			GEN_Q = atoi(argv[++arg]);
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 4 && argc - arg != 5) {
+		printf("Usage: %s [%s] [%s g] p c in out [tmpdir]\n\nwhere, %s is an optional flag (test mode)\n       %s g first writes 2^g random keys to in\n       P=2^p is the number of sorting threads\n       C=2^c is the number of keys sorted in memory at a time\n       in/out are binary files of native int keys\n       tmpdir holds the sorted runs (default .)\n",
+		       argv[0],TEST_FLAG,GEN_FLAG,TEST_FLAG,GEN_FLAG);
+		exit(1);
+	}
+
+	p        = atoi(argv[arg]);
+	c        = atoi(argv[arg+1]);
+	in_path  = argv[arg+2];
+	out_path = argv[arg+3];
+	if (argc - arg == 5)
+		tmp_dir = argv[arg+4];
+
+	P = 1 << p;
+	C = 1 << c;
+}
+
+// function : generate()
+// description : Write 2^GEN_Q random keys to the input file, in chunks
+//               so that it also works for files larger than RAM.
+//---------------------------------------------------------------------
+
+void generate(void)
+{
+	long long total = 1LL << GEN_Q;
+	long long done  = 0;
+	int i;
+
+	int fd = open(in_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	int *buf = (int*) malloc(C * sizeof(int));
+	if (fd < 0 || buf == NULL) {
+		printf("Error creating %s.\n", in_path);
+		exit(4);
+	}
+
+	srand( time(NULL) );
+	while (done < total) {
+
+		int len = (total - done < C) ? (int) (total - done) : C;
+		for (i = 0; i < len; i++) {
+			buf[i] = rand() % (1 << (GEN_Q < 31 ? GEN_Q : 30));
+		}
+		if (write_full(fd, buf, (long long) len * sizeof(int)) < 0) {
+			printf("Error writing %s.\n", in_path);
+			exit(4);
+		}
+		done += len;
+	}
+
+	free(buf);
+	close(fd);
+}
+
+// function : form_runs()
+// description : Phase 1. The reader thread fills chunk buffers from the
+//               input, this thread sorts them with the parallel bitonic
+//               engine and the writer thread stores them as runs. With
+//               three buffers the three steps overlap.
+//---------------------------------------------------------------------
+
+void form_runs(void)
+{
+	struct timeval t0, t1;
+	pthread_t reader, writer;
+	int i, cur;
+
+	gettimeofday(&t0,NULL);
+
+	for (i = 0; i < NBUFFERS; i++) {
+		buffers[i].keys  = (int*) malloc(C * sizeof(int));
+		buffers[i].state = BUF_EMPTY;
+		if (buffers[i].keys == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+	}
+
+	if (pthread_create(&reader,NULL,reader_thread,NULL) != 0 ||
+	    pthread_create(&writer,NULL,writer_thread,NULL) != 0) {
+		printf("Error creating thread.\n");
+		exit(3);
+	}
+
+	for (cur = 0; ; cur = (cur + 1) % NBUFFERS) {
+
+		struct chunk_buffer *buf = &buffers[cur];
+
+		wait_state(buf, BUF_FILLED);
+
+		// the buffer may be refilled as soon as it is handed on
+		int len = buf->len;
+
+		if (len > 0) {
+			engine_sort(buf->keys, len, ENGINE_ASCENDING, P);
+		}
+
+		// an empty buffer tells the writer to stop as well
+		set_state(buf, BUF_SORTED);
+
+		if (len == 0)
+			break;
+	}
+
+	pthread_join(reader,NULL);
+	pthread_join(writer,NULL);
+
+	for (i = 0; i < NBUFFERS; i++) {
+		free(buffers[i].keys);
+	}
+
+	gettimeofday(&t1,NULL);
+
+	phase1.time          = elapsed(&t0, &t1);
+	phase1.bytes_read    = nkeys * (long long) sizeof(int);
+	phase1.bytes_written = nkeys * (long long) sizeof(int);
+	phase1.temp_peak     = temp_bytes;
+}
+
+// function : reader_thread()
+// description : Read the input chunk by chunk into the next empty
+//               buffer.
+//---------------------------------------------------------------------
+
+void* reader_thread(void *ptr)
+{
+	int fd = open(in_path, O_RDONLY);
+	if (fd < 0) {
+		printf("Error opening %s.\n", in_path);
+		exit(4);
+	}
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	int cur, run = 0;
+	for (cur = 0; ; cur = (cur + 1) % NBUFFERS) {
+
+		struct chunk_buffer *buf = &buffers[cur];
+
+		wait_state(buf, BUF_EMPTY);
+
+		long long got = read_full(fd, buf->keys, (long long) C * sizeof(int));
+		if (got < 0) {
+			printf("Error reading %s.\n", in_path);
+			exit(4);
+		}
+
+		int len = (int) (got / sizeof(int));
+
+		if (TEST_MODE) {
+			int i;
+			for (i = 0; i < len; i++)
+				in_sum += (uint32_t) buf->keys[i];
+		}
+		nkeys += len;
+
+		buf->len = len;
+		buf->run = run++;
+		set_state(buf, BUF_FILLED);
+
+		if (len == 0)
+			break;
+	}
+
+	close(fd);
+	return NULL;
+}
+
+// function : writer_thread()
+// description : Write every sorted buffer to its own run file.
+//---------------------------------------------------------------------
+
+void* writer_thread(void *ptr)
+{
+	char path[4096];
+	int cur;
+
+	for (cur = 0; ; cur = (cur + 1) % NBUFFERS) {
+
+		struct chunk_buffer *buf = &buffers[cur];
+
+		wait_state(buf, BUF_SORTED);
+
+		if (buf->len == 0)
+			break;
+
+		run_path(path, sizeof(path), buf->run);
+		int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0 ||
+		    write_full(fd, buf->keys, (long long) buf->len * sizeof(int)) < 0) {
+			printf("Error writing run %s.\n", path);
+			exit(4);
+		}
+		close(fd);
+
+		nruns = buf->run + 1;
+		temp_bytes += (long long) buf->len * sizeof(int);
+		set_state(buf, BUF_EMPTY);
+	}
+
+	return NULL;
+}
+
+// function : wait_state() / set_state()
+// description : Hand the chunk buffers between the pipeline stages.
+//---------------------------------------------------------------------
+
+void wait_state(struct chunk_buffer *buf, int state)
+{
+	pthread_mutex_lock(&buf_mutex);
+	while (buf->state != state)
+		pthread_cond_wait(&buf_cond, &buf_mutex);
+	pthread_mutex_unlock(&buf_mutex);
+}
+
+void set_state(struct chunk_buffer *buf, int state)
+{
+	pthread_mutex_lock(&buf_mutex);
+	buf->state = state;
+	pthread_cond_broadcast(&buf_cond);
+	pthread_mutex_unlock(&buf_mutex);
+}
+
+// function : merge_runs()
+// description : Phase 2. k-way merge of the runs with a loser tree.
+//               Every run is read through its own large buffer and the
+//               output is written in large blocks, so the disk only
+//               sees sequential I/O. The runs are deleted at the end.
+//---------------------------------------------------------------------
+
+void merge_runs(void)
+{
+	struct timeval t0, t1;
+	struct run_reader *runs;
+	int *ls, *win, *out;
+	int k = nruns;
+	int i, n, out_len = 0;
+	char path[4096];
+
+	gettimeofday(&t0,NULL);
+
+	// the merge gets the same memory as the three chunk buffers
+	int cap = (int) (3LL * C / (k + 1));
+	if (cap < min_merge_buffer)
+		cap = min_merge_buffer;
+
+	runs = (struct run_reader*) calloc(k > 0 ? k : 1, sizeof(struct run_reader));
+	ls   = (int*) malloc((k > 0 ? k : 1) * sizeof(int));
+	win  = (int*) malloc(2 * (k > 0 ? k : 1) * sizeof(int));
+	out  = (int*) malloc(cap * sizeof(int));
+	if (runs == NULL || ls == NULL || win == NULL || out == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	int fd_out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd_out < 0) {
+		printf("Error creating %s.\n", out_path);
+		exit(4);
+	}
+
+	for (i = 0; i < k; i++) {
+
+		run_path(path, sizeof(path), i);
+		runs[i].fd  = open(path, O_RDONLY);
+		runs[i].cap = cap;
+		runs[i].buf = (int*) malloc(cap * sizeof(int));
+		if (runs[i].fd < 0 || runs[i].buf == NULL) {
+			printf("Error opening run %s.\n", path);
+			exit(4);
+		}
+		posix_fadvise(runs[i].fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		run_refill(&runs[i]);
+	}
+
+	if (k > 0) {
+
+		// build the loser tree: leaves k..2k-1, ls[0] is the winner
+		for (i = 0; i < k; i++)
+			win[k+i] = i;
+
+		for (n = k-1; n >= 1; n--) {
+
+			int l = win[2*n], r = win[2*n+1];
+			if (run_beats(runs, l, r)) {
+				win[n] = l; ls[n] = r;
+			}
+			else {
+				win[n] = r; ls[n] = l;
+			}
+		}
+		ls[0] = (k > 1) ? win[1] : 0;
+
+		while (!runs[ls[0]].done) {
+
+			int s = ls[0];
+			struct run_reader *r = &runs[s];
+
+			out[out_len++] = r->buf[r->pos++];
+			if (out_len == cap) {
+				if (write_full(fd_out, out, (long long) out_len * sizeof(int)) < 0) {
+					printf("Error writing %s.\n", out_path);
+					exit(4);
+				}
+				out_len = 0;
+			}
+
+			if (r->pos == r->len)
+				run_refill(r);
+
+			// replay the path from leaf s to the root
+			int t = (s + k) / 2;
+			while (t > 0) {
+				if (run_beats(runs, ls[t], s)) {
+					int tmp = ls[t]; ls[t] = s; s = tmp;
+				}
+				t /= 2;
+			}
+			ls[0] = s;
+		}
+	}
+
+	if (out_len > 0 &&
+	    write_full(fd_out, out, (long long) out_len * sizeof(int)) < 0) {
+		printf("Error writing %s.\n", out_path);
+		exit(4);
+	}
+	close(fd_out);
+
+	for (i = 0; i < k; i++) {
+		close(runs[i].fd);
+		free(runs[i].buf);
+		run_path(path, sizeof(path), i);
+		unlink(path);
+	}
+
+	free(runs);
+	free(ls);
+	free(win);
+	free(out);
+
+	gettimeofday(&t1,NULL);
+
+	phase2.time          = elapsed(&t0, &t1);
+	phase2.bytes_read    = nkeys * (long long) sizeof(int);
+	phase2.bytes_written = nkeys * (long long) sizeof(int);
+	phase2.temp_peak     = phase1.temp_peak; //runs are removed at the end
+}
+
+// function : run_refill()
+// description : Load the next block of a run. Marks the run done when
+//               it is exhausted.
+//---------------------------------------------------------------------
+
+int run_refill(struct run_reader *r)
+{
+	long long got = read_full(r->fd, r->buf, (long long) r->cap * sizeof(int));
+	if (got < 0) {
+		printf("Error reading a run.\n");
+		exit(4);
+	}
+
+	r->len  = (int) (got / sizeof(int));
+	r->pos  = 0;
+	r->done = (r->len == 0);
+
+	return r->len;
+}
+
+// function : run_beats()
+// description : Does run x win against run y? Exhausted runs lose, ties
+//               go to the lower run number.
+//---------------------------------------------------------------------
+
+int run_beats(struct run_reader *runs, int x, int y)
+{
+	if (runs[x].done) return 0;
+	if (runs[y].done) return 1;
+
+	int kx = runs[x].buf[runs[x].pos];
+	int ky = runs[y].buf[runs[y].pos];
+
+	if (kx != ky)
+		return kx < ky;
+
+	return x < y;
+}
+
+// function : report()
+// description : Print the total time, then temp space and I/O
+//               throughput of both phases.
+//---------------------------------------------------------------------
+
+void report(void)
+{
+	const double MB = 1024.0 * 1024.0;
+
+	// print time
+	printf("%lf\n",seq_time);
+
+	printf("keys: %lld, runs: %d\n", nkeys, nruns);
+	printf("phase 1 (runs):  %lf s, read %.1f MB, written %.1f MB, %.1f MB/s, temp %.1f MB\n",
+	       phase1.time, phase1.bytes_read / MB, phase1.bytes_written / MB,
+	       (phase1.bytes_read + phase1.bytes_written) / MB / phase1.time,
+	       phase1.temp_peak / MB);
+	printf("phase 2 (merge): %lf s, read %.1f MB, written %.1f MB, %.1f MB/s, temp %.1f MB\n",
+	       phase2.time, phase2.bytes_read / MB, phase2.bytes_written / MB,
+	       (phase2.bytes_read + phase2.bytes_written) / MB / phase2.time,
+	       phase2.temp_peak / MB);
+}
+
+// function : test()
+// description : Check that the output is sorted and holds the same
+//               keys as the input (count and checksum). The output is
+//               streamed, it is never loaded as a whole.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	if (TEST_MODE) {
+
+		int *buf = (int*) malloc(C * sizeof(int));
+		int fd = open(out_path, O_RDONLY);
+		if (buf == NULL || fd < 0) {
+			printf("Error reading %s.\n", out_path);
+			exit(4);
+		}
+
+		long long count = 0, got;
+		int passed = 1, first = 1, prev = 0, i;
+
+		while ((got = read_full(fd, buf, (long long) C * sizeof(int))) > 0) {
+
+			int len = (int) (got / sizeof(int));
+			for (i = 0; i < len; i++) {
+				if (!first && buf[i] < prev)
+					passed = 0;
+				prev  = buf[i];
+				first = 0;
+				out_sum += (uint32_t) buf[i];
+			}
+			count += len;
+		}
+
+		close(fd);
+		free(buf);
+
+		if (passed && count == nkeys && out_sum == in_sum) {
+			printf("Test PASSED. Output sorted, same keys as the input.\n");
+		}
+		else {
+			printf("Test NOT PASSED. sorted: %d, keys in/out: %lld/%lld\n",
+			       passed, nkeys, count);
+		}
+	}
+}
+
+// function : run_path()
+// description : Name of the file of run i.
+//---------------------------------------------------------------------
+
+void run_path(char *path, size_t size, int i)
+{
+	snprintf(path, size, "%s/bitonic_run_%d_%d.bin", tmp_dir, (int) getpid(), i);
+}
+
+// function : read_full() / write_full()
+// description : read()/write() that retry on short transfers. read_full
+//               returns fewer bytes only at the end of the file.
+//---------------------------------------------------------------------
+
+long long read_full(int fd, void *buf, long long bytes)
+{
+	long long done = 0;
+
+	while (done < bytes) {
+		ssize_t r = read(fd, (char*) buf + done, bytes - done);
+		if (r < 0) return -1;
+		if (r == 0) break;
+		done += r;
+	}
+
+	return done;
+}
+
+long long write_full(int fd, const void *buf, long long bytes)
+{
+	long long done = 0;
+
+	while (done < bytes) {
+		ssize_t r = write(fd, (const char*) buf + done, bytes - done);
+		if (r <= 0) return -1;
+		done += r;
+	}
+
+	return done;
+}
+
+double elapsed(struct timeval *t0, struct timeval *t1)
+{
+	return (double) ( (t1->tv_usec - t0->tv_usec) / 1.0e6
+	                 + t1->tv_sec - t0->tv_sec );
+}
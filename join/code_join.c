@@ -0,0 +1,290 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "../common/join.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+const char* SEMI_FLAG = "-semi\0";
+const int SEMI_FLAG_LENGTH = 5;
+
+int TEST_MODE = 0;
+int KIND      = JOIN_INNER;
+
+// for time measurements
+struct timeval startwtime, endwtime;
+double seq_time;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int P;  //number of threads
+int p;  //log2(number of threads)
+int NR; //rows of r
+int NS; //rows of s
+int D;  //keys are drawn from [0,D)
+
+int *r;
+int *s;
+
+struct join_result res;
+
+
+// Function Declaration
+//===========================================================
+
+void   parse_arguments(int argc,char *argv[]);
+void   init           (void);
+void   join           (void);
+void   test           (void);
+int    cmp_pair       (const void*, const void*);
+double elapsed        (struct timeval*, struct timeval*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+	init();
+	join();
+	test();
+
+	join_result_free(&res);
+	free(r);
+	free(s);
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],SEMI_FLAG,SEMI_FLAG_LENGTH+1)) {
+			KIND = JOIN_SEMI;
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 4) {
+		printf("Usage: %s [%s] [%s] p qr qs d\n\nwhere, %s is an optional flag (test mode)\n       %s is an optional flag (semi join instead of inner join)\n       P=2^p is the number of threads\n       2^qr and 2^qs are the rows of the two columns\n       d is the number of distinct key values\n",
+		       argv[0],TEST_FLAG,SEMI_FLAG,TEST_FLAG,SEMI_FLAG);
+		exit(1);
+	}
+
+	p  = atoi(argv[arg]);
+	NR = 1 << atoi(argv[arg+1]);
+	NS = 1 << atoi(argv[arg+2]);
+	D  = atoi(argv[arg+3]);
+
+	if (D < 1) {
+		printf("d must be at least 1.\n");
+		exit(1);
+	}
+
+	P = 1 << p;
+}
+
+// function : init()
+// description : Two columns of random keys in [0,D).
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	int i;
+
+	r = (int*) malloc((size_t) NR * sizeof(int));
+	s = (int*) malloc((size_t) NS * sizeof(int));
+	if (r == NULL || s == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	srand( time(NULL) );
+	for (i = 0; i < NR; i++) {
+		r[i] = rand() % D;
+	}
+	for (i = 0; i < NS; i++) {
+		s[i] = rand() % D;
+	}
+}
+
+// function : join()
+// description : Join r and s, print the total time, then the output
+//               size, the time of each phase and the throughput in
+//               input rows per second.
+//---------------------------------------------------------------------
+
+void join(void)
+{
+	gettimeofday(&startwtime,NULL);
+	if (join_sort_merge(r, NR, s, NS, KIND, P, &res) != 0) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	gettimeofday(&endwtime,NULL);
+
+	seq_time = elapsed(&startwtime, &endwtime);
+	printf("%lf\n",seq_time);
+	printf("join: %s, %lld rows out, sort %lf s, join %lf s, %.1lf Mrows/s (%.1lf Mrows/s join only)\n",
+	       join_kind_name(KIND), res.n, res.sort_time, res.join_time,
+	       ((double) NR + NS) / seq_time / 1e6,
+	       res.join_time > 0 ? ((double) NR + NS) / res.join_time / 1e6 : 0.0);
+}
+
+// function : test()
+// description : Check the output against a nested count: for every key,
+//               the rows of r and s with that key give the expected
+//               pairs (or rows, for the semi join). Both lists are
+//               sorted and compared.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	long long i, n = 0;
+	int k;
+
+	if (TEST_MODE) {
+
+		int *rs = (int*) calloc((size_t) D + 1, sizeof(int)); //rows of s per key, prefix summed
+		int *ss = (int*) malloc((size_t) NS * sizeof(int));   //rows of s grouped by key
+		int *fill;
+
+		if (rs == NULL || ss == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+		for (i = 0; i < NS; i++)
+			rs[s[i] + 1]++;
+		for (k = 0; k < D; k++)
+			rs[k+1] += rs[k];
+		fill = (int*) malloc((size_t) D * sizeof(int));
+		if (fill == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+		memcpy(fill, rs, (size_t) D * sizeof(int));
+		for (i = 0; i < NS; i++)
+			ss[fill[s[i]]++] = (int) i;
+
+		for (i = 0; i < NR; i++) {
+			int m = rs[r[i] + 1] - rs[r[i]];
+			n += (KIND == JOIN_SEMI) ? (m > 0) : m;
+		}
+
+		int ok = (n == res.n);
+		if (ok) {
+			int *exp = (int*) malloc(2 * ((size_t) n + 1) * sizeof(int));
+			int *got = (int*) malloc(2 * ((size_t) n + 1) * sizeof(int));
+			long long c = 0;
+			int j;
+
+			if (exp == NULL || got == NULL) {
+				printf("Error allocating memory.\n");
+				exit(4);
+			}
+			for (i = 0; i < NR; i++) {
+				for (j = rs[r[i]]; j < rs[r[i] + 1]; j++) {
+					exp[2*c]   = (int) i;
+					exp[2*c+1] = (KIND == JOIN_SEMI) ? 0 : ss[j];
+					c++;
+					if (KIND == JOIN_SEMI)
+						break;
+				}
+			}
+			for (i = 0; i < n; i++) {
+				got[2*i]   = res.left[i];
+				got[2*i+1] = (KIND == JOIN_SEMI) ? 0 : res.right[i];
+			}
+			qsort(exp, n, 2 * sizeof(int), cmp_pair);
+			qsort(got, n, 2 * sizeof(int), cmp_pair);
+			ok = (memcmp(exp, got, 2 * (size_t) n * sizeof(int)) == 0);
+
+			free(exp);
+			free(got);
+		}
+
+		if (ok)
+			printf("Test PASSED. Same results with a counting join.\n");
+		else
+			printf("Test NOT PASSED. Different results with a counting join.\n");
+
+		free(rs);
+		free(ss);
+		free(fill);
+	}
+}
+
+// function : cmp_pair()
+// description : qsort comparator of (left,right) pairs.
+//---------------------------------------------------------------------
+
+int cmp_pair(const void *x, const void *y)
+{
+	const int *a = (const int*) x;
+	const int *b = (const int*) y;
+
+	if (a[0] != b[0])
+		return (a[0] > b[0]) - (a[0] < b[0]);
+	return (a[1] > b[1]) - (a[1] < b[1]);
+}
+
+// function : elapsed()
+// description : Seconds between two gettimeofday() samples.
+//---------------------------------------------------------------------
+
+double elapsed(struct timeval *t0, struct timeval *t1)
+{
+	return (double) ( (t1->tv_usec - t0->tv_usec) / 1.0e6
+	                + t1->tv_sec - t0->tv_sec );
+}
@@ -0,0 +1,780 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <omp.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "../common/bitonic_kernels.h"
+#include "../common/bitonic_engine.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+const char* JSON_FLAG = "-json\0";
+const int JSON_FLAG_LENGTH = 5;
+
+const char* DES_FLAG = "-des\0";
+const int DES_FLAG_LENGTH = 4;
+
+const char* TYPE_FLAG = "--type\0";
+const int TYPE_FLAG_LENGTH = 6;
+
+const char* DIST_FLAG = "--dist\0";
+const int DIST_FLAG_LENGTH = 6;
+
+const char* STRIDE_FLAG = "--stride\0";
+const int STRIDE_FLAG_LENGTH = 8;
+
+const char* THREADS_FLAG = "--threads\0";
+const int THREADS_FLAG_LENGTH = 9;
+
+const char* ISA_FLAG = "--isa\0";
+const int ISA_FLAG_LENGTH = 5;
+
+const char* WARMUP_FLAG = "--warmup\0";
+const int WARMUP_FLAG_LENGTH = 8;
+
+const char* REPS_FLAG = "--reps\0";
+const int REPS_FLAG_LENGTH = 6;
+
+int TEST_MODE = 0;
+int JSON_MODE = 0; //one JSON array instead of text lines
+
+const char *kernel_names[] = { "compare", "merge", "sort", "qsort", "spawn", NULL };
+const char *type_names[]   = { "int", "kv", "u16", NULL };
+const char *dist_names[]   = { "random", "dense", "sorted", "reversed", "equal", NULL };
+const char *isa_names[]    = { "native", "scalar", NULL };
+
+#define K_COMPARE 0 //one bitonic_merge level at a given stride
+#define K_MERGE   1 //kernel_merge of a bitonic sequence
+#define K_SORT    2 //kernel_sort
+#define K_QSORT   3 //the qsort leaf with the drivers' comparators
+#define K_SPAWN   4 //start and join a thread
+
+#define T_INT 0
+#define T_KV  1
+#define T_U16 2
+
+#define D_RANDOM   0 //rand()
+#define D_DENSE    1 //rand() % N, the drivers' keys
+#define D_SORTED   2
+#define D_REVERSED 3
+#define D_EQUAL    4
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int kernel = -1; //K_*, or -1 for all of them
+int type   = T_INT;
+int dist   = D_DENSE;
+int isa    = 0;   //0 native, 1 scalar
+int dir    = 1;   //1 ascending, 0 descending
+int stride = -1;  //log2 of the compare distance (default q-1)
+int T      = 1;   //threads
+int warmup = 3;   //untimed runs before the reps
+int reps   = 10;  //timed runs
+
+int N; //number of keys
+int q; //log2(number of keys)
+
+size_t esize; //bytes per key of the type
+void  *src;   //the input, restored before every run
+void  *a;     //the keys a run works on
+
+int nresults = 0; //results printed so far (JSON separators)
+
+
+// Function Declaration
+//===========================================================
+
+void   parse_arguments(int argc,char *argv[]);
+int    lookup         (const char*, const char**, const char*);
+void   init           (void);
+void   fill           (void);
+void   bench          (int);
+void   run            (int, int);
+int    test           (int);
+void   report         (int, const double*, const double*, int);
+double now            (void);
+double cycles         (void);
+int    cmp_double     (const void*, const void*);
+long long key_at      (const void*, long);
+void   scalar_range   (int*, int, int, int);
+void   scalar_merge   (int*, int, int);
+void   scalar_sort    (int*, int, int);
+void   merge_kv       (struct kernel_kv*, int, int);
+void*  noop           (void*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	int k;
+
+	parse_arguments(argc,argv);
+	init();
+
+	if (JSON_MODE)
+		printf("[\n");
+
+	for (k = 0; kernel_names[k] != NULL; k++) {
+		if (kernel == -1 || kernel == k)
+			bench(k);
+	}
+
+	if (JSON_MODE)
+		printf("\n]\n");
+
+	free(src);
+	free(a);
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],JSON_FLAG,JSON_FLAG_LENGTH+1)) {
+			JSON_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],DES_FLAG,DES_FLAG_LENGTH+1)) {
+			dir = 0;
+		}
+		else if (!strncmp(argv[arg],TYPE_FLAG,TYPE_FLAG_LENGTH+1) && arg+1 < argc) {
+			type = lookup(argv[++arg],type_names,TYPE_FLAG);
+		}
+		else if (!strncmp(argv[arg],DIST_FLAG,DIST_FLAG_LENGTH+1) && arg+1 < argc) {
+			dist = lookup(argv[++arg],dist_names,DIST_FLAG);
+		}
+		else if (!strncmp(argv[arg],ISA_FLAG,ISA_FLAG_LENGTH+1) && arg+1 < argc) {
+			isa = lookup(argv[++arg],isa_names,ISA_FLAG);
+		}
+		else if (!strncmp(argv[arg],STRIDE_FLAG,STRIDE_FLAG_LENGTH+1) && arg+1 < argc) {
+			stride = atoi(argv[++arg]);
+		}
+		else if (!strncmp(argv[arg],THREADS_FLAG,THREADS_FLAG_LENGTH+1) && arg+1 < argc) {
+			T = atoi(argv[++arg]);
+		}
+		else if (!strncmp(argv[arg],WARMUP_FLAG,WARMUP_FLAG_LENGTH+1) && arg+1 < argc) {
+			warmup = atoi(argv[++arg]);
+		}
+		else if (!strncmp(argv[arg],REPS_FLAG,REPS_FLAG_LENGTH+1) && arg+1 < argc) {
+			reps = atoi(argv[++arg]);
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 2) {
+		printf("Usage: %s [%s] [%s] [%s] [%s int|kv|u16] [%s random|dense|sorted|reversed|equal]\n"
+		       "       [%s native|scalar] [%s s] [%s T] [%s w] [%s r] kernel q\n\n"
+		       "where, kernel is compare, merge, sort, qsort, spawn or all\n"
+		       "       N=2^q is the problem size\n"
+		       "       %s checks the output of every run\n"
+		       "       %s prints the results as a JSON array\n"
+		       "       %s sorts and merges descending\n"
+		       "       %s is the key type (int, 16-byte key-value records, 16-bit keys)\n"
+		       "       %s is the input (default dense: rand() %% N as in the drivers)\n"
+		       "       %s scalar times a plain, non-vectorized loop instead of the kernels (int only)\n"
+		       "       %s s compares at distance 2^s (compare, default q-1)\n"
+		       "       %s T runs T threads (compare splits the level, the others run\n"
+		       "            one kernel per thread on N/T keys; spawn starts T threads;\n"
+		       "            merge and sort need a power of two T, the others take any T)\n"
+		       "       %s w untimed runs first (default 3)\n"
+		       "       %s r timed runs (default 10)\n",
+		       argv[0],TEST_FLAG,JSON_FLAG,DES_FLAG,TYPE_FLAG,DIST_FLAG,ISA_FLAG,STRIDE_FLAG,THREADS_FLAG,WARMUP_FLAG,REPS_FLAG,
+		       TEST_FLAG,JSON_FLAG,DES_FLAG,TYPE_FLAG,DIST_FLAG,ISA_FLAG,STRIDE_FLAG,THREADS_FLAG,WARMUP_FLAG,REPS_FLAG);
+		exit(1);
+	}
+
+	kernel = strcmp(argv[arg],"all") ? lookup(argv[arg],kernel_names,"kernel") : -1;
+	q      = atoi(argv[arg+1]);
+
+	if (q < 1 || q > 30) {
+		printf("q must be in [1,30].\n");
+		exit(1);
+	}
+	N = 1 << q;
+
+	if (stride < 0)
+		stride = q - 1;
+
+	if (stride >= q) {
+		printf("%s s needs s < q.\n",STRIDE_FLAG);
+		exit(1);
+	}
+	if (T < 1 || T > N) {
+		printf("%s T needs T in [1,N].\n",THREADS_FLAG);
+		exit(1);
+	}
+	if ((kernel == K_MERGE || kernel == K_SORT) && (T & (T - 1)) != 0) {
+		printf("merge and sort need a power of two T (N/T keys each).\n");
+		exit(1);
+	}
+	if (warmup < 0 || reps < 1) {
+		printf("%s needs w >= 0 and %s r >= 1.\n",WARMUP_FLAG,REPS_FLAG);
+		exit(1);
+	}
+	if (isa == 1 && type != T_INT) {
+		printf("%s scalar is only there for int keys.\n",ISA_FLAG);
+		exit(1);
+	}
+	if (type == T_U16 && kernel == K_QSORT) {
+		printf("There is no qsort leaf for 16-bit keys.\n");
+		exit(1);
+	}
+}
+
+// function : lookup()
+// description : Index of name in the NULL terminated list, or exit.
+//---------------------------------------------------------------------
+
+int lookup(const char *name, const char **list, const char *what)
+{
+	int i;
+
+	for (i = 0; list[i] != NULL; i++) {
+		if (!strcmp(name,list[i]))
+			return i;
+	}
+
+	printf("Unknown %s: %s\n",what,name);
+	exit(1);
+}
+
+// function : init()
+// description : Allocate the input and the work array.
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	esize = (type == T_KV) ? sizeof(struct kernel_kv) :
+	        (type == T_U16) ? sizeof(unsigned short) : sizeof(int);
+
+	src = aligned_alloc(64, ((size_t) N * esize + 63) & ~(size_t) 63);
+	a   = aligned_alloc(64, ((size_t) N * esize + 63) & ~(size_t) 63);
+	if (src == NULL || a == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	srand( time(NULL) );
+}
+
+// function : fill()
+// description : Draw a new input in the chosen distribution and store
+//               it in src as the key type.
+//---------------------------------------------------------------------
+
+void fill(void)
+{
+	long i;
+
+	for (i = 0; i < N; i++) {
+
+		int x;
+		switch (dist) {
+		case D_RANDOM:   x = rand();                 break;
+		case D_DENSE:    x = rand() % N;             break;
+		case D_SORTED:   x = (int) i;                break;
+		case D_REVERSED: x = (int) (N - 1 - i);      break;
+		default:         x = 42;                     break;
+		}
+
+		if (type == T_INT) {
+			((int*) src)[i] = x;
+		}
+		else if (type == T_KV) {
+			((struct kernel_kv*) src)[i].key = (unsigned int) x;
+			((struct kernel_kv*) src)[i].val = (unsigned int) i;
+		}
+		else {
+			((unsigned short*) src)[i] = (unsigned short) x;
+		}
+	}
+}
+
+// function : bench()
+// description : Time kernel k: warm-up runs, then reps timed runs, each
+//               on a fresh copy of the input. The copy is made by the
+//               master between two barriers, so the time is the
+//               kernel's alone; the team is started once, before the
+//               runs, and its cost is what the spawn kernel measures.
+//               Every kernel gets a new input.
+//---------------------------------------------------------------------
+
+void bench(int k)
+{
+	double *ns, *cyc;
+	int     r, chunk = N / T, passed = 1;
+
+	if (k == K_QSORT && type == T_U16)
+		return;
+	if ((k == K_MERGE || k == K_SORT) && (T & (T - 1)) != 0)
+		return;
+
+	ns  = (double*) malloc(reps * sizeof(double));
+	cyc = (double*) malloc(reps * sizeof(double));
+	if (ns == NULL || cyc == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	fill();
+
+	if (k == K_SPAWN) {
+
+		pthread_t *th = (pthread_t*) malloc(T * sizeof(pthread_t));
+		int        t;
+
+		if (th == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+
+		for (r = -warmup; r < reps; r++) {
+
+			double t0 = now(), c0 = cycles();
+			for (t = 0; t < T; t++)
+				pthread_create(&th[t], NULL, noop, NULL);
+			for (t = 0; t < T; t++)
+				pthread_join(th[t], NULL);
+			double c1 = cycles(), t1 = now();
+
+			if (r >= 0) {
+				ns[r]  = (t1 - t0) * 1e9;
+				cyc[r] = c1 - c0;
+			}
+		}
+
+		free(th);
+		report(k, ns, cyc, 1);
+		free(ns);
+		free(cyc);
+		return;
+	}
+
+	// merge needs bitonic runs: the first half of every thread's run
+	// ascending, the second half descending
+	if (k == K_MERGE) {
+		long c;
+		for (c = 0; c < N; c += chunk) {
+			memcpy(a, (char*) src + c * esize, chunk * esize);
+			if (type == T_INT)
+				qsort(a, chunk, esize, engine_cmp_asc);
+			else if (type == T_KV)
+				qsort(a, chunk, esize, engine_cmp_kv_asc);
+			else
+				kernel_sort_u16((unsigned short*) a, chunk, 1);
+			if (chunk > 1) {
+				long i, h = chunk / 2;
+				char *x = (char*) a + h * esize, tmp[sizeof(struct kernel_kv)];
+				for (i = 0; i < h / 2; i++) {
+					memcpy(tmp, x + i * esize, esize);
+					memcpy(x + i * esize, x + (h - 1 - i) * esize, esize);
+					memcpy(x + (h - 1 - i) * esize, tmp, esize);
+				}
+			}
+			memcpy((char*) src + c * esize, a, chunk * esize);
+		}
+	}
+
+	#pragma omp parallel num_threads(T) private(r)
+	{
+		double t0 = 0, c0 = 0;
+
+		for (r = -warmup; r < reps; r++) {
+
+			#pragma omp master
+			memcpy(a, src, (size_t) N * esize);
+
+			#pragma omp barrier
+
+			#pragma omp master
+			{
+				t0 = now();
+				c0 = cycles();
+			}
+
+			run(k, omp_get_thread_num());
+
+			#pragma omp barrier
+
+			#pragma omp master
+			{
+				double c1 = cycles(), t1 = now();
+				if (r >= 0) {
+					ns[r]  = (t1 - t0) * 1e9;
+					cyc[r] = c1 - c0;
+				}
+				if (TEST_MODE && !test(k))
+					passed = 0;
+			}
+
+			#pragma omp barrier
+		}
+	}
+
+	report(k, ns, cyc, passed);
+	free(ns);
+	free(cyc);
+}
+
+// function : run()
+// description : Thread t's share of one run of kernel k on a[].
+//               compare: pairs [t*N/2T, (t+1)*N/2T) of the level at
+//               distance 2^stride, cut at the blocks of 2^(stride+1).
+//               merge, sort, qsort: keys [t*N/T, (t+1)*N/T). Any T
+//               splits evenly (merge and sort only get a power of two).
+//---------------------------------------------------------------------
+
+void run(int k, int t)
+{
+	long lo = (long) t * N / T, chunk = (long) (t + 1) * N / T - lo;
+
+	if (k == K_COMPARE) {
+
+		long d  = 1L << stride;
+		long j0 = (long) t * (N / 2) / T, j1 = (long) (t + 1) * (N / 2) / T;
+
+		while (j0 < j1) {
+
+			long b = j0 / d, o = j0 % d;
+			long len = (d - o < j1 - j0) ? d - o : j1 - j0;
+			long at  = b * 2 * d + o;
+
+			if (isa == 1)
+				scalar_range((int*) a + at, len, d, dir);
+			else if (type == T_INT)
+				kernel_compare_range((int*) a + at, len, d, dir);
+			else if (type == T_KV)
+				kernel_compare_range_kv((struct kernel_kv*) a + at, len, d, dir);
+			else
+				kernel_compare_range_u16((unsigned short*) a + at, len, d, dir);
+			j0 += len;
+		}
+	}
+	else if (k == K_MERGE) {
+
+		if (isa == 1)
+			scalar_merge((int*) a + lo, chunk, dir);
+		else if (type == T_INT)
+			kernel_merge((int*) a + lo, chunk, dir);
+		else if (type == T_KV)
+			merge_kv((struct kernel_kv*) a + lo, chunk, dir);
+		else
+			kernel_merge_u16((unsigned short*) a + lo, chunk, dir);
+	}
+	else if (k == K_SORT) {
+
+		if (isa == 1)
+			scalar_sort((int*) a + lo, chunk, dir);
+		else if (type == T_INT)
+			kernel_sort((int*) a + lo, chunk, dir);
+		else if (type == T_KV)
+			kernel_sort_kv((struct kernel_kv*) a + lo, chunk, dir);
+		else
+			kernel_sort_u16((unsigned short*) a + lo, chunk, dir);
+	}
+	else if (k == K_QSORT) {
+
+		if (type == T_INT)
+			qsort((int*) a + lo, chunk, sizeof(int), dir ? engine_cmp_asc : engine_cmp_des);
+		else
+			qsort((struct kernel_kv*) a + lo, chunk, sizeof(struct kernel_kv),
+			      dir ? engine_cmp_kv_asc : engine_cmp_kv_des);
+	}
+}
+
+// function : test()
+// description : Check the result of one run of kernel k: every pair of
+//               the level (compare) or every thread's run (the others)
+//               in order, and the same key sum as the input.
+//---------------------------------------------------------------------
+
+int test(int k)
+{
+	long long s0 = 0, s1 = 0;
+	long i, t = 0, d = 1L << stride;
+
+	for (i = 0; i < N; i++) {
+		s0 += key_at(src, i);
+		s1 += key_at(a, i);
+	}
+	if (s0 != s1)
+		return 0;
+
+	for (i = 0; i < N; i++) {
+
+		long j;
+		if (k == K_COMPARE) {
+			if ((i / d) & 1)
+				continue;
+			j = i + d;
+		}
+		else {
+			//i + 1 starts the next thread's run
+			while (t < T && (long) (t + 1) * N / T <= i + 1)
+				t++;
+			if ((long) t * N / T == i + 1)
+				continue;
+			j = i + 1;
+		}
+
+		if (dir ? key_at(a, i) > key_at(a, j) : key_at(a, i) < key_at(a, j))
+			return 0;
+	}
+	return 1;
+}
+
+// function : report()
+// description : Print kernel k's min, median and mean over the reps, in
+//               ns and TSC cycles per key (per thread for spawn), as a
+//               text line or a JSON object.
+//---------------------------------------------------------------------
+
+void report(int k, const double *ns, const double *cyc, int passed)
+{
+	double *s = (double*) malloc(2 * reps * sizeof(double));
+	double  per = (k == K_SPAWN) ? T : N;
+	double  mean = 0, cmean = 0;
+	int     r;
+
+	if (s == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	for (r = 0; r < reps; r++) {
+		s[r]        = ns[r] / per;
+		s[reps + r] = cyc[r] / per;
+		mean  += s[r] / reps;
+		cmean += s[reps + r] / reps;
+	}
+	qsort(s, reps, sizeof(double), cmp_double);
+	qsort(s + reps, reps, sizeof(double), cmp_double);
+
+	double med  = (s[(reps - 1) / 2] + s[reps / 2]) / 2;
+	double cmed = (s[reps + (reps - 1) / 2] + s[reps + reps / 2]) / 2;
+
+	const char *isa_name = (isa == 1) ? "scalar" : kernel_isa();
+	const char *unit     = (k == K_SPAWN) ? "thread" : "key";
+
+	if (JSON_MODE) {
+		printf("%s  {\"kernel\": \"%s\", \"type\": \"%s\", \"dist\": \"%s\", \"isa\": \"%s\", "
+		       "\"dir\": \"%s\", \"n\": %d, \"stride\": %ld, \"threads\": %d, "
+		       "\"warmup\": %d, \"reps\": %d, \"unit\": \"%s\", "
+		       "\"ns_min\": %.4f, \"ns_median\": %.4f, \"ns_mean\": %.4f",
+		       nresults ? ",\n" : "", kernel_names[k], type_names[type], dist_names[dist],
+		       isa_name, dir ? "asc" : "des", N, (k == K_COMPARE) ? 1L << stride : 0L, T,
+		       warmup, reps, unit, s[0], med, mean);
+#ifdef HAVE_TSC
+		printf(", \"cycles_min\": %.4f, \"cycles_median\": %.4f, \"cycles_mean\": %.4f",
+		       s[reps], cmed, cmean);
+#else
+		printf(", \"cycles_min\": null, \"cycles_median\": null, \"cycles_mean\": null");
+#endif
+		if (TEST_MODE)
+			printf(", \"passed\": %s", passed ? "true" : "false");
+		printf("}");
+	}
+	else {
+		printf("%-7s", kernel_names[k]);
+		if (k != K_SPAWN)
+			printf(" %s %s %s", type_names[type], dist_names[dist], isa_name);
+		if (k == K_COMPARE)
+			printf(" stride 2^%d", stride);
+		printf(" T=%d: %.3f ns/%s (min %.3f, mean %.3f)", T, med, unit, s[0], mean);
+#ifdef HAVE_TSC
+		printf(", %.2f cycles/%s", cmed, unit);
+#endif
+		printf("\n");
+		if (TEST_MODE && k != K_SPAWN) {
+			if (passed)
+				printf("Test PASSED. Every run is in order.\n");
+			else
+				printf("Test NOT PASSED. A run is out of order or lost keys.\n");
+		}
+	}
+
+	nresults++;
+	free(s);
+}
+
+// function : now()
+// description : Monotonic time in seconds.
+//---------------------------------------------------------------------
+
+double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// function : cycles()
+// description : Time stamp counter, read after all earlier instructions
+//               have finished (rdtscp) and before any later one starts
+//               (lfence). It ticks at the nominal frequency, so with
+//               turbo or power saving it is not the core's cycles.
+//               0 where there is no TSC.
+//---------------------------------------------------------------------
+
+double cycles(void)
+{
+#ifdef HAVE_TSC
+	unsigned int aux;
+	unsigned long long c = __rdtscp(&aux);
+	_mm_lfence();
+	return (double) c;
+#else
+	return 0;
+#endif
+}
+
+// function : cmp_double()
+// description : qsort comparator of the per-run times.
+//---------------------------------------------------------------------
+
+int cmp_double(const void *x, const void *y)
+{
+	double a = *(const double*) x, b = *(const double*) y;
+	return (a > b) - (a < b);
+}
+
+// function : key_at()
+// description : Key i of an array of the key type, as a long long.
+//---------------------------------------------------------------------
+
+long long key_at(const void *v, long i)
+{
+	if (type == T_INT)
+		return ((const int*) v)[i];
+	if (type == T_KV)
+		return (long long) ((const struct kernel_kv*) v)[i].key;
+	return ((const unsigned short*) v)[i];
+}
+
+// function : scalar_range()
+// description : kernel_compare_range() as a plain loop the compiler
+//               may not vectorize (--isa scalar).
+//---------------------------------------------------------------------
+
+__attribute__((optimize("no-tree-vectorize")))
+void scalar_range(int *v, int cnt, int dist, int dir)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		int x = v[i], y = v[i + dist];
+		if ((x > y) == dir) {
+			v[i]        = y;
+			v[i + dist] = x;
+		}
+	}
+}
+
+// function : scalar_merge()
+// description : Bitonic merge of v[0..cnt) with scalar_range().
+//---------------------------------------------------------------------
+
+void scalar_merge(int *v, int cnt, int dir)
+{
+	int d, b;
+
+	for (d = cnt / 2; d > 0; d /= 2) {
+		for (b = 0; b < cnt; b += 2 * d)
+			scalar_range(v + b, d, d, dir);
+	}
+}
+
+// function : scalar_sort()
+// description : Bitonic sort of v[0..cnt) with scalar_merge(): the
+//               blocks of every size alternate direction, the last
+//               one is merged in dir.
+//---------------------------------------------------------------------
+
+void scalar_sort(int *v, int cnt, int dir)
+{
+	int k, b;
+
+	for (k = 2; k <= cnt; k *= 2) {
+		for (b = 0; b < cnt; b += k)
+			scalar_merge(v + b, k, ((b / k) & 1) ? !dir : dir);
+	}
+}
+
+// function : merge_kv()
+// description : Bitonic merge of key-value records: compare levels down
+//               to the unrolled network, as the engine merges them.
+//---------------------------------------------------------------------
+
+void merge_kv(struct kernel_kv *v, int cnt, int dir)
+{
+	if (cnt <= KERNEL_MAX_CNT) {
+		kernel_merge_small_kv(v, cnt, dir);
+		return;
+	}
+
+	kernel_compare_range_kv(v, cnt / 2, cnt / 2, dir);
+	merge_kv(v, cnt / 2, dir);
+	merge_kv(v + cnt / 2, cnt / 2, dir);
+}
+
+// function : noop()
+// description : Body of the spawned threads.
+//---------------------------------------------------------------------
+
+void* noop(void *ptr)
+{
+	return ptr;
+}
@@ -0,0 +1,431 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+
+#include "../common/bitonic_engine.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+const char* NOOVERLAP_FLAG = "-nooverlap\0";
+const int NOOVERLAP_FLAG_LENGTH = 10;
+
+int TEST_MODE = 0;
+int OVERLAP   = 1; //segmented exchange overlapped with the merge
+
+// for time measurements
+double startwtime, endwtime;
+double seq_time;
+
+double sort_time  = 0; //local sort of the block
+double merge_time = 0; //merge-splits, without the waits
+double comm_time  = 0; //exchanges and waits for the partner's keys
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int *a; //my block, sorted ascending between the stages
+int *c; //merge-split output, swapped with a
+int *r; //partner's block
+int *b; //whole array sorted with stdlib.h/qsort (rank 0, test mode)
+int *g; //gathered result (rank 0, test mode)
+
+int N;        //problem size
+int Nloc;     //keys per rank
+int T;        //threads per rank for the local sort
+int t;        //log2(threads per rank)
+int q;        //log2(problem size)
+int rank;
+int nranks;   //number of ranks (P), a power of two
+
+const int SEGMENTS = 16; //pieces of a block exchange in overlapped mode
+
+int          nseg;   //segments per block
+int          seglen; //keys per segment (last one may be shorter)
+MPI_Request *sreq;   //pending sends, one per segment
+MPI_Request *rreq;   //pending receives, one per segment
+
+
+// Function Declaration
+//===========================================================
+
+void parse_arguments(int argc,char *argv[]);
+void init           (void);
+void exec           (void);
+void test           (void);
+void clear          (void);
+void merge_split    (int,int);
+void exchange_post  (int,int);
+void segment_wait   (int);
+int  cmpfunc        (const void*, const void*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+	MPI_Comm_size(MPI_COMM_WORLD,&nranks);
+
+	parse_arguments(argc,argv);
+	init           ();
+	exec           ();
+	test           ();
+	clear          ();
+
+	MPI_Finalize();
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],NOOVERLAP_FLAG,NOOVERLAP_FLAG_LENGTH+1)) {
+			OVERLAP = 0;
+		}
+		else {
+			if (rank == 0)
+				printf("Illegal flag received: %s\n",argv[arg]);
+			MPI_Finalize();
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 2) {
+		if (rank == 0)
+			printf("Usage: mpirun -np P %s [%s] [%s] t q\n\nwhere, %s is an optional flag (test mode)\n       %s exchanges whole blocks with MPI_Sendrecv before merging\n       P is the number of ranks (a power of two)\n       T=2^t is the number of threads per rank\n       N=2^q is the problem size\n",
+			       argv[0],TEST_FLAG,NOOVERLAP_FLAG,TEST_FLAG,NOOVERLAP_FLAG);
+		MPI_Finalize();
+		exit(1);
+	}
+
+	t = atoi(argv[arg]);
+	q = atoi(argv[arg+1]);
+
+	T = 1 << t;
+	N = 1 << q;
+
+	if ((nranks & (nranks - 1)) != 0 || nranks > N) {
+		if (rank == 0)
+			printf("The number of ranks must be a power of two, at most 2^q.\n");
+		MPI_Finalize();
+		exit(1);
+	}
+
+	Nloc = N / nranks;
+}
+
+// function : init()
+// description : Allocate my block and the exchange buffers, and fill
+//               the block with random keys. In test mode rank 0 also
+//               gathers the input.
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	a = (int*) malloc(Nloc * sizeof(int));
+	c = (int*) malloc(Nloc * sizeof(int));
+	r = (int*) malloc(Nloc * sizeof(int));
+
+	nseg   = (Nloc < SEGMENTS) ? Nloc : SEGMENTS;
+	seglen = (Nloc + nseg - 1) / nseg;
+	nseg   = (Nloc + seglen - 1) / seglen;
+	sreq   = (MPI_Request*) malloc(nseg * sizeof(MPI_Request));
+	rreq   = (MPI_Request*) malloc(nseg * sizeof(MPI_Request));
+
+	if (a == NULL || c == NULL || r == NULL || sreq == NULL || rreq == NULL) {
+		printf("Error allocating memory.\n");
+		MPI_Abort(MPI_COMM_WORLD,4);
+	}
+
+	if (TEST_MODE && rank == 0) {
+		b = (int*) malloc(N * sizeof(int));
+		g = (int*) malloc(N * sizeof(int));
+		if (b == NULL || g == NULL) {
+			printf("Error allocating memory.\n");
+			MPI_Abort(MPI_COMM_WORLD,4);
+		}
+	}
+
+	//initialize my block
+	srand( time(NULL) ^ (rank * 7919) );
+	int i;
+	for (i = 0; i < Nloc; i++) {
+		a[i] = rand() % N;
+	}
+
+	if (TEST_MODE) {
+		MPI_Gather(a,Nloc,MPI_INT,b,Nloc,MPI_INT,0,MPI_COMM_WORLD);
+	}
+}
+
+// function : exec()
+// description : Sort my block locally, then run the log^2 P bitonic
+//               stages between the ranks. Every compare-exchange of
+//               the network becomes a merge-split of two sorted blocks:
+//               the partners trade blocks and one keeps the lower half
+//               of the union, the other the upper half. The blocks stay
+//               sorted ascending, only the choice of half follows the
+//               direction of the stage. Prints the time and the
+//               compute/communication split (max over the ranks).
+//---------------------------------------------------------------------
+
+void exec(void)
+{
+	double t0;
+	int j, k;
+
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	// start measuring time
+	startwtime = MPI_Wtime();
+
+	t0 = MPI_Wtime();
+	engine_sort(a,Nloc,ENGINE_ASCENDING,T);
+	sort_time = MPI_Wtime() - t0;
+
+	for (k = 2; k <= nranks; k <<= 1) {
+
+		for (j = k/2; j > 0; j >>= 1) {
+
+			int partner = rank ^ j;
+			int up      = (rank & k) == 0;
+			int keep_lo = ((rank & j) == 0) == up;
+
+			merge_split(partner,keep_lo);
+		}
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	// stop measuring time
+	endwtime = MPI_Wtime();
+
+	seq_time = endwtime - startwtime;
+
+	double local[3] = { sort_time, merge_time, comm_time };
+	double worst[3];
+	MPI_Reduce(local,worst,3,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
+
+	if (rank == 0) {
+
+		// print time
+		printf("%lf\n",seq_time);
+
+		printf("local sort %lf s, merge %lf s, communication %lf s (%s, max over %d ranks)\n",
+		       worst[0],worst[1],worst[2],
+		       OVERLAP ? "overlapped" : "MPI_Sendrecv",nranks);
+	}
+}
+
+// function : merge_split()
+// description : Trade blocks with partner and keep the lower (keep_lo)
+//               or the upper half of the two. Overlapped mode sends the
+//               block in segments, in the order the partner consumes
+//               them, and the merge waits for each segment only when it
+//               first needs a key from it.
+//---------------------------------------------------------------------
+
+void merge_split(int partner, int keep_lo)
+{
+	double t0 = MPI_Wtime();
+	double waited;
+	int i, im, ir;
+
+	if (OVERLAP) {
+		exchange_post(partner,keep_lo);
+	}
+	else {
+		MPI_Sendrecv(a,Nloc,MPI_INT,partner,0,
+		             r,Nloc,MPI_INT,partner,0,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+	}
+
+	waited = MPI_Wtime() - t0;
+	comm_time += waited;
+
+	double t1 = MPI_Wtime();
+	double w0 = comm_time;
+
+	if (keep_lo) {
+
+		int seen = -1; //last segment known to have arrived
+		im = 0; ir = 0;
+		for (i = 0; i < Nloc; i++) {
+
+			if (ir / seglen != seen) {
+				seen = ir / seglen;
+				segment_wait(seen);
+			}
+
+			c[i] = (a[im] <= r[ir]) ? a[im++] : r[ir++];
+		}
+	}
+	else {
+
+		int seen = nseg;
+		im = Nloc - 1; ir = Nloc - 1;
+		for (i = Nloc - 1; i >= 0; i--) {
+
+			if (ir / seglen != seen) {
+				seen = ir / seglen;
+				segment_wait(seen);
+			}
+
+			c[i] = (a[im] > r[ir]) ? a[im--] : r[ir--];
+		}
+	}
+
+	// a may still be in flight to the partner
+	if (OVERLAP) {
+		double t2 = MPI_Wtime();
+		MPI_Waitall(nseg,sreq,MPI_STATUSES_IGNORE);
+		MPI_Waitall(nseg,rreq,MPI_STATUSES_IGNORE);
+		comm_time += MPI_Wtime() - t2;
+	}
+
+	merge_time += (MPI_Wtime() - t1) - (comm_time - w0);
+
+	int *tmp = a;
+	a = c;
+	c = tmp;
+}
+
+// function : exchange_post()
+// description : Post the segment receives in the order the merge reads
+//               r, and the sends in the order the partner reads them
+//               (it keeps the other half).
+//---------------------------------------------------------------------
+
+void exchange_post(int partner, int keep_lo)
+{
+	int s;
+
+	for (s = 0; s < nseg; s++) {
+
+		int rs = keep_lo ? s : nseg - 1 - s; //the partner reads from the other end
+		int ss = keep_lo ? nseg - 1 - s : s;
+
+		int rlen = (rs == nseg - 1) ? Nloc - rs*seglen : seglen;
+		int slen = (ss == nseg - 1) ? Nloc - ss*seglen : seglen;
+
+		MPI_Irecv(r + rs*seglen,rlen,MPI_INT,partner,rs,MPI_COMM_WORLD,&rreq[rs]);
+		MPI_Isend(a + ss*seglen,slen,MPI_INT,partner,ss,MPI_COMM_WORLD,&sreq[ss]);
+	}
+}
+
+// function : segment_wait()
+// description : Wait for segment s of the partner's block.
+//---------------------------------------------------------------------
+
+void segment_wait(int s)
+{
+	if (!OVERLAP)
+		return;
+
+	double t0 = MPI_Wtime();
+	MPI_Wait(&rreq[s],MPI_STATUS_IGNORE);
+	comm_time += MPI_Wtime() - t0;
+}
+
+// function : test()
+// description : Gather the blocks on rank 0 and check them against
+//               the stdlib/qsort.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	if (TEST_MODE) {
+
+		MPI_Gather(a,Nloc,MPI_INT,g,Nloc,MPI_INT,0,MPI_COMM_WORLD);
+
+		if (rank != 0)
+			return;
+
+		//sort secondary array
+		qsort(b,N,sizeof(int),cmpfunc);
+
+		//compare the results
+		int passed = 1;
+		int i;
+		for (i = 0; i < N; i++) {
+
+			if (g[i] != b[i]) {
+				passed = 0;
+				break;
+			}
+		}
+
+		if (passed) {
+			printf("Test PASSED. Same results with stdlib/qsort.\n");
+		}
+		else {
+			printf("Test NOT PASSED. Different results with stdlib/qsort.\n");
+		}
+	}
+}
+
+// function : clear()
+// description : Clear all allocated space from memory.
+//---------------------------------------------------------------------
+
+void clear(void)
+{
+	free(a);
+	free(c);
+	free(r);
+	free(sreq);
+	free(rreq);
+	if (TEST_MODE && rank == 0) {
+		free(b);
+		free(g);
+	}
+}
+
+int cmpfunc(const void* a, const void* b)
+{
+	return ( (*(int*)a > *(int*)b) - (*(int*)a < *(int*)b) );
+}
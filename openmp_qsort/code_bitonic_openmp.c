@@ -25,6 +25,18 @@
 #include <sys/time.h>
 #include <omp.h>
 
+#include "../common/bitonic_kernels.h"
+#include "../common/sort_io.h"
+#include "../common/adaptive_bitonic.h"
+#include "../common/presort.h"
+#include "../common/keyrange.h"
+#include "../common/sort_dispatch.h"
+#include "../common/stream_merge.h"
+#include "../common/remap.h"
+#include "../common/pack_io.h"
+#include "../common/roofline.h"
+#include "../common/sample_sort.h"
+
 
 // Constants & Variables (Test Related)
 //===========================================================
@@ -32,12 +44,78 @@
 const char* TEST_FLAG = "-test\0";
 const int TEST_FLAG_LENGTH = 5; 
 
+const char* ITER_FLAG = "-iter\0";
+const int ITER_FLAG_LENGTH = 5;
+
+const char* ROOFLINE_FLAG = "-roofline\0";
+const int ROOFLINE_FLAG_LENGTH = 9;
+
+const char* SAMPLE_FLAG = "-sample\0";
+const int SAMPLE_FLAG_LENGTH = 7;
+
+const char* ABS_FLAG = "-abs\0";
+const int ABS_FLAG_LENGTH = 4;
+
+const char* ODDEVEN_FLAG = "-oddeven\0";
+const int ODDEVEN_FLAG_LENGTH = 8;
+
+const char* STREAM_FLAG = "-stream\0";
+const int STREAM_FLAG_LENGTH = 7;
+
+const char* REMAP_FLAG = "-remap\0";
+const int REMAP_FLAG_LENGTH = 6;
+
+const char* PRESORT_FLAG = "-presort\0";
+const int PRESORT_FLAG_LENGTH = 8;
+
+const char* KEYRANGE_FLAG = "-keyrange\0";
+const int KEYRANGE_FLAG_LENGTH = 9;
+
+const char* NODISPATCH_FLAG = "-nodispatch\0";
+const int NODISPATCH_FLAG_LENGTH = 11;
+
+const char* THREADS_FLAG = "--threads\0";
+const int THREADS_FLAG_LENGTH = 9;
+
+const char* IN_FLAG = "--in\0";
+const int IN_FLAG_LENGTH = 4;
+
+const char* OUT_FLAG = "--out\0";
+const int OUT_FLAG_LENGTH = 5;
+
+const char* DIRECT_FLAG = "--direct\0";
+const int DIRECT_FLAG_LENGTH = 8;
+
+const char* PACK_FLAG = "--pack\0";
+const int PACK_FLAG_LENGTH = 6;
+
 int TEST_MODE = 0;
+int ITER_MODE = 0; //iterative stage-parallel schedule instead of recursion
+int ROOFLINE_MODE = 0; //time the phases of -iter against the machine's peaks
+int SAMPLE_MODE = 0; //parallel sample sort instead of bitonic sort
+int ABS_MODE = 0; //adaptive bitonic merge (O(n) work per merge)
+int ODDEVEN_MODE = 0; //Batcher's odd-even merge instead of the bitonic merge
+int STREAM_MODE = 0; //out-of-place merge levels with streaming stores
+int REMAP_MODE = 0; //blocked <-> cyclic remapping, thread-local merges
+int PRESORT_MODE = 0; //presortedness pre-pass before the sort
+int KEYRANGE_MODE = 0; //key-range pre-pass before the sort
+int DISPATCH_MODE = 1; //thread count from the dispatcher's cost model
+int ENGINE_MODE = 0; //an engine flag was given, it runs even on a serial plan
+int THREADS_MODE = 0; //P given directly (--threads T, any T >= 1)
+int DIRECT_MODE = 0; //O_DIRECT reads/writes instead of mmap
+
+const char *in_file  = NULL; //keys from a binary file instead of random
+const char *out_file = NULL; //sorted keys to a file (default: in place)
+const char *pack_file = NULL; //sorted keys also written compressed
 
 // for time measurements
 struct timeval startwtime, endwtime;
 double seq_time; 
 
+struct presort_stats presort_st; //what the pre-pass measured (-presort)
+struct keyrange_stats keyrange_st; //what the key-range pre-pass found (-keyrange)
+struct dispatch_plan  dispatch;   //path and threads picked by the dispatcher
+
 
 // Constants & Variables (Algorithm Related)
 //===========================================================
@@ -63,7 +141,11 @@ struct args {
 	int dir;
 }; // arguments to pass to recursive bitonic sort function
 
-const int parallel_threshold = 1<<21;
+const int max_leaf          = 1<<21; //largest qsort leaf
+const int leaves_per_thread = 4;     //leaves per thread, so that any T balances
+const int merge_grain       = 1<<16; //smallest chunk of a split compare level
+
+int parallel_threshold = 1<<21; //leaf size, set in init() from N and the threads
 
 
 // Function Declaration
@@ -73,11 +155,19 @@ void parse_arguments        (int argc,char *argv[]);
 void init                   (void);
 void create_threads_and_exec(void);
 int  cmpfunc                (const void*, const void*);
+void pack_output            (void);
 void test                   (void);
 void clear                  (void);
+long long count_comparators (int,int);
 void rec_bitonic_sort       (int,int,int);
 void bitonic_merge          (int,int,int);
-void compare                (int, int, int);
+void oddeven_merge          (int,int,int);
+void fork_tasks             (abs_task,void*,void*);
+void merge_block            (int,int,int,int);
+void iter_bitonic_sort      (void);
+void remap_bitonic_sort     (void);
+void iter_compare_stride    (int,int,int);
+int  iter_blocks            (void);
 int  cmpfunc_asc            (const void*, const void*);
 int  cmpfunc_des            (const void*, const void*);
 
@@ -90,6 +180,7 @@ int main(int argc, char *argv[])
 	parse_arguments        (argc,argv);
 	init                   ();
 	create_threads_and_exec();
+	pack_output            ();
 	test                   ();
 	clear                  ();
 
@@ -108,29 +199,110 @@ int main(int argc, char *argv[])
 
 void parse_arguments(int argc, char *argv[])
 {
-	if (argc != 3 && argc != 4) {
-		printf("Usage: %s %s p q\n\nwhere, %s is an optional flag (test mode)\n       P=2^p is the maximum number of parallel threads\n       N=2^q is the problem size\n",argv[0],TEST_FLAG,TEST_FLAG); 
+	// optional flags come first
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],ITER_FLAG,ITER_FLAG_LENGTH+1)) {
+			ITER_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],ROOFLINE_FLAG,ROOFLINE_FLAG_LENGTH+1)) {
+			ROOFLINE_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],SAMPLE_FLAG,SAMPLE_FLAG_LENGTH+1)) {
+			SAMPLE_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],ABS_FLAG,ABS_FLAG_LENGTH+1)) {
+			ABS_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],ODDEVEN_FLAG,ODDEVEN_FLAG_LENGTH+1)) {
+			ODDEVEN_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],STREAM_FLAG,STREAM_FLAG_LENGTH+1)) {
+			STREAM_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],REMAP_FLAG,REMAP_FLAG_LENGTH+1)) {
+			REMAP_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],PRESORT_FLAG,PRESORT_FLAG_LENGTH+1)) {
+			PRESORT_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],KEYRANGE_FLAG,KEYRANGE_FLAG_LENGTH+1)) {
+			KEYRANGE_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],NODISPATCH_FLAG,NODISPATCH_FLAG_LENGTH+1)) {
+			DISPATCH_MODE = 0;
+		}
+		else if (!strncmp(argv[arg],THREADS_FLAG,THREADS_FLAG_LENGTH+1) && arg+1 < argc) {
+			THREADS_MODE = 1;
+			DISPATCH_MODE = 0; //an explicit thread count is used as given
+			P = atoi(argv[++arg]);
+		}
+		else if (!strncmp(argv[arg],IN_FLAG,IN_FLAG_LENGTH+1) && arg+1 < argc) {
+			in_file = argv[++arg];
+		}
+		else if (!strncmp(argv[arg],OUT_FLAG,OUT_FLAG_LENGTH+1) && arg+1 < argc) {
+			out_file = argv[++arg];
+		}
+		else if (!strncmp(argv[arg],PACK_FLAG,PACK_FLAG_LENGTH+1) && arg+1 < argc) {
+			pack_file = argv[++arg];
+		}
+		else if (!strncmp(argv[arg],DIRECT_FLAG,DIRECT_FLAG_LENGTH+1)) {
+			DIRECT_MODE = 1;
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != ((in_file == NULL) ? 2 : 1) - THREADS_MODE) {
+		printf("Usage: %s [%s] [%s] [%s] [%s] [%s] [%s|%s|%s|%s|%s|%s] [%s file] {p | %s T} q\n       %s [%s] [%s] [%s] [%s] [%s] [%s|%s|%s|%s|%s|%s] %s file [%s file] [%s] [%s file] {p | %s T}\n\nwhere, %s is an optional flag (test mode)\n       %s is an optional flag (presortedness pre-pass, prints the path taken)\n       %s is an optional flag (key-range pre-pass: counting or 16-bit sort of narrow keys)\n       %s is an optional flag (always P threads, no size based dispatch)\n       %s is an optional flag (iterative stage-parallel schedule)\n       %s is an optional flag (with %s: roofline of every phase against measured peaks)\n       %s sorts with a parallel sample sort instead (for comparison)\n       %s is an optional flag (adaptive bitonic merge, O(n) work per merge)\n       %s is an optional flag (odd-even merge sort, prints comparator counts)\n       %s is an optional flag (out-of-place merges with streaming stores, prints GB/s per level)\n       %s is an optional flag (blocked/cyclic remapping, thread-local merge stages)\n       %s sorts the int keys of a binary file (2^q of them)\n       %s writes them to another file instead of in place\n       %s uses O_DIRECT reads/writes instead of mmap\n       %s file also writes the sorted keys there, delta + bit-packed\n       %s T uses exactly T threads (any T >= 1, no dispatch) instead of P=2^p\n       P=2^p is the maximum number of parallel threads\n       N=2^q is the problem size\n",argv[0],TEST_FLAG,PRESORT_FLAG,KEYRANGE_FLAG,NODISPATCH_FLAG,ROOFLINE_FLAG,ITER_FLAG,SAMPLE_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG,PACK_FLAG,THREADS_FLAG,argv[0],TEST_FLAG,PRESORT_FLAG,KEYRANGE_FLAG,NODISPATCH_FLAG,ROOFLINE_FLAG,ITER_FLAG,SAMPLE_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG,IN_FLAG,OUT_FLAG,DIRECT_FLAG,PACK_FLAG,THREADS_FLAG,TEST_FLAG,PRESORT_FLAG,KEYRANGE_FLAG,NODISPATCH_FLAG,ITER_FLAG,ROOFLINE_FLAG,ITER_FLAG,SAMPLE_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG,IN_FLAG,OUT_FLAG,DIRECT_FLAG,PACK_FLAG,THREADS_FLAG); 
 		exit(1);
 	}
 
-	if (argc == 3) {
-		p = atoi(argv[1]);
-		q = atoi(argv[2]);
-		TEST_MODE = 0;
+	if (ITER_MODE + ABS_MODE + ODDEVEN_MODE + STREAM_MODE + REMAP_MODE > 1) {
+		printf("Only one of %s, %s, %s, %s and %s can be given.\n",ITER_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG);
+		exit(1);
+	}
+
+	if (ROOFLINE_MODE && !ITER_MODE) {
+		printf("%s times the phases of %s, give both.\n",ROOFLINE_FLAG,ITER_FLAG);
+		exit(1);
+	}
+
+	if (THREADS_MODE && P < 1) {
+		printf("%s needs T >= 1.\n",THREADS_FLAG);
+		exit(1);
 	}
-	else { // argc == 4
 
-		if (strncmp(argv[1],TEST_FLAG,TEST_FLAG_LENGTH)) {
-			printf("Illegal flag received: %s\n",argv[1]);
+	if (!THREADS_MODE)
+		p = atoi(argv[arg++]);
+
+	if (in_file == NULL) {
+		q = atoi(argv[arg]);
+		if (q < 1) {
+			printf("q must be >= 1 (N = 2^q keys, at least one pair).\n");
 			exit(1);
 		}
+	}
+	else {
 
-		p = atoi(argv[2]);
-		q = atoi(argv[3]);
-		TEST_MODE = 1;
+		// the problem size comes from the file
+		int keys = sort_io_keys(in_file);
+		if (keys < 2 || (keys & (keys - 1)) != 0) {
+			printf("%s must hold 2^q int keys (q >= 1).\n",in_file);
+			exit(1);
+		}
+		for (q = 0; (1 << q) < keys; q++);
 	}
 
-	P = 1 << p;
+	if (!THREADS_MODE)
+		P = 1 << p;
 	N = 1 << q;
 
 	Nthreads = P;
@@ -148,8 +320,38 @@ void parse_arguments(int argc, char *argv[])
 
 void init(void)
 {
-	//allocate space for the array
-	a = (int*) malloc(N * sizeof(int));
+	//thread count from the dispatcher (its cost model is measured
+	//here, before the time measurement starts)
+	if (DISPATCH_MODE) {
+		dispatch = dispatch_plan(N,DISPATCH_KEY_INT,DISPATCH_LEAF_QSORT,Nthreads);
+		Nthreads = dispatch.threads;
+
+		//an engine asked for by its flag runs on the plan's threads
+		//instead of being replaced by the serial kernel_sort()
+		ENGINE_MODE = (SAMPLE_MODE || ITER_MODE || ABS_MODE || ODDEVEN_MODE || STREAM_MODE || REMAP_MODE);
+	}
+
+	//leaves: a power of two size with about leaves_per_thread of them
+	//per thread, so that they spread evenly over any number of threads
+	parallel_threshold = max_leaf;
+	while (parallel_threshold > 1 && (long long) parallel_threshold * leaves_per_thread * Nthreads > N)
+		parallel_threshold >>= 1;
+
+	//second buffer for the streamed merges (or merge in place)
+	if (STREAM_MODE)
+		STREAM_MODE = stream_init(N,Nthreads,NULL);
+
+	//memory and compare-exchange peaks of the roofline
+	if (ROOFLINE_MODE)
+		roofline_init(Nthreads);
+
+	//allocate space for the array (or map the input file)
+	if (in_file != NULL) {
+		a = sort_io_open(in_file,out_file,DIRECT_MODE,N);
+	}
+	else {
+		a = (int*) malloc(N * sizeof(int));
+	}
 	if (a == NULL) {
 		printf("Error allocating memory.\n");
 		exit(4);
@@ -164,13 +366,16 @@ void init(void)
 	}
 
 	//initialize arrays
-	srand( time(NULL) );
 	int i;
-	for (i = 0; i < N; i++) {
-		a[i] = rand() % N;
+	if (in_file == NULL) {
+		srand( time(NULL) );
+		for (i = 0; i < N; i++) {
+			a[i] = rand() % N;
+		}
 	}
 
 	if (TEST_MODE) {
+		sort_io_wait(0,N);
 		for(i = 0; i < N; i++) {
 			b[i] = a[i];
 		}
@@ -189,10 +394,52 @@ void create_threads_and_exec(void)
 	// start measuring time
 	gettimeofday(&startwtime,NULL);
 
+	// presortedness pre-pass: sorted, reversed and nearly sorted
+	// keys are finished there, only random keys go on to the sort
+	int sorted = 0;
+	if (PRESORT_MODE) {
+		sort_io_wait(0,N);
+		sorted = (presort_sort(a,N,ASCENDING,Nthreads,&presort_st) != PRESORT_RANDOM);
+	}
+
+	// key-range pre-pass: narrow key domains are counted or sorted
+	// in 16-bit lanes there, only wide ones go on to the sort
+	if (KEYRANGE_MODE && !sorted) {
+		sort_io_wait(0,N);
+		sorted = (keyrange_sort(a,N,ASCENDING,Nthreads,&keyrange_st) != KEYRANGE_FULL);
+	}
+
 	// sort the array
-	#pragma omp parallel num_threads(Nthreads)
-	#pragma omp single nowait
-	rec_bitonic_sort(0,N,ASCENDING);
+	if (sorted) {
+		// done
+	}
+	else if (DISPATCH_MODE && !ENGINE_MODE && dispatch.path == DISPATCH_SERIAL) {
+		// small input: one thread, vectorized, no team to start
+		sort_io_wait(0,N);
+		kernel_sort(a,N,ASCENDING);
+	}
+	else if (SAMPLE_MODE) {
+		sort_io_wait(0,N);
+		sample_sort(a,N,Nthreads);
+	}
+	else if (ITER_MODE) {
+		iter_bitonic_sort();
+	}
+	else if (REMAP_MODE) {
+		remap_bitonic_sort();
+	}
+	else {
+		if (ABS_MODE)
+			abs_init(a,N,fork_tasks,merge_block);
+
+		#pragma omp parallel num_threads(Nthreads)
+		#pragma omp single nowait
+		{
+			rec_bitonic_sort(0,N,ASCENDING);
+			if (ABS_MODE)
+				abs_finish(Nthreads);
+		}
+	}
 
 	// stop measuring time
 	gettimeofday(&endwtime,NULL);
@@ -203,9 +450,82 @@ void create_threads_and_exec(void)
 
 	// print time
 	printf("%lf\n",seq_time);
+
+	if (PRESORT_MODE)
+		presort_report(&presort_st);
+	if (KEYRANGE_MODE && !(PRESORT_MODE && presort_st.path != PRESORT_RANDOM))
+		keyrange_report(&keyrange_st);
+	if (STREAM_MODE)
+		stream_report();
+	if (REMAP_MODE && remap_threads(N,Nthreads) < Nthreads)
+		printf("remap: %d of %d threads (a power of two with 4*T*T <= N)\n",remap_threads(N,Nthreads),Nthreads);
+	if (ROOFLINE_MODE)
+		roofline_report();
+	if (DISPATCH_MODE && TEST_MODE) {
+		dispatch_report(&dispatch);
+		if (ENGINE_MODE && dispatch.path == DISPATCH_SERIAL)
+			printf("dispatch: serial plan overridden by the engine flag\n");
+	}
+
+	if (ODDEVEN_MODE) {
+		printf("comparators: %lld odd-even, %lld bitonic\n",
+		       count_comparators(N,1),count_comparators(N,0));
+	}
 	
 }
 
+// function : pack_output()
+// description : Write the sorted keys to pack_file, delta + bit-packed
+//               (--pack), and print the sizes. In test mode, read the
+//               file back and compare it with the sorted array.
+//---------------------------------------------------------------------
+
+void pack_output(void)
+{
+	struct pack_stats st;
+
+	if (pack_file == NULL)
+		return;
+
+	if (pack_write(pack_file,a,N,Nthreads,&st) != 0) {
+		printf("Error writing %s.\n",pack_file);
+		exit(4);
+	}
+	pack_report(&st);
+
+	if (TEST_MODE) {
+
+		struct pack_file pf;
+		int *c = (int*) malloc(N * sizeof(int));
+		if (c == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+		if (pack_open(&pf,pack_file) != 0 || pf.n != N) {
+			printf("Error reading %s.\n",pack_file);
+			exit(4);
+		}
+
+		pack_read_all(&pf,c,Nthreads);
+		int passed = !memcmp(c,a,N * sizeof(int));
+
+		//random access: a range across a block boundary
+		int lo = N/2 - N/8, cnt = N/4;
+		if (passed && cnt > 0) {
+			pack_read(&pf,lo,cnt,c);
+			passed = !memcmp(c,a + lo,cnt * sizeof(int));
+		}
+
+		if (passed)
+			printf("Pack test PASSED. %s decodes to the sorted keys.\n",pack_file);
+		else
+			printf("Pack test NOT PASSED. %s does not decode to the sorted keys.\n",pack_file);
+
+		pack_close(&pf);
+		free(c);
+	}
+}
+
 // function : test()
 // description : Check the result of the bitonic sort against the 
 //               stdlib/qsort.
@@ -256,32 +576,150 @@ void test(void)
 
 void clear(void)
 {
-	free(a);
+	if (in_file != NULL) {
+		sort_io_close(a,N);
+		sort_io_report();
+	}
+	else {
+		free(a);
+	}
 	if (TEST_MODE) {
 		free(b);
 	}
+	if (STREAM_MODE) {
+		stream_free();
+	}
 }
 
 // function : bitonic_merge()
-// description : The bitonic merge algorithm.
+// description : The bitonic merge algorithm. Large compare levels are
+//               cut into up to Nthreads equal chunks (tasks), and the
+//               two half merges run as tasks, so the merges use all the
+//               threads too.
 //---------------------------------------------------------------------
 	
 void bitonic_merge(int lo, int cnt, int dir)
 {
-	if (cnt > 1) {
+	// large merges stream out of place (-stream), as tasks of the team
+	if (STREAM_MODE && stream_merge(a,lo,cnt,dir,Nthreads))
+		return;
+
+	if (cnt > KERNEL_MAX_CNT) {
 
 		int k = cnt / 2;
-		int i;
+		int chunks = k / merge_grain;
+		if (chunks > Nthreads)
+			chunks = Nthreads;
+
+		if (chunks > 1) {
+
+			int c;
+			for (c = 0; c < chunks; c++) {
+
+				int c0 = (int) ((long long) k * c / chunks);
+				int c1 = (int) ((long long) k * (c + 1) / chunks);
+
+				#pragma omp task firstprivate(c0,c1)
+				kernel_compare_range(a+lo+c0, c1-c0, k, dir);
+			}
+			#pragma omp taskwait
 
-		for (i = lo; i < lo + k; i++) {
-			compare(i,i+k,dir);
+			#pragma omp task
+			bitonic_merge(lo,k,dir);
+			bitonic_merge(lo+k,k,dir);
+
+			#pragma omp taskwait
+		}
+		else {
+
+			kernel_compare_level(a+lo,k,dir);
+
+			bitonic_merge(lo,k,dir);
+			bitonic_merge(lo+k,k,dir);
 		}
-		
-		bitonic_merge(lo,k,dir);
-		bitonic_merge(lo+k,k,dir);
+	}
+	else {
+
+		// unrolled network, no branching on dir
+		kernel_merge_small(a+lo,cnt,dir);
 	}
 }
 		
+// function : oddeven_merge()
+// description : Odd-even merge of a[lo..lo+cnt), both halves sorted in
+//               dir. The levels depend on each other, so they run one
+//               after the other, and each large level is cut into up to
+//               Nthreads equal ranges of pairs run as tasks, as the
+//               compare levels of bitonic_merge().
+//---------------------------------------------------------------------
+
+void oddeven_merge(int lo, int cnt, int dir)
+{
+	int k;
+
+	if (cnt / 2 < 2 * merge_grain) {
+		kernel_oddeven_merge(a+lo,cnt,dir);
+		return;
+	}
+
+	for (k = cnt / 2; k >= 1; k /= 2) {
+
+		int pairs  = kernel_oddeven_pairs(cnt,k);
+		int chunks = pairs / merge_grain;
+		if (chunks > Nthreads)
+			chunks = Nthreads;
+
+		if (chunks > 1) {
+
+			int c;
+			for (c = 0; c < chunks; c++) {
+
+				int p0 = (int) ((long long) pairs * c / chunks);
+				int p1 = (int) ((long long) pairs * (c + 1) / chunks);
+
+				#pragma omp task firstprivate(p0,p1)
+				kernel_oddeven_level(a+lo,cnt,k,p0,p1,dir);
+			}
+			#pragma omp taskwait
+		}
+		else {
+			kernel_oddeven_level(a+lo,cnt,k,0,pairs,dir);
+		}
+	}
+}
+
+// function : fork_tasks()
+// description : Fork of the adaptive bitonic merge (-abs): task(x) as
+//               a new task, task(y) here, then wait for both.
+//---------------------------------------------------------------------
+
+void fork_tasks(abs_task task, void *x, void *y)
+{
+	#pragma omp task
+	task(x);
+
+	task(y);
+
+	#pragma omp taskwait
+}
+
+// function : merge_block()
+// description : Array merge of the adaptive bitonic merge (-abs): the
+//               blocks still in place take bitonic_merge(), which cuts
+//               its levels between the Nthreads threads itself, while
+//               the merge has more than one thread of its budget left.
+//               On one thread the other subtrees keep the rest busy,
+//               and the block is merged serially with kernel_merge().
+//---------------------------------------------------------------------
+
+void merge_block(int lo, int cnt, int dir, int threads)
+{
+	if (threads <= 1)
+		kernel_merge(a+lo,cnt,dir);
+	else
+		bitonic_merge(lo,cnt,dir);
+}
+
 // function : rec_bitonic_sort()
 // description : The recursive bitonic sort algortithm executes from
 //               each pthread.
@@ -293,6 +731,9 @@ void rec_bitonic_sort(int lo, int cnt, int dir)
 
 		int k = cnt / 2;
 
+		// the odd-even merge takes two ascending halves
+		int dir2 = ODDEVEN_MODE ? ASCENDING : DESCENDING;
+
 		// Sorting Part 1
 		//----------------------------
 
@@ -306,6 +747,7 @@ void rec_bitonic_sort(int lo, int cnt, int dir)
 			}
 			else {
 
+				sort_io_wait(lo,k);
 				qsort(a+lo, k, sizeof(int), cmpfunc_asc);
 			}
 		}
@@ -319,11 +761,12 @@ void rec_bitonic_sort(int lo, int cnt, int dir)
 		{
 			if (k > parallel_threshold) {
 
-				rec_bitonic_sort(lo+k,k,DESCENDING);
+				rec_bitonic_sort(lo+k,k,dir2);
 			}
 			else {
 
-				qsort(a+lo+k, k, sizeof(int), cmpfunc_des);
+				sort_io_wait(lo+k,k);
+				qsort(a+lo+k, k, sizeof(int), dir2 == ASCENDING ? cmpfunc_asc : cmpfunc_des);
 			}
 		}
 
@@ -333,37 +776,211 @@ void rec_bitonic_sort(int lo, int cnt, int dir)
 		// Merging Part
 		//----------------------------
 		
-		bitonic_merge(lo,cnt,dir);
+		if (ABS_MODE)
+			abs_merge(lo,cnt,dir,Nthreads);
+		else if (ODDEVEN_MODE)
+			oddeven_merge(lo,cnt,dir);
+		else
+			bitonic_merge(lo,cnt,dir);
 	}
 
 
 }
 
-// function : compare()
-// description: Compare two positions and swap (if necessary) to get
-//              the desired direction (i.e. ascending).
+// function : iter_bitonic_sort()
+// description : Iterative bitonic sort over the log^2 N stages. Thread
+//               t owns a fixed range of the blocks of a (B = N/blocks)
+//               for the whole sort. Strides below B stay inside a block
+//               and run without synchronization; the larger ones are
+//               split between the owners of the two blocks and separated by
+//               barriers. With -roofline every phase also ends with a
+//               barrier, and the master times it.
 //---------------------------------------------------------------------
 
-void compare(int i, int j, int dir)
+void iter_bitonic_sort(void)
 {
-	if ( dir == (a[i]>a[j]) ) {
-		
-		int t;
-		t = a[i];
-		a[i] = a[j];
-		a[j] = t;
+	int L = iter_blocks();
+
+	#pragma omp parallel num_threads(Nthreads)
+	{
+		int t  = omp_get_thread_num();
+		int B  = N / L;
+		int b0 = (int) ((long long) L * t / Nthreads);
+		int b1 = (int) ((long long) L * (t + 1) / Nthreads);
+		int b, j, k;
+		double t0 = omp_get_wtime();
+
+		// stages k <= B: sort my blocks (even blocks ascending)
+		for (b = b0; b < b1; b++) {
+			sort_io_wait(b*B,B);
+			qsort(a+b*B, B, sizeof(int), (b % 2 == 0) ? cmpfunc_asc : cmpfunc_des);
+		}
+		if (ROOFLINE_MODE) {
+			#pragma omp barrier
+			#pragma omp master
+			roofline_leaves(N, B, omp_get_wtime() - t0);
+		}
+
+		// stages k > B
+		for (k = 2*B; k <= N; k <<= 1) {
+
+			for (j = k/2; j >= B; j >>= 1) {
+
+				#pragma omp barrier
+				t0 = omp_get_wtime();
+				iter_compare_stride(t,j,k);
+				if (ROOFLINE_MODE) {
+					#pragma omp barrier
+					#pragma omp master
+					roofline_level(N, j, omp_get_wtime() - t0);
+				}
+			}
+
+			#pragma omp barrier
+			t0 = omp_get_wtime();
+			for (b = b0; b < b1; b++)
+				bitonic_merge(b*B, B, ((b*B) & k) == 0 ? ASCENDING : DESCENDING);
+			if (ROOFLINE_MODE) {
+				#pragma omp barrier
+				#pragma omp master
+				roofline_blocks(N, B, omp_get_wtime() - t0);
+			}
+		}
+	}
+}
+
+// function : remap_bitonic_sort()
+// description : Bitonic sort with the blocked <-> cyclic remapping of
+//               common/remap.c on T threads (a power of two, T*T <= N).
+//               Each thread sorts its block of M = N/T keys; every stage
+//               k > M then needs two transposes, and between them each
+//               thread merges only its own M keys.
+//---------------------------------------------------------------------
+
+void remap_bitonic_sort(void)
+{
+	int  T   = remap_threads(N,Nthreads);
+	int  M   = N / T;
+	int *cyc = (int*) malloc(N * sizeof(int));
+	if (cyc == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	#pragma omp parallel num_threads(T)
+	{
+		int r = omp_get_thread_num();
+		int k;
+
+		// stages k <= M: sort my block (even blocks ascending)
+		sort_io_wait(r*M,M);
+		qsort(a+r*M, M, sizeof(int), (r % 2 == 0) ? cmpfunc_asc : cmpfunc_des);
+
+		// stages k > M
+		for (k = 2*M; k <= N; k <<= 1) {
+
+			#pragma omp barrier
+			remap_to_cyclic(a,cyc,N,T,r);
+			#pragma omp barrier
+			remap_cyclic_steps(cyc,N,T,r,k);
+			#pragma omp barrier
+			remap_to_blocked(cyc,a,N,T,r);
+			remap_blocked_steps(a,N,T,r,k);
+		}
+	}
+
+	free(cyc);
+}
+
+// function : iter_compare_stride()
+// description : Thread t's share of the compare-exchanges at stride
+//               j >= B inside stage k. Thread t keeps its blocks
+//               [b0,b1) of iter_blocks() for every stage. A pair of
+//               blocks (b, b^(j/B)) that t owns both of is done by t in
+//               full; when the partner belongs to another thread, the
+//               lower block's owner does the first half of the compares
+//               and the upper one the second half. Either way a thread
+//               does B/2 compares per block it owns, for any Nthreads.
+//---------------------------------------------------------------------
+
+void iter_compare_stride(int t, int j, int k)
+{
+	int L  = iter_blocks();
+	int B  = N / L;
+	int h  = B / 2;
+	int b0 = (int) ((long long) L * t / Nthreads);
+	int b1 = (int) ((long long) L * (t + 1) / Nthreads);
+	int b;
+
+	for (b = b0; b < b1; b++) {
+
+		int lo  = b * B;
+		int p   = b ^ (j / B); //partner block
+		int dir = (lo & k) == 0 ? ASCENDING : DESCENDING;
+
+		if (p >= b0 && p < b1) {
+
+			// both blocks mine: the lower one does the whole pair
+			if ((lo & j) == 0)
+				kernel_compare_range(a+lo, B, j, dir);
+		}
+		else if ((lo & j) == 0) {
+
+			// lower block: first half against the partner block
+			kernel_compare_range(a+lo, h, j, dir);
+		}
+		else {
+
+			// upper block: second half against the partner block
+			kernel_compare_range(a+lo-j+h, B-h, j, dir);
+		}
+	}
+}
+
+// function : iter_blocks()
+// description : Number of blocks of the iterative schedule: one per
+//               thread when Nthreads is a power of two, otherwise a
+//               power of two with at least 8 per thread (at most N/2),
+//               handed out as contiguous ranges so that they even out.
+//---------------------------------------------------------------------
+
+int iter_blocks(void)
+{
+	int L = Nthreads;
+
+	if ((L & (L - 1)) != 0) {
+		L = 1;
+		while (L < 8 * Nthreads && L < N/2)
+			L <<= 1;
 	}
+
+	return L;
+}
+
+// function : count_comparators()
+// description : Comparators the recursive sort of cnt keys goes through
+//               with the odd-even (oddeven = 1) or the bitonic merges.
+//               The qsort leaves are not networks and are not counted.
+//---------------------------------------------------------------------
+
+long long count_comparators(int cnt, int oddeven)
+{
+	long long c = kernel_merge_comparators(cnt,oddeven);
+
+	if (cnt/2 > parallel_threshold)
+		c += 2 * count_comparators(cnt/2,oddeven);
+
+	return c;
 }
 
 //code from:
 //www.tutorialspoint.com/c_standard_library/c_function_qsort.htm
 int cmpfunc_asc(const void* a, const void* b)
 {
-	return ( *(int*)a - *(int*)b );
+	return ( (*(int*)a > *(int*)b) - (*(int*)a < *(int*)b) ); //no overflow on file keys
 }
 
 int cmpfunc_des(const void* a, const void* b)
 {
-	return ( - *(int*)a + *(int*)b );
+	return ( (*(int*)a < *(int*)b) - (*(int*)a > *(int*)b) );
 }
-
@@ -25,6 +25,16 @@
 #include <sys/time.h>
 #include <pthread.h>
 
+#include "../common/bitonic_kernels.h"
+#include "../common/sort_io.h"
+#include "../common/adaptive_bitonic.h"
+#include "../common/presort.h"
+#include "../common/keyrange.h"
+#include "../common/sort_dispatch.h"
+#include "../common/stream_merge.h"
+#include "../common/remap.h"
+#include "../common/pack_io.h"
+
 
 // Constants & Variables (Test Related)
 //===========================================================
@@ -32,12 +42,70 @@
 const char* TEST_FLAG = "-test\0";
 const int TEST_FLAG_LENGTH = 5; 
 
+const char* ITER_FLAG = "-iter\0";
+const int ITER_FLAG_LENGTH = 5;
+
+const char* ABS_FLAG = "-abs\0";
+const int ABS_FLAG_LENGTH = 4;
+
+const char* ODDEVEN_FLAG = "-oddeven\0";
+const int ODDEVEN_FLAG_LENGTH = 8;
+
+const char* STREAM_FLAG = "-stream\0";
+const int STREAM_FLAG_LENGTH = 7;
+
+const char* REMAP_FLAG = "-remap\0";
+const int REMAP_FLAG_LENGTH = 6;
+
+const char* PRESORT_FLAG = "-presort\0";
+const int PRESORT_FLAG_LENGTH = 8;
+
+const char* KEYRANGE_FLAG = "-keyrange\0";
+const int KEYRANGE_FLAG_LENGTH = 9;
+
+const char* NODISPATCH_FLAG = "-nodispatch\0";
+const int NODISPATCH_FLAG_LENGTH = 11;
+
+const char* THREADS_FLAG = "--threads\0";
+const int THREADS_FLAG_LENGTH = 9;
+
+const char* IN_FLAG = "--in\0";
+const int IN_FLAG_LENGTH = 4;
+
+const char* OUT_FLAG = "--out\0";
+const int OUT_FLAG_LENGTH = 5;
+
+const char* DIRECT_FLAG = "--direct\0";
+const int DIRECT_FLAG_LENGTH = 8;
+
+const char* PACK_FLAG = "--pack\0";
+const int PACK_FLAG_LENGTH = 6;
+
 int TEST_MODE = 0;
+int ITER_MODE = 0; //iterative stage-parallel schedule instead of recursion
+int ABS_MODE = 0; //adaptive bitonic merge (O(n) work per merge)
+int ODDEVEN_MODE = 0; //Batcher's odd-even merge instead of the bitonic merge
+int STREAM_MODE = 0; //out-of-place merge levels with streaming stores
+int REMAP_MODE = 0; //blocked <-> cyclic remapping, thread-local merges
+int PRESORT_MODE = 0; //presortedness pre-pass before the sort
+int KEYRANGE_MODE = 0; //key-range pre-pass before the sort
+int DISPATCH_MODE = 1; //thread count from the dispatcher's cost model
+int ENGINE_MODE = 0; //an engine flag was given, it runs even on a serial plan
+int THREADS_MODE = 0; //P given directly (--threads T, any T >= 1)
+int DIRECT_MODE = 0; //O_DIRECT reads/writes instead of mmap
+
+const char *in_file  = NULL; //keys from a binary file instead of random
+const char *out_file = NULL; //sorted keys to a file (default: in place)
+const char *pack_file = NULL; //sorted keys also written compressed
 
 // for time measurements
 struct timeval startwtime, endwtime;
 double seq_time; 
 
+struct presort_stats presort_st; //what the pre-pass measured (-presort)
+struct keyrange_stats keyrange_st; //what the key-range pre-pass found (-keyrange)
+struct dispatch_plan  dispatch;   //path and threads picked by the dispatcher
+
 
 // Constants & Variables (Algorithm Related)
 //===========================================================
@@ -51,7 +119,6 @@ const int DESCENDING = 0;
 int N;                    //problem size
 int P;                   //number of threads (user option)
 int Nthreads;            //number of threads (maximum to be created)
-int current_threads = 0; //current number of threads (actually created) 
 
 int p;  //log2(number of threads, user option)
 int q;  //log2(problem size)
@@ -61,17 +128,55 @@ struct args {
 	int lo;
 	int cnt;
 	int dir;
+	int threads; //threads this call may use, itself included
 }; // arguments to pass to recursive bitonic sort function
 
-const int parallel_threshold = 1<<21;
+struct range_args {
+
+	int lo;
+	int cnt;
+	int dist;
+	int dir;
+}; // range of the pairs of one compare level (compare_worker)
+
+struct oddeven_args {
+
+	int lo;
+	int cnt; //size of the merge
+	int k;   //distance of the level
+	int p0;
+	int p1;
+	int dir;
+}; // range [p0,p1) of the pairs of one odd-even level (oddeven_worker)
+
+struct part_args {
+
+	stream_part part;
+	void       *arg;
+	int         c;
+}; // one part of a streamed pass (part_worker)
+
+const int max_leaf          = 1<<21; //largest qsort leaf
+const int leaves_per_thread = 4;     //leaves per thread, so that any T balances
+const int merge_grain       = 1<<16; //smallest chunk of a split compare level
+
+int parallel_threshold = 1<<21; //leaf size, set in init() from N and the threads
 
 // Constants & Variables (Pthreads Related)
 //===========================================================
 
 pthread_t* threads = NULL;
 
-//mutex varible for current number of threads
-pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+//next leaf to sort (sort_leaves) and its mutex
+int leaf_next = 0;
+pthread_mutex_t leaf_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+//barrier between the stages of the iterative schedule
+pthread_barrier_t stage_barrier;
+
+//threads and cyclic layout array of the -remap schedule
+int  remap_T   = 1;
+int *remap_buf = NULL;
 
 
 
@@ -82,12 +187,29 @@ void  parse_arguments        (int argc,char *argv[]);
 void  init                   (void);
 void  create_threads_and_exec(void);
 int   cmpfunc                (const void*, const void*);
+void  pack_output            (void);
 void  test                   (void);
 void  clear                  (void);
+long long count_comparators  (int,int);
 void* rec_bitonic_sort       (void*);
 void* bitonic_merge          (void*);
-void  compare                (int, int, int);
-void* par_qsort              (void*);
+void  compare_level_split    (int,int,int,int);
+void* compare_worker         (void*);
+void  oddeven_merge          (int,int,int,int);
+void  fork_tasks             (abs_task,void*,void*);
+void  run_parts              (stream_part,void*,int);
+void* part_worker            (void*);
+void  merge_block            (int,int,int,int);
+void  oddeven_level_split    (int,int,int,int,int);
+void* oddeven_worker         (void*);
+void  sort_leaves            (void);
+void* leaf_worker            (void*);
+void  iter_bitonic_sort      (void);
+void  remap_bitonic_sort     (void);
+void* remap_worker           (void*);
+void* iter_worker            (void*);
+void  iter_compare_stride    (int,int,int);
+int   iter_blocks            (void);
 int   cmpfunc_asc            (const void*, const void*);
 int   cmpfunc_des            (const void*, const void*);
 
@@ -100,6 +222,7 @@ int main(int argc, char *argv[])
 	parse_arguments        (argc,argv);
 	init                   ();
 	create_threads_and_exec();
+	pack_output            ();
 	test                   ();
 	clear                  ();
 
@@ -118,29 +241,99 @@ int main(int argc, char *argv[])
 
 void parse_arguments(int argc, char *argv[])
 {
-	if (argc != 3 && argc != 4) {
-		printf("Usage: %s %s p q\n\nwhere, %s is an optional flag (test mode)\n       P=2^p is the maximum number of parallel threads\n       N=2^q is the problem size\n",argv[0],TEST_FLAG,TEST_FLAG); 
+	// optional flags come first
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],ITER_FLAG,ITER_FLAG_LENGTH+1)) {
+			ITER_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],ABS_FLAG,ABS_FLAG_LENGTH+1)) {
+			ABS_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],ODDEVEN_FLAG,ODDEVEN_FLAG_LENGTH+1)) {
+			ODDEVEN_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],STREAM_FLAG,STREAM_FLAG_LENGTH+1)) {
+			STREAM_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],REMAP_FLAG,REMAP_FLAG_LENGTH+1)) {
+			REMAP_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],PRESORT_FLAG,PRESORT_FLAG_LENGTH+1)) {
+			PRESORT_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],KEYRANGE_FLAG,KEYRANGE_FLAG_LENGTH+1)) {
+			KEYRANGE_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],NODISPATCH_FLAG,NODISPATCH_FLAG_LENGTH+1)) {
+			DISPATCH_MODE = 0;
+		}
+		else if (!strncmp(argv[arg],THREADS_FLAG,THREADS_FLAG_LENGTH+1) && arg+1 < argc) {
+			THREADS_MODE = 1;
+			DISPATCH_MODE = 0; //an explicit thread count is used as given
+			P = atoi(argv[++arg]);
+		}
+		else if (!strncmp(argv[arg],IN_FLAG,IN_FLAG_LENGTH+1) && arg+1 < argc) {
+			in_file = argv[++arg];
+		}
+		else if (!strncmp(argv[arg],OUT_FLAG,OUT_FLAG_LENGTH+1) && arg+1 < argc) {
+			out_file = argv[++arg];
+		}
+		else if (!strncmp(argv[arg],PACK_FLAG,PACK_FLAG_LENGTH+1) && arg+1 < argc) {
+			pack_file = argv[++arg];
+		}
+		else if (!strncmp(argv[arg],DIRECT_FLAG,DIRECT_FLAG_LENGTH+1)) {
+			DIRECT_MODE = 1;
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != ((in_file == NULL) ? 2 : 1) - THREADS_MODE) {
+		printf("Usage: %s [%s] [%s] [%s] [%s] [%s|%s|%s|%s|%s] [%s file] {p | %s T} q\n       %s [%s] [%s] [%s] [%s] [%s|%s|%s|%s|%s] %s file [%s file] [%s] [%s file] {p | %s T}\n\nwhere, %s is an optional flag (test mode)\n       %s is an optional flag (presortedness pre-pass, prints the path taken)\n       %s is an optional flag (key-range pre-pass: counting or 16-bit sort of narrow keys)\n       %s is an optional flag (always P threads, no size based dispatch)\n       %s is an optional flag (iterative stage-parallel schedule)\n       %s is an optional flag (adaptive bitonic merge, O(n) work per merge)\n       %s is an optional flag (odd-even merge sort, prints comparator counts)\n       %s is an optional flag (out-of-place merges with streaming stores, prints GB/s per level)\n       %s is an optional flag (blocked/cyclic remapping, thread-local merge stages)\n       %s sorts the int keys of a binary file (2^q of them)\n       %s writes them to another file instead of in place\n       %s uses O_DIRECT reads/writes instead of mmap\n       %s file also writes the sorted keys there, delta + bit-packed\n       %s T uses exactly T threads (any T >= 1, no dispatch) instead of P=2^p\n       P=2^p is the maximum number of parallel threads\n       N=2^q is the problem size\n",argv[0],TEST_FLAG,PRESORT_FLAG,KEYRANGE_FLAG,NODISPATCH_FLAG,ITER_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG,PACK_FLAG,THREADS_FLAG,argv[0],TEST_FLAG,PRESORT_FLAG,KEYRANGE_FLAG,NODISPATCH_FLAG,ITER_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG,IN_FLAG,OUT_FLAG,DIRECT_FLAG,PACK_FLAG,THREADS_FLAG,TEST_FLAG,PRESORT_FLAG,KEYRANGE_FLAG,NODISPATCH_FLAG,ITER_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG,IN_FLAG,OUT_FLAG,DIRECT_FLAG,PACK_FLAG,THREADS_FLAG); 
 		exit(1);
 	}
 
-	if (argc == 3) {
-		p = atoi(argv[1]);
-		q = atoi(argv[2]);
-		TEST_MODE = 0;
+	if (ITER_MODE + ABS_MODE + ODDEVEN_MODE + STREAM_MODE + REMAP_MODE > 1) {
+		printf("Only one of %s, %s, %s, %s and %s can be given.\n",ITER_FLAG,ABS_FLAG,ODDEVEN_FLAG,STREAM_FLAG,REMAP_FLAG);
+		exit(1);
 	}
-	else { // argc == 4
 
-		if (strncmp(argv[1],TEST_FLAG,TEST_FLAG_LENGTH)) {
-			printf("Illegal flag received: %s\n",argv[1]);
+	if (THREADS_MODE && P < 1) {
+		printf("%s needs T >= 1.\n",THREADS_FLAG);
+		exit(1);
+	}
+
+	if (!THREADS_MODE)
+		p = atoi(argv[arg++]);
+
+	if (in_file == NULL) {
+		q = atoi(argv[arg]);
+		if (q < 1) {
+			printf("q must be >= 1 (N = 2^q keys, at least one pair).\n");
 			exit(1);
 		}
+	}
+	else {
 
-		p = atoi(argv[2]);
-		q = atoi(argv[3]);
-		TEST_MODE = 1;
+		// the problem size comes from the file
+		int keys = sort_io_keys(in_file);
+		if (keys < 2 || (keys & (keys - 1)) != 0) {
+			printf("%s must hold 2^q int keys (q >= 1).\n",in_file);
+			exit(1);
+		}
+		for (q = 0; (1 << q) < keys; q++);
 	}
 
-	P = 1 << p;
+	if (!THREADS_MODE)
+		P = 1 << p;
 	N = 1 << q;
 
 	Nthreads = P;
@@ -158,6 +351,27 @@ void parse_arguments(int argc, char *argv[])
 
 void init(void)
 {
+	//thread count from the dispatcher (its cost model is measured
+	//here, before the time measurement starts)
+	if (DISPATCH_MODE) {
+		dispatch = dispatch_plan(N,DISPATCH_KEY_INT,DISPATCH_LEAF_QSORT,Nthreads);
+		Nthreads = dispatch.threads;
+
+		//an engine asked for by its flag runs on the plan's threads
+		//instead of being replaced by the serial kernel_sort()
+		ENGINE_MODE = (ITER_MODE || ABS_MODE || ODDEVEN_MODE || STREAM_MODE || REMAP_MODE);
+	}
+
+	//leaves: a power of two size with about leaves_per_thread of them
+	//per thread, so that they spread evenly over any number of threads
+	parallel_threshold = max_leaf;
+	while (parallel_threshold > 1 && (long long) parallel_threshold * leaves_per_thread * Nthreads > N)
+		parallel_threshold >>= 1;
+
+	//second buffer for the streamed merges (or merge in place)
+	if (STREAM_MODE)
+		STREAM_MODE = stream_init(N,Nthreads,run_parts);
+
 	//allocate space for threads
 	threads = (pthread_t*) malloc(Nthreads * sizeof(pthread_t));
 	if (threads == NULL) {
@@ -165,8 +379,13 @@ void init(void)
 		exit(4);
 	}
 
-	//allocate space for the array
-	a = (int*) malloc(N * sizeof(int));
+	//allocate space for the array (or map the input file)
+	if (in_file != NULL) {
+		a = sort_io_open(in_file,out_file,DIRECT_MODE,N);
+	}
+	else {
+		a = (int*) malloc(N * sizeof(int));
+	}
 	if (a == NULL) {
 		printf("Error allocating memory.\n");
 		exit(4);
@@ -181,13 +400,16 @@ void init(void)
 	}
 
 	//initialize arrays
-	srand( time(NULL) );
 	int i;
-	for (i = 0; i < N; i++) {
-		a[i] = rand() % N;
+	if (in_file == NULL) {
+		srand( time(NULL) );
+		for (i = 0; i < N; i++) {
+			a[i] = rand() % N;
+		}
 	}
 
 	if (TEST_MODE) {
+		sort_io_wait(0,N);
 		for(i = 0; i < N; i++) {
 			b[i] = a[i];
 		}
@@ -211,9 +433,46 @@ void create_threads_and_exec(void)
 	start.lo  = 0;
 	start.cnt = N;
 	start.dir = ASCENDING;
+	start.threads = Nthreads;
+
+	// presortedness pre-pass: sorted, reversed and nearly sorted
+	// keys are finished there, only random keys go on to the sort
+	int sorted = 0;
+	if (PRESORT_MODE) {
+		sort_io_wait(0,N);
+		sorted = (presort_sort(a,N,ASCENDING,Nthreads,&presort_st) != PRESORT_RANDOM);
+	}
+
+	// key-range pre-pass: narrow key domains are counted or sorted
+	// in 16-bit lanes there, only wide ones go on to the sort
+	if (KEYRANGE_MODE && !sorted) {
+		sort_io_wait(0,N);
+		sorted = (keyrange_sort(a,N,ASCENDING,Nthreads,&keyrange_st) != KEYRANGE_FULL);
+	}
 
 	// sort the array
-	rec_bitonic_sort((void *) &start);
+	if (sorted) {
+		// done
+	}
+	else if (DISPATCH_MODE && !ENGINE_MODE && dispatch.path == DISPATCH_SERIAL) {
+		// small input: one thread, vectorized, no team to start
+		sort_io_wait(0,N);
+		kernel_sort(a,N,ASCENDING);
+	}
+	else if (ITER_MODE) {
+		iter_bitonic_sort();
+	}
+	else if (REMAP_MODE) {
+		remap_bitonic_sort();
+	}
+	else {
+		if (ABS_MODE)
+			abs_init(a,N,fork_tasks,merge_block);
+		sort_leaves();
+		rec_bitonic_sort((void *) &start);
+		if (ABS_MODE)
+			abs_finish(Nthreads);
+	}
 
 	// stop measuring time
 	gettimeofday(&endwtime,NULL);
@@ -224,9 +483,80 @@ void create_threads_and_exec(void)
 
 	// print time
 	printf("%lf\n",seq_time);
+
+	if (PRESORT_MODE)
+		presort_report(&presort_st);
+	if (KEYRANGE_MODE && !(PRESORT_MODE && presort_st.path != PRESORT_RANDOM))
+		keyrange_report(&keyrange_st);
+	if (STREAM_MODE)
+		stream_report();
+	if (REMAP_MODE && remap_threads(N,Nthreads) < Nthreads)
+		printf("remap: %d of %d threads (a power of two with 4*T*T <= N)\n",remap_threads(N,Nthreads),Nthreads);
+	if (DISPATCH_MODE && TEST_MODE) {
+		dispatch_report(&dispatch);
+		if (ENGINE_MODE && dispatch.path == DISPATCH_SERIAL)
+			printf("dispatch: serial plan overridden by the engine flag\n");
+	}
+
+	if (ODDEVEN_MODE) {
+		printf("comparators: %lld odd-even, %lld bitonic\n",
+		       count_comparators(N,1),count_comparators(N,0));
+	}
 	
 }
 
+// function : pack_output()
+// description : Write the sorted keys to pack_file, delta + bit-packed
+//               (--pack), and print the sizes. In test mode, read the
+//               file back and compare it with the sorted array.
+//---------------------------------------------------------------------
+
+void pack_output(void)
+{
+	struct pack_stats st;
+
+	if (pack_file == NULL)
+		return;
+
+	if (pack_write(pack_file,a,N,Nthreads,&st) != 0) {
+		printf("Error writing %s.\n",pack_file);
+		exit(4);
+	}
+	pack_report(&st);
+
+	if (TEST_MODE) {
+
+		struct pack_file pf;
+		int *c = (int*) malloc(N * sizeof(int));
+		if (c == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+		if (pack_open(&pf,pack_file) != 0 || pf.n != N) {
+			printf("Error reading %s.\n",pack_file);
+			exit(4);
+		}
+
+		pack_read_all(&pf,c,Nthreads);
+		int passed = !memcmp(c,a,N * sizeof(int));
+
+		//random access: a range across a block boundary
+		int lo = N/2 - N/8, cnt = N/4;
+		if (passed && cnt > 0) {
+			pack_read(&pf,lo,cnt,c);
+			passed = !memcmp(c,a + lo,cnt * sizeof(int));
+		}
+
+		if (passed)
+			printf("Pack test PASSED. %s decodes to the sorted keys.\n",pack_file);
+		else
+			printf("Pack test NOT PASSED. %s does not decode to the sorted keys.\n",pack_file);
+
+		pack_close(&pf);
+		free(c);
+	}
+}
+
 // function : test()
 // description : Check the result of the bitonic sort against the 
 //               stdlib/qsort.
@@ -279,14 +609,26 @@ void clear(void)
 {
 	//free threads space
 	free(threads);
-	free(a);
+	if (in_file != NULL) {
+		sort_io_close(a,N);
+		sort_io_report();
+	}
+	else {
+		free(a);
+	}
 	if (TEST_MODE) {
 		free(b);
 	}
+	if (STREAM_MODE) {
+		stream_free();
+	}
 }
 
 // function : bitonic_merge()
-// description : The bitonic merge algorithm.
+// description : The bitonic merge algorithm. The merge gets a budget of
+//               threads: large compare levels are cut into up to that
+//               many equal chunks, one per thread, and the two half
+//               merges then share the budget.
 //---------------------------------------------------------------------
 	
 void *bitonic_merge(void *ptr)
@@ -294,34 +636,287 @@ void *bitonic_merge(void *ptr)
 	struct args *current_args = ptr;
 	
 	// parse arguments
-	int lo, cnt, dir;	
-	lo  = (*current_args).lo;
-	cnt = (*current_args).cnt;
-	dir = (*current_args).dir;
+	int lo, cnt, dir, threads;	
+	lo      = (*current_args).lo;
+	cnt     = (*current_args).cnt;
+	dir     = (*current_args).dir;
+	threads = (*current_args).threads;
+
+	// large merges stream out of place (-stream)
+	if (STREAM_MODE && stream_merge(a,lo,cnt,dir,threads))
+		return NULL;
 
 	struct args merge_args1; // argument for merge 1
 	struct args merge_args2; // argument for merge 2
 
-	if (cnt > 1) {
+	if (cnt > KERNEL_MAX_CNT) {
 
 		int k = cnt / 2;
-		int i;
+		int chunks = k / merge_grain;
+		if (chunks > threads)
+			chunks = threads;
 
 		merge_args1.lo  = lo;    merge_args1.cnt  = k; merge_args1.dir = dir;
 		merge_args2.lo  = lo+k;  merge_args2.cnt  = k; merge_args2.dir = dir;
+		merge_args1.threads = threads / 2;
+		merge_args2.threads = threads - threads / 2;
+
+		if (chunks > 1)
+			compare_level_split(lo,k,dir,chunks);
+		else
+			kernel_compare_level(a+lo,k,dir);
 
-		for (i = lo; i < lo + k; i++) {
-			compare(i,i+k,dir);
+		if (merge_args1.threads > 0) {
+
+			pthread_t helper;
+			if (pthread_create(&helper,NULL,bitonic_merge,(void *) &merge_args1) != 0) {
+				printf("Error creating thread.\n");
+				exit(3);
+			}
+			bitonic_merge( (void*) &merge_args2 );
+			pthread_join(helper,NULL);
 		}
+		else {
+			bitonic_merge( (void*) &merge_args1 );
+			bitonic_merge( (void*) &merge_args2 );
+		}
+	}
+	else {
+
+		// unrolled network, no branching on dir
+		kernel_merge_small(a+lo,cnt,dir);
+	}
+}
+
+// function : compare_level_split()
+// description : One compare level of the merge of a[lo..lo+2k), cut
+//               into chunks equal ranges of pairs. This thread does the
+//               last range and helper threads the others.
+//---------------------------------------------------------------------
+
+void compare_level_split(int lo, int k, int dir, int chunks)
+{
+	pthread_t         *helpers = (pthread_t*) malloc(chunks * sizeof(pthread_t));
+	struct range_args *ranges  = (struct range_args*) malloc(chunks * sizeof(struct range_args));
+	if (helpers == NULL || ranges == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	int c;
+	for (c = 0; c < chunks; c++) {
+
+		int c0 = (int) ((long long) k * c / chunks);
+		int c1 = (int) ((long long) k * (c + 1) / chunks);
+
+		ranges[c].lo   = lo + c0;
+		ranges[c].cnt  = c1 - c0;
+		ranges[c].dist = k;
+		ranges[c].dir  = dir;
+
+		if (c < chunks - 1 &&
+		    pthread_create(&helpers[c],NULL,compare_worker,(void *) &ranges[c]) != 0) {
+			printf("Error creating thread: %d\n",c);
+			exit(3);
+		}
+	}
+
+	compare_worker( (void*) &ranges[chunks-1] );
+
+	for (c = 0; c < chunks - 1; c++)
+		pthread_join(helpers[c],NULL);
+
+	free(helpers);
+	free(ranges);
+}
+
+// function : compare_worker()
+// description : Compare-exchange a range of the pairs of one level.
+//---------------------------------------------------------------------
+
+void* compare_worker(void *ptr)
+{
+	struct range_args *r = ptr;
+
+	kernel_compare_range(a + r->lo, r->cnt, r->dist, r->dir);
+	return NULL;
+}
 		
-		bitonic_merge( (void*) &merge_args1 );
-		bitonic_merge( (void*) &merge_args2 );
+// function : oddeven_merge()
+// description : Odd-even merge of a[lo..lo+cnt) (both halves sorted in
+//               dir) with a budget of threads. The levels depend on
+//               each other, so they run one after the other, and each
+//               large level is cut into up to that many equal ranges of
+//               pairs, as the compare levels of bitonic_merge().
+//---------------------------------------------------------------------
+
+void oddeven_merge(int lo, int cnt, int dir, int threads)
+{
+	int k;
+
+	if (threads <= 1 || cnt / 2 < 2 * merge_grain) {
+		kernel_oddeven_merge(a+lo,cnt,dir);
+		return;
+	}
+
+	for (k = cnt / 2; k >= 1; k /= 2) {
+
+		int pairs  = kernel_oddeven_pairs(cnt,k);
+		int chunks = pairs / merge_grain;
+		if (chunks > threads)
+			chunks = threads;
+
+		if (chunks > 1)
+			oddeven_level_split(lo,cnt,k,dir,chunks);
+		else
+			kernel_oddeven_level(a+lo,cnt,k,0,pairs,dir);
 	}
 }
+
+// function : oddeven_level_split()
+// description : The level at distance k of the odd-even merge of
+//               a[lo..lo+cnt), cut into chunks equal ranges of pairs.
+//               This thread does the last range and helper threads the
+//               others.
+//---------------------------------------------------------------------
+
+void oddeven_level_split(int lo, int cnt, int k, int dir, int chunks)
+{
+	pthread_t           *helpers = (pthread_t*) malloc(chunks * sizeof(pthread_t));
+	struct oddeven_args *ranges  = (struct oddeven_args*) malloc(chunks * sizeof(struct oddeven_args));
+	if (helpers == NULL || ranges == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	int pairs = kernel_oddeven_pairs(cnt,k);
+	int c;
+	for (c = 0; c < chunks; c++) {
+
+		ranges[c].lo  = lo;
+		ranges[c].cnt = cnt;
+		ranges[c].k   = k;
+		ranges[c].p0  = (int) ((long long) pairs * c / chunks);
+		ranges[c].p1  = (int) ((long long) pairs * (c + 1) / chunks);
+		ranges[c].dir = dir;
+
+		if (c < chunks - 1 &&
+		    pthread_create(&helpers[c],NULL,oddeven_worker,(void *) &ranges[c]) != 0) {
+			printf("Error creating thread: %d\n",c);
+			exit(3);
+		}
+	}
+
+	oddeven_worker( (void*) &ranges[chunks-1] );
+
+	for (c = 0; c < chunks - 1; c++)
+		pthread_join(helpers[c],NULL);
+
+	free(helpers);
+	free(ranges);
+}
+
+// function : oddeven_worker()
+// description : Compare-exchange a range of the pairs of one odd-even
+//               level.
+//---------------------------------------------------------------------
+
+void* oddeven_worker(void *ptr)
+{
+	struct oddeven_args *r = ptr;
+
+	kernel_oddeven_level(a + r->lo, r->cnt, r->k, r->p0, r->p1, r->dir);
+	return NULL;
+}
 		
+// function : fork_tasks()
+// description : Fork of the adaptive bitonic merge (-abs): task(x) on
+//               a new thread, task(y) on this one, then join. It is only
+//               called while the merge's budget of threads lasts.
+//---------------------------------------------------------------------
+
+void fork_tasks(abs_task task, void *x, void *y)
+{
+	pthread_t helper;
+	if (pthread_create(&helper,NULL,task,x) != 0) {
+		printf("Error creating thread.\n");
+		exit(3);
+	}
+	task(y);
+	pthread_join(helper,NULL);
+}
+
+// function : run_parts()
+// description : Parts of a streamed pass (-stream): parts 0..parts-2 on
+//               helper threads, the last one on this thread, then join,
+//               as compare_level_split() does for a compare level.
+//---------------------------------------------------------------------
+
+void run_parts(stream_part part, void *arg, int parts)
+{
+	pthread_t        *helpers = (pthread_t*) malloc(parts * sizeof(pthread_t));
+	struct part_args *pa      = (struct part_args*) malloc(parts * sizeof(struct part_args));
+	if (helpers == NULL || pa == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	int c;
+	for (c = 0; c < parts; c++) {
+
+		pa[c].part = part;
+		pa[c].arg  = arg;
+		pa[c].c    = c;
+
+		if (c < parts - 1 &&
+		    pthread_create(&helpers[c],NULL,part_worker,(void *) &pa[c]) != 0) {
+			printf("Error creating thread: %d\n",c);
+			exit(3);
+		}
+	}
+
+	part_worker( (void*) &pa[parts-1] );
+
+	for (c = 0; c < parts - 1; c++)
+		pthread_join(helpers[c],NULL);
+
+	free(helpers);
+	free(pa);
+}
+
+// function : part_worker()
+// description : One part of a streamed pass.
+//---------------------------------------------------------------------
+
+void* part_worker(void *ptr)
+{
+	struct part_args *p = ptr;
+
+	p->part(p->arg, p->c);
+	return NULL;
+}
+
+// function : merge_block()
+// description : Array merge of the adaptive bitonic merge (-abs): the
+//               blocks still in place take bitonic_merge() with the
+//               same budget of threads.
+//---------------------------------------------------------------------
+
+void merge_block(int lo, int cnt, int dir, int threads)
+{
+	struct args merge_args;
+	merge_args.lo  = lo;  merge_args.cnt  = cnt; merge_args.dir = dir;
+	merge_args.threads = threads;
+
+	bitonic_merge( (void*) &merge_args );
+}
+
 // function : rec_bitonic_sort()
 // description : The recursive bitonic sort algortithm executes from
-//               each pthread.
+//               each pthread. The leaves are sorted beforehand by
+//               sort_leaves(); above them, each call gets a budget of
+//               threads, gives half of it to a new thread for the first
+//               half and keeps the rest for the second.
 //---------------------------------------------------------------------
 	
 void *rec_bitonic_sort(void *ptr)
@@ -329,142 +924,368 @@ void *rec_bitonic_sort(void *ptr)
 	struct args *current_args = ptr;
 	
 	// parse arguments
-	int lo, cnt, dir, tid;	
-	lo  = (*current_args).lo;
-	cnt = (*current_args).cnt;
-	dir = (*current_args).dir;
+	int lo, cnt, dir, threads;	
+	lo      = (*current_args).lo;
+	cnt     = (*current_args).cnt;
+	dir     = (*current_args).dir;
+	threads = (*current_args).threads;
 
-	if (cnt > 1) {
+	if (cnt > parallel_threshold) {
 
 		int k = cnt / 2;
 
 		// arguments for first recursion
 		struct args sort_args1;
 		sort_args1.lo  = lo;   sort_args1.cnt = k; sort_args1.dir = ASCENDING;
+		sort_args1.threads = threads / 2;
 
-		// arguments for second recursion
+		// arguments for second recursion (the odd-even merge takes
+		// two ascending halves)
 		struct args sort_args2;
-		sort_args2.lo  = lo+k; sort_args2.cnt = k; sort_args2.dir = DESCENDING;
+		sort_args2.lo  = lo+k; sort_args2.cnt = k; sort_args2.dir = ODDEVEN_MODE ? ASCENDING : DESCENDING;
+		sort_args2.threads = threads - threads / 2;
 
 		// argument for merge
 		struct args merge_args;
 		merge_args.lo  = lo;  merge_args.cnt  = cnt; merge_args.dir = dir;
+		merge_args.threads = threads;
 
-		// Sorting Part 1
+		// Sorting Part
 		//----------------------------
 
+		// halves of leaf size are already sorted
+		if (k > parallel_threshold) {
 
-		// lock number of threads
-		pthread_mutex_lock(&thread_mutex);
-
-		int my_current = current_threads;
-		if (my_current < Nthreads) {
+			if (sort_args1.threads > 0) {
 
-			// create thread and execute
-			current_threads++;
-			
-			// create new thread and split the work
-			if (k > parallel_threshold) {
-				if (pthread_create(&threads[my_current],NULL,rec_bitonic_sort,(void *) &sort_args1) != 0) {
-					printf("Error creating thread: %ld\n",my_current);
+				// new thread for the first half, I do the second
+				pthread_t helper;
+				if (pthread_create(&helper,NULL,rec_bitonic_sort,(void *) &sort_args1) != 0) {
+					printf("Error creating thread.\n");
 					exit(3);
 				}
+				rec_bitonic_sort( (void*) &sort_args2 );
+				pthread_join(helper,NULL);
 			}
 			else {
-				if (pthread_create(&threads[my_current],NULL,par_qsort,(void *) &sort_args1) != 0) {
-					printf("Error creating thread: %ld\n",my_current);
-					exit(3);
-				}
+				rec_bitonic_sort( (void*) &sort_args1 );
+				rec_bitonic_sort( (void*) &sort_args2 );
 			}
+		}
+
+		// Merging Part
+		//----------------------------
+		
+		if (ABS_MODE)
+			abs_merge(lo,cnt,dir,threads);
+		else if (ODDEVEN_MODE)
+			oddeven_merge(lo,cnt,dir,threads);
+		else
+			bitonic_merge( (void*) &merge_args );
+	}
+}
+
+// function : sort_leaves()
+// description : Sort the N/parallel_threshold leaves of the recursion,
+//               each in the direction its parent merge needs. There are
+//               at least leaves_per_thread of them per thread, and the
+//               threads take them one at a time from a shared counter,
+//               so any number of threads gets an even share.
+//---------------------------------------------------------------------
+
+void sort_leaves(void)
+{
+	int t;
 
+	leaf_next = 0;
 
-			// unlock number of threads before joining
-			// so that others can use current as well
-			pthread_mutex_unlock(&thread_mutex);
+	for (t = 0; t < Nthreads - 1; t++) {
 
+		if (pthread_create(&threads[t],NULL,leaf_worker,NULL) != 0) {
+			printf("Error creating thread: %d\n",t);
+			exit(3);
 		}
-		else {
+	}
 
-			// unlock number of threads before joining
-			// so that others can use current as well
-			pthread_mutex_unlock(&thread_mutex);
+	leaf_worker(NULL);
 
-			// cannot create new thread - continue working
-			if (k > parallel_threshold) {
-				rec_bitonic_sort( (void*) &sort_args1 );
-			}
-			else {
-				qsort(a+lo, k, sizeof(int), cmpfunc_asc);
-			}
+	for (t = 0; t < Nthreads - 1; t++) {
+		pthread_join(threads[t],NULL);
+	}
+}
+
+// function : leaf_worker()
+// description : Take leaves from the shared counter until none is left.
+//               Leaf i is the first half of its parent when i is even
+//               (ascending) and the second half otherwise.
+//---------------------------------------------------------------------
+
+void* leaf_worker(void *ptr)
+{
+	int nleaves = N / parallel_threshold;
+	int i;
+
+	while (1) {
+
+		pthread_mutex_lock(&leaf_mutex);
+		i = leaf_next++;
+		pthread_mutex_unlock(&leaf_mutex);
+
+		if (i >= nleaves)
+			break;
 
+		int lo  = i * parallel_threshold;
+		int dir = (i % 2 == 0 || ODDEVEN_MODE) ? ASCENDING : DESCENDING;
+
+		// wait for the keys of my leaf, then sort it
+		sort_io_wait(lo,parallel_threshold);
+		qsort(a+lo,parallel_threshold,sizeof(int),dir == ASCENDING ? cmpfunc_asc : cmpfunc_des);
+	}
+
+	return NULL;
+}
+
+// function : iter_bitonic_sort()
+// description : Iterative bitonic sort over the log^2 N stages. Creates
+//               one pthread per block of a and waits for all of them.
+//---------------------------------------------------------------------
+
+void iter_bitonic_sort(void)
+{
+	int t;
+	int *tids = (int*) malloc(Nthreads * sizeof(int));
+	if (tids == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	pthread_barrier_init(&stage_barrier, NULL, Nthreads);
+
+	for (t = 0; t < Nthreads; t++) {
+
+		tids[t] = t;
+		if (pthread_create(&threads[t],NULL,iter_worker,(void *) &tids[t]) != 0) {
+			printf("Error creating thread: %d\n",t);
+			exit(3);
 		}
+	}
 
+	for (t = 0; t < Nthreads; t++) {
+		pthread_join(threads[t],NULL);
+	}
 
-		// Sorting Part 2
-		//----------------------------
+	pthread_barrier_destroy(&stage_barrier);
+	free(tids);
+}
 
-		if (k > parallel_threshold) {
+// function : iter_worker()
+// description : Thread t owns a fixed range of the blocks of a
+//               (B = N/blocks) for the whole sort. Strides below B stay
+//               inside a block and run without synchronization; the
+//               larger ones are split between the owners of the two blocks and
+//               separated by barriers.
+//---------------------------------------------------------------------
 
-			// I will do the rest of the job
-			rec_bitonic_sort( (void*) &sort_args2 );
+void* iter_worker(void *ptr)
+{
+	int t  = *(int*) ptr;
+	int L  = iter_blocks();
+	int B  = N / L;
+	int b0 = (int) ((long long) L * t / Nthreads);
+	int b1 = (int) ((long long) L * (t + 1) / Nthreads);
+	int b, j, k;
+
+	// stages k <= B: sort my blocks (even blocks ascending)
+	for (b = b0; b < b1; b++) {
+		sort_io_wait(b*B,B);
+		qsort(a+b*B, B, sizeof(int), (b % 2 == 0) ? cmpfunc_asc : cmpfunc_des);
+	}
+
+	// stages k > B
+	for (k = 2*B; k <= N; k <<= 1) {
+
+		for (j = k/2; j >= B; j >>= 1) {
+
+			pthread_barrier_wait(&stage_barrier);
+			iter_compare_stride(t,j,k);
 		}
-		else {
 
-			qsort(a+lo+k, k, sizeof(int), cmpfunc_des);
+		pthread_barrier_wait(&stage_barrier);
+
+		for (b = b0; b < b1; b++) {
+
+			struct args merge_args;
+			merge_args.lo      = b*B;
+			merge_args.cnt     = B;
+			merge_args.dir     = ((b*B) & k) == 0 ? ASCENDING : DESCENDING;
+			merge_args.threads = 1;
+
+			bitonic_merge( (void*) &merge_args );
 		}
+	}
 
-		// join my created thread
-		if (my_current < Nthreads)
-			pthread_join(threads[my_current],NULL);
+	return NULL;
+}
 
-		// Merging Part
-		//----------------------------
-		
-		bitonic_merge( (void*) &merge_args );
+// function : remap_bitonic_sort()
+// description : Bitonic sort with the blocked <-> cyclic remapping of
+//               common/remap.c. Creates remap_T pthreads (a power of
+//               two, remap_T^2 <= N) and waits for all of them.
+//---------------------------------------------------------------------
+
+void remap_bitonic_sort(void)
+{
+	int t;
+	int *tids = (int*) malloc(Nthreads * sizeof(int));
+	remap_T   = remap_threads(N,Nthreads);
+	remap_buf = (int*) malloc(N * sizeof(int));
+	if (tids == NULL || remap_buf == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
 	}
 
+	pthread_barrier_init(&stage_barrier, NULL, remap_T);
 
+	for (t = 0; t < remap_T; t++) {
+
+		tids[t] = t;
+		if (pthread_create(&threads[t],NULL,remap_worker,(void *) &tids[t]) != 0) {
+			printf("Error creating thread: %d\n",t);
+			exit(3);
+		}
+	}
+
+	for (t = 0; t < remap_T; t++) {
+		pthread_join(threads[t],NULL);
+	}
+
+	pthread_barrier_destroy(&stage_barrier);
+	free(remap_buf);
+	free(tids);
 }
 
-// function : compare()
-// description: Compare two positions and swap (if necessary) to get
-//              the desired direction (i.e. ascending).
+// function : remap_worker()
+// description : Thread r sorts its block of M = N/remap_T keys. Every
+//               stage k > M then needs two transposes, and between them
+//               the thread merges only its own M keys.
 //---------------------------------------------------------------------
 
-void compare(int i, int j, int dir)
+void* remap_worker(void *ptr)
 {
-	if ( dir == (a[i]>a[j]) ) {
-		
-		int t;
-		t = a[i];
-		a[i] = a[j];
-		a[j] = t;
+	int r = *(int*) ptr;
+	int T = remap_T;
+	int M = N / T;
+	int k;
+
+	// stages k <= M: sort my block (even blocks ascending)
+	sort_io_wait(r*M,M);
+	qsort(a+r*M, M, sizeof(int), (r % 2 == 0) ? cmpfunc_asc : cmpfunc_des);
+
+	// stages k > M
+	for (k = 2*M; k <= N; k <<= 1) {
+
+		pthread_barrier_wait(&stage_barrier);
+		remap_to_cyclic(a,remap_buf,N,T,r);
+		pthread_barrier_wait(&stage_barrier);
+		remap_cyclic_steps(remap_buf,N,T,r,k);
+		pthread_barrier_wait(&stage_barrier);
+		remap_to_blocked(remap_buf,a,N,T,r);
+		remap_blocked_steps(a,N,T,r,k);
 	}
+
+	return NULL;
 }
 
-void* par_qsort(void* ptr)
+// function : iter_compare_stride()
+// description : Thread t's share of the compare-exchanges at stride
+//               j >= B inside stage k. Thread t keeps its blocks
+//               [b0,b1) of iter_blocks() for every stage. A pair of
+//               blocks (b, b^(j/B)) that t owns both of is done by t in
+//               full; when the partner belongs to another thread, the
+//               lower block's owner does the first half of the compares
+//               and the upper one the second half. Either way a thread
+//               does B/2 compares per block it owns, for any Nthreads.
+//---------------------------------------------------------------------
+
+void iter_compare_stride(int t, int j, int k)
 {
-	struct args *current_args = ptr;
-	
-	// parse arguments
-	int lo, cnt, dir;	
-	lo  = (*current_args).lo;
-	cnt = (*current_args).cnt;
-	dir = (*current_args).dir;
+	int L  = iter_blocks();
+	int B  = N / L;
+	int h  = B / 2;
+	int b0 = (int) ((long long) L * t / Nthreads);
+	int b1 = (int) ((long long) L * (t + 1) / Nthreads);
+	int b;
+
+	for (b = b0; b < b1; b++) {
+
+		int lo  = b * B;
+		int p   = b ^ (j / B); //partner block
+		int dir = (lo & k) == 0 ? ASCENDING : DESCENDING;
+
+		if (p >= b0 && p < b1) {
+
+			// both blocks mine: the lower one does the whole pair
+			if ((lo & j) == 0)
+				kernel_compare_range(a+lo, B, j, dir);
+		}
+		else if ((lo & j) == 0) {
+
+			// lower block: first half against the partner block
+			kernel_compare_range(a+lo, h, j, dir);
+		}
+		else {
+
+			// upper block: second half against the partner block
+			kernel_compare_range(a+lo-j+h, B-h, j, dir);
+		}
+	}
+}
+
+// function : iter_blocks()
+// description : Number of blocks of the iterative schedule: one per
+//               thread when Nthreads is a power of two, otherwise a
+//               power of two with at least 8 per thread (at most N/2),
+//               handed out as contiguous ranges so that they even out.
+//---------------------------------------------------------------------
+
+int iter_blocks(void)
+{
+	int L = Nthreads;
+
+	if ((L & (L - 1)) != 0) {
+		L = 1;
+		while (L < 8 * Nthreads && L < N/2)
+			L <<= 1;
+	}
+
+	return L;
+}
+
+// function : count_comparators()
+// description : Comparators the recursive sort of cnt keys goes through
+//               with the odd-even (oddeven = 1) or the bitonic merges.
+//               The qsort leaves are not networks and are not counted.
+//---------------------------------------------------------------------
+
+long long count_comparators(int cnt, int oddeven)
+{
+	long long c = kernel_merge_comparators(cnt,oddeven);
+
+	if (cnt/2 > parallel_threshold)
+		c += 2 * count_comparators(cnt/2,oddeven);
 
-	// sort array
-	qsort(a+lo,cnt,sizeof(int),dir == ASCENDING ? cmpfunc_asc : cmpfunc_des);
+	return c;
 }
 
 //code from:
 //www.tutorialspoint.com/c_standard_library/c_function_qsort.htm
 int cmpfunc_asc(const void* a, const void* b)
 {
-	return ( *(int*)a - *(int*)b );
+	return ( (*(int*)a > *(int*)b) - (*(int*)a < *(int*)b) ); //no overflow on file keys
 }
 
 int cmpfunc_des(const void* a, const void* b)
 {
-	return ( - *(int*)a + *(int*)b );
+	return ( (*(int*)a < *(int*)b) - (*(int*)a > *(int*)b) );
 }
 
@@ -0,0 +1,276 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "../common/search_index.h"
+#include "../common/bitonic_engine.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+int TEST_MODE = 0;
+
+// for time measurements
+struct timeval startwtime, endwtime;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int P; //number of threads
+int p; //log2(number of threads)
+int N; //number of keys
+int q; //log2(number of keys)
+int M; //number of lookups
+
+int *a;     //the sorted keys
+int *qlo;   //lookup keys, and the low ends of the ranges
+int *qhi;   //high ends of the ranges
+int *lb;    //lower bounds from the index
+int *cnt;   //range counts from the index
+int *found; //bsearch hits
+
+struct search_index si;
+
+
+// Function Declaration
+//===========================================================
+
+void   parse_arguments(int argc,char *argv[]);
+void   init           (void);
+void   lookups        (void);
+void   test           (void);
+int    lower_bound    (const int*, int, int);
+double elapsed        (struct timeval*, struct timeval*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+	init();
+	lookups();
+	test();
+
+	search_index_free(&si);
+	free(a);
+	free(qlo);
+	free(qhi);
+	free(lb);
+	free(cnt);
+	free(found);
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 3) {
+		printf("Usage: %s [%s] p q m\n\nwhere, %s is an optional flag (test mode)\n       P=2^p is the number of threads\n       N=2^q is the number of keys\n       m is the number of lookups\n",
+		       argv[0],TEST_FLAG,TEST_FLAG);
+		exit(1);
+	}
+
+	p = atoi(argv[arg]);
+	q = atoi(argv[arg+1]);
+	M = atoi(argv[arg+2]);
+
+	if (M < 1) {
+		printf("m must be at least 1.\n");
+		exit(1);
+	}
+
+	P = 1 << p;
+	N = 1 << q;
+}
+
+// function : init()
+// description : Sort N random keys, build the index from them and
+//               print the build time, then draw the lookups.
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	int i;
+
+	a     = (int*) malloc((size_t) N * sizeof(int));
+	qlo   = (int*) malloc((size_t) M * sizeof(int));
+	qhi   = (int*) malloc((size_t) M * sizeof(int));
+	lb    = (int*) malloc((size_t) M * sizeof(int));
+	cnt   = (int*) malloc((size_t) M * sizeof(int));
+	found = (int*) malloc((size_t) M * sizeof(int));
+	if (a == NULL || qlo == NULL || qhi == NULL || lb == NULL ||
+	    cnt == NULL || found == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	srand( time(NULL) );
+	for (i = 0; i < N; i++) {
+		a[i] = rand() % N;
+	}
+	engine_sort(a, N, ENGINE_ASCENDING, P);
+
+	gettimeofday(&startwtime,NULL);
+	if (search_index_build(&si, a, N, P) != 0) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	gettimeofday(&endwtime,NULL);
+	printf("build: %lf s\n", elapsed(&startwtime, &endwtime));
+
+	// a few lookups fall outside the keys on both sides
+	for (i = 0; i < M; i++) {
+		qlo[i] = rand() % (N + 2) - 1;
+		qhi[i] = qlo[i] + rand() % 64;
+	}
+}
+
+// function : lookups()
+// description : Time the same lookups with bsearch, a plain binary
+//               lower bound and the index, then the range counts. The
+//               first line is the index time.
+//---------------------------------------------------------------------
+
+void lookups(void)
+{
+	double t_bs, t_bin, t_idx, t_rng;
+	int i, sink = 0;
+
+	gettimeofday(&startwtime,NULL);
+	for (i = 0; i < M; i++)
+		found[i] = (bsearch(&qlo[i], a, N, sizeof(int), engine_cmp_asc) != NULL);
+	gettimeofday(&endwtime,NULL);
+	t_bs = elapsed(&startwtime, &endwtime);
+
+	gettimeofday(&startwtime,NULL);
+	for (i = 0; i < M; i++)
+		sink += lower_bound(a, N, qlo[i]);
+	gettimeofday(&endwtime,NULL);
+	t_bin = elapsed(&startwtime, &endwtime);
+
+	gettimeofday(&startwtime,NULL);
+	search_lower_bound(&si, qlo, M, lb);
+	gettimeofday(&endwtime,NULL);
+	t_idx = elapsed(&startwtime, &endwtime);
+
+	gettimeofday(&startwtime,NULL);
+	search_range_count(&si, qlo, qhi, M, cnt);
+	gettimeofday(&endwtime,NULL);
+	t_rng = elapsed(&startwtime, &endwtime);
+
+	printf("%lf\n",t_idx);
+	printf("bsearch:     %lf s, %.1lf Mlookups/s\n", t_bs,  M / t_bs  / 1e6);
+	printf("binary:      %lf s, %.1lf Mlookups/s\n", t_bin, M / t_bin / 1e6);
+	printf("index:       %lf s, %.1lf Mlookups/s (%.1lfx bsearch)\n", t_idx, M / t_idx / 1e6, t_bs / t_idx);
+	printf("range count: %lf s, %.1lf Mlookups/s\n", t_rng, M / t_rng / 1e6);
+
+	if (sink == -1)
+		printf("\n");
+}
+
+// function : test()
+// description : Check the lower bounds and range counts against a
+//               binary search, and the hits against bsearch.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	int i, ok = 1;
+
+	if (TEST_MODE) {
+
+		for (i = 0; i < M && ok; i++) {
+			int l = lower_bound(a, N, qlo[i]);
+			int u = (qhi[i] == 0x7fffffff) ? N : lower_bound(a, N, qhi[i] + 1);
+			ok = (lb[i] == l && cnt[i] == u - l &&
+			      found[i] == (l < N && a[l] == qlo[i]));
+		}
+
+		if (ok)
+			printf("Test PASSED. Same results with stdlib/bsearch.\n");
+		else
+			printf("Test NOT PASSED. Different results with stdlib/bsearch.\n");
+	}
+}
+
+// function : lower_bound()
+// description : First position in v[0..n) with key >= x, by plain
+//               binary search.
+//---------------------------------------------------------------------
+
+int lower_bound(const int *v, int n, int x)
+{
+	int lo = 0, hi = n;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (v[mid] < x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// function : elapsed()
+// description : Seconds between two gettimeofday() samples.
+//---------------------------------------------------------------------
+
+double elapsed(struct timeval *t0, struct timeval *t1)
+{
+	return (double) ( (t1->tv_usec - t0->tv_usec) / 1.0e6
+	                + t1->tv_sec - t0->tv_sec );
+}
@@ -0,0 +1,394 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sort_protocol.h"
+#include "../common/presort.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+const char* SHM_FLAG = "-shm\0";
+const int SHM_FLAG_LENGTH = 4;
+
+const char* PRIO_FLAG = "-prio\0";
+const int PRIO_FLAG_LENGTH = 5;
+
+const char* STATS_FLAG = "-stats\0";
+const int STATS_FLAG_LENGTH = 6;
+
+const char* APPEND_FLAG = "-append\0";
+const int APPEND_FLAG_LENGTH = 7;
+
+int TEST_MODE  = 0;
+int SHM_MODE   = 0; //shm_open() segment instead of a memfd
+int STATS_MODE = 0; //only ask the daemon for its metrics
+int APPEND_MODE = 0; //nearly sorted keys: sorted, then a random tail
+
+// for time measurements
+struct timeval startwtime, endwtime;
+double seq_time;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int *a; //keys, inside the shared segment
+int *b; //array to sort with stdlib.h/qsort
+
+int N;        //problem size
+int q;        //log2(problem size)
+int priority = 0;
+
+int  seg_fd = -1;
+char shm_name[SORT_SHM_NAME_LENGTH];
+int  sock   = -1;
+
+
+// Function Declaration
+//===========================================================
+
+void parse_arguments(int argc,char *argv[]);
+void init           (void);
+void exec           (void);
+void stats          (void);
+void test           (void);
+void clear          (void);
+void connect_daemon (void);
+int  cmpfunc        (const void*, const void*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+	connect_daemon();
+
+	if (STATS_MODE) {
+		stats();
+	}
+	else {
+		init();
+		exec();
+		test();
+		clear();
+	}
+
+	close(sock);
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],SHM_FLAG,SHM_FLAG_LENGTH+1)) {
+			SHM_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],STATS_FLAG,STATS_FLAG_LENGTH+1)) {
+			STATS_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],APPEND_FLAG,APPEND_FLAG_LENGTH+1)) {
+			APPEND_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],PRIO_FLAG,PRIO_FLAG_LENGTH+1) && arg+1 < argc) {
+			priority = atoi(argv[++arg]);
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (STATS_MODE)
+		return;
+
+	if (argc - arg != 1) {
+		printf("Usage: %s [%s] [%s] [%s] [%s n] q\n       %s %s\n\nwhere, %s is an optional flag (test mode)\n       %s passes a shm_open() segment instead of a memfd\n       %s sends nearly sorted keys (sorted, then 1/64 random)\n       %s n sets the job priority (higher first)\n       %s prints the daemon metrics\n       N=2^q is the problem size\n",
+		       argv[0],TEST_FLAG,SHM_FLAG,APPEND_FLAG,PRIO_FLAG,argv[0],STATS_FLAG,
+		       TEST_FLAG,SHM_FLAG,APPEND_FLAG,PRIO_FLAG,STATS_FLAG);
+		exit(1);
+	}
+
+	q = atoi(argv[arg]);
+	N = 1 << q;
+}
+
+// function : connect_daemon()
+// description : Connect to the daemon's Unix domain socket.
+//---------------------------------------------------------------------
+
+void connect_daemon(void)
+{
+	struct sockaddr_un addr;
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, SORT_SOCKET_PATH, sizeof(addr.sun_path) - 1);
+
+	if (sock < 0 || connect(sock, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+		printf("Cannot connect to the sort daemon at %s\n", SORT_SOCKET_PATH);
+		exit(2);
+	}
+}
+
+// function : init()
+// description : Create the shared segment, map it and fill it with
+//               random keys.
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	size_t bytes = (size_t) N * sizeof(int);
+
+	if (SHM_MODE) {
+		snprintf(shm_name, sizeof(shm_name), "/bitonic_sort_%d", (int) getpid());
+		seg_fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	}
+	else {
+		shm_name[0] = '\0';
+		seg_fd = memfd_create("bitonic_sort", MFD_CLOEXEC);
+	}
+
+	if (seg_fd < 0 || ftruncate(seg_fd, bytes) != 0) {
+		printf("Error creating the shared segment.\n");
+		exit(4);
+	}
+
+	a = (int*) mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, seg_fd, 0);
+	if (a == MAP_FAILED) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	if (TEST_MODE) {
+		b = (int*) malloc(bytes);
+		if (b == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+	}
+
+	//initialize arrays
+	srand( time(NULL) ^ getpid() );
+	int i;
+	for (i = 0; i < N; i++) {
+		a[i] = rand() % N;
+	}
+
+	// a sorted array with 1/64 of new keys appended
+	if (APPEND_MODE) {
+		qsort(a, N - N/64, sizeof(int), cmpfunc);
+	}
+
+	if (TEST_MODE) {
+		for(i = 0; i < N; i++) {
+			b[i] = a[i];
+		}
+	}
+}
+
+// function : exec()
+// description : Send the request (descriptor attached for a memfd) and
+//               wait for the daemon to sort the segment in place.
+//               Prints the round trip time.
+//---------------------------------------------------------------------
+
+void exec(void)
+{
+	struct sort_request req;
+	struct sort_reply   rep;
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov;
+	struct msghdr msg;
+
+	memset(&req, 0, sizeof(req));
+	req.magic    = SORT_MAGIC;
+	req.op       = SORT_OP_SORT;
+	req.offset   = 0;
+	req.count    = N;
+	req.dir      = 1;
+	req.priority = priority;
+	snprintf(req.shm_name, SORT_SHM_NAME_LENGTH, "%s", shm_name);
+
+	iov.iov_base = &req;
+	iov.iov_len  = sizeof(req);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov    = &iov;
+	msg.msg_iovlen = 1;
+
+	if (!SHM_MODE) {
+
+		struct cmsghdr *cmsg;
+
+		memset(control, 0, sizeof(control));
+		msg.msg_control    = control;
+		msg.msg_controllen = sizeof(control);
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type  = SCM_RIGHTS;
+		cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &seg_fd, sizeof(int));
+	}
+
+	// start measuring time
+	gettimeofday(&startwtime,NULL);
+
+	if (sendmsg(sock, &msg, 0) != sizeof(req) ||
+	    recv(sock, &rep, sizeof(rep), MSG_WAITALL) != sizeof(rep)) {
+		printf("Lost connection to the sort daemon.\n");
+		exit(2);
+	}
+
+	// stop measuring time
+	gettimeofday(&endwtime,NULL);
+
+	if (rep.status != SORT_OK) {
+		printf("Sort rejected by the daemon (status %d).\n", rep.status);
+		exit(5);
+	}
+
+	// calculate time
+	seq_time = (double) ( (endwtime.tv_usec - startwtime.tv_usec) / 1.0e6
+	           + endwtime.tv_sec - startwtime.tv_sec );
+
+	// print time
+	printf("%lf\n",seq_time);
+
+	if (TEST_MODE) {
+		printf("queue: %lf s, sort: %lf s, threads: %d, presort: %s\n",
+		       rep.queue_time, rep.sort_time, rep.threads, presort_path_name(rep.presort));
+	}
+}
+
+// function : stats()
+// description : Print the daemon metrics.
+//---------------------------------------------------------------------
+
+void stats(void)
+{
+	struct sort_request req;
+	struct sort_reply   rep;
+
+	memset(&req, 0, sizeof(req));
+	req.magic = SORT_MAGIC;
+	req.op    = SORT_OP_STATS;
+
+	if (send(sock, &req, sizeof(req), 0) != sizeof(req) ||
+	    recv(sock, &rep, sizeof(rep), MSG_WAITALL) != sizeof(rep)) {
+		printf("Lost connection to the sort daemon.\n");
+		exit(2);
+	}
+
+	printf("jobs done: %llu\nrejected: %llu\nlatency p50: %lf\nlatency p99: %lf\n",
+	       (unsigned long long) rep.jobs_done,
+	       (unsigned long long) rep.jobs_rejected,
+	       rep.latency_p50, rep.latency_p99);
+}
+
+// function : test()
+// description : Check the result of the daemon against the
+//               stdlib/qsort.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	if (TEST_MODE) {
+
+		//sort secondary array
+		qsort(b,N,sizeof(int),cmpfunc);
+
+		//compare the results
+		int passed = 1;
+		int i;
+		for (i = 0; i < N; i++) {
+
+			if (a[i] != b[i]) {
+				passed = 0;
+				break;
+			}
+		}
+
+		if (passed) {
+			printf("Test PASSED. Same results with stdlib/qsort.\n");
+		}
+		else {
+			printf("Test NOT PASSED. Different results with stdlib/qsort.\n");
+		}
+	}
+}
+
+// function : clear()
+// description : Unmap and remove the shared segment.
+//---------------------------------------------------------------------
+
+void clear(void)
+{
+	munmap(a, (size_t) N * sizeof(int));
+	close(seg_fd);
+
+	if (SHM_MODE)
+		shm_unlink(shm_name);
+
+	if (TEST_MODE)
+		free(b);
+}
+
+//code from:
+//www.tutorialspoint.com/c_standard_library/c_function_qsort.htm
+int cmpfunc(const void* a, const void* b)
+{
+	return ( *(int*)a - *(int*)b );
+}
@@ -0,0 +1,614 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "sort_protocol.h"
+#include "../common/bitonic_engine.h"
+#include "../common/presort.h"
+#include "../common/sort_dispatch.h"
+
+
+// Constants & Variables (Service Related)
+//===========================================================
+
+int P;       //number of sorting threads shared by all jobs
+int p;       //log2(P)
+int Njobs;   //jobs sorted concurrently (runner threads)
+int Nqueue;  //jobs allowed to wait for a runner (admission control)
+
+int listen_fd = -1;
+volatile sig_atomic_t stop = 0;
+
+struct job {
+
+	int     *keys;
+	void    *map;        //mapping that contains keys
+	size_t   map_len;
+	uint64_t count;
+	int      dir;
+	int      priority;
+	long     seq;        //arrival order, breaks priority ties
+
+	double   t_submit;
+	double   t_start;
+	double   t_done;
+	int      threads;
+	int      presort;    //path taken by the pre-pass
+	int      finished;
+	pthread_cond_t done;
+}; // one sort request between admission and reply
+
+// priority queue (binary max-heap on priority, then arrival)
+struct job **heap;
+int heap_size = 0;
+long next_seq = 0;
+
+int running = 0;  //jobs currently being sorted
+
+pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t  queue_cond  = PTHREAD_COND_INITIALIZER;
+
+// latency metrics (guarded by queue_mutex)
+double   latency[SORT_LATENCY_WINDOW];
+uint64_t jobs_done     = 0;
+uint64_t jobs_rejected = 0;
+
+pthread_t* runners = NULL;
+
+
+// Function Declaration
+//===========================================================
+
+void  parse_arguments (int argc,char *argv[]);
+void  init            (void);
+void  serve           (void);
+void  clear           (void);
+void* runner          (void*);
+void* handle_client   (void*);
+int   recv_request    (int, struct sort_request*, int*);
+int   map_segment     (struct sort_request*, int, struct job*);
+void  heap_push       (struct job*);
+struct job* heap_pop  (void);
+int   job_before      (struct job*, struct job*);
+void  latency_stats   (struct sort_reply*);
+int   cmpfunc_double  (const void*, const void*);
+double now            (void);
+void  on_signal       (int);
+void  block_signals   (int);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+	init();
+	serve();
+	clear();
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 4) {
+		printf("Usage: %s p [jobs] [queue]\n\nwhere,  P=2^p is the number of sorting threads\n        jobs is the number of jobs sorted concurrently (default 2)\n        queue is the number of jobs allowed to wait (default 64)\n",argv[0]);
+		exit(1);
+	}
+
+	p = atoi(argv[1]);
+	P = 1 << p;
+
+	Njobs  = (argc > 2) ? atoi(argv[2]) : 2;
+	Nqueue = (argc > 3) ? atoi(argv[3]) : 64;
+
+	if (Njobs < 1 || Nqueue < 1) {
+		printf("jobs and queue must be positive.\n");
+		exit(1);
+	}
+}
+
+// function : init()
+// description : Bind the Unix domain socket and start the runner
+//               threads. The runners live as long as the daemon, so
+//               their OpenMP teams stay warm between jobs.
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	int i;
+
+	heap    = (struct job**) malloc(Nqueue * sizeof(struct job*));
+	runners = (pthread_t*)   malloc(Njobs  * sizeof(pthread_t));
+	if (heap == NULL || runners == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	// stop cleanly on SIGINT/SIGTERM (no SA_RESTART: accept() returns)
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT,  &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		perror("socket");
+		exit(2);
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, SORT_SOCKET_PATH, sizeof(addr.sun_path) - 1);
+	unlink(SORT_SOCKET_PATH);
+
+	if (bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+	    listen(listen_fd, 128) != 0) {
+		perror("bind/listen");
+		exit(2);
+	}
+
+	// only the main thread takes the signals
+	block_signals(1);
+	for (i = 0; i < Njobs; i++) {
+		if (pthread_create(&runners[i],NULL,runner,NULL) != 0) {
+			printf("Error creating thread: %d\n",i);
+			exit(3);
+		}
+	}
+	block_signals(0);
+
+	// measure the dispatcher's cost model now, not on the first job
+	dispatch_calibrate();
+
+	printf("sort daemon: %d threads, %d concurrent jobs, queue %d, socket %s\n",
+	       P, Njobs, Nqueue, SORT_SOCKET_PATH);
+	fflush(stdout);
+}
+
+// function : serve()
+// description : Accept clients until a signal arrives. Every connection
+//               gets a detached thread that forwards its requests.
+//---------------------------------------------------------------------
+
+void serve(void)
+{
+	while (!stop) {
+
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("accept");
+			break;
+		}
+
+		int *arg = (int*) malloc(sizeof(int));
+		if (arg == NULL) {
+			close(fd);
+			continue;
+		}
+		*arg = fd;
+
+		pthread_t client;
+		block_signals(1);
+		if (pthread_create(&client,NULL,handle_client,(void *) arg) != 0) {
+			close(fd);
+			free(arg);
+		}
+		else {
+			pthread_detach(client);
+		}
+		block_signals(0);
+	}
+}
+
+// function : clear()
+// description : Stop the runners, print the final metrics and remove
+//               the socket.
+//---------------------------------------------------------------------
+
+void clear(void)
+{
+	struct sort_reply stats;
+	int i;
+
+	pthread_mutex_lock(&queue_mutex);
+	pthread_cond_broadcast(&queue_cond);
+	latency_stats(&stats);
+	pthread_mutex_unlock(&queue_mutex);
+
+	for (i = 0; i < Njobs; i++) {
+		pthread_join(runners[i],NULL);
+	}
+
+	printf("jobs done: %llu, rejected: %llu, latency p50: %lf, p99: %lf\n",
+	       (unsigned long long) stats.jobs_done,
+	       (unsigned long long) stats.jobs_rejected,
+	       stats.latency_p50, stats.latency_p99);
+
+	close(listen_fd);
+	unlink(SORT_SOCKET_PATH);
+	free(heap);
+	free(runners);
+}
+
+// function : runner()
+// description : Take the highest priority job and sort it in place.
+//               The threads are shared between the running jobs: a job
+//               gets P divided by the number of jobs running when it
+//               starts.
+//---------------------------------------------------------------------
+
+void* runner(void *ptr)
+{
+	while (1) {
+
+		pthread_mutex_lock(&queue_mutex);
+		while (heap_size == 0 && !stop)
+			pthread_cond_wait(&queue_cond, &queue_mutex);
+
+		if (stop) {
+			pthread_mutex_unlock(&queue_mutex);
+			break;
+		}
+
+		struct job *j = heap_pop();
+		running++;
+		j->threads = P / running;
+		if (j->threads < 1)
+			j->threads = 1;
+		pthread_mutex_unlock(&queue_mutex);
+
+		// small jobs need fewer threads than their share (the engine
+		// makes the same choice, this only reports it)
+		j->threads = dispatch_plan((long long) j->count, DISPATCH_KEY_INT, DISPATCH_LEAF_QSORT, j->threads).threads;
+
+		// sorted, reversed and nearly sorted keys are finished by
+		// the pre-pass, random keys get the full bitonic sort
+		j->t_start = now();
+		j->presort = presort_sort(j->keys, (int) j->count, j->dir, j->threads, NULL);
+		if (j->presort == PRESORT_RANDOM)
+			engine_sort(j->keys, (int) j->count, j->dir, j->threads);
+		j->t_done  = now();
+
+		pthread_mutex_lock(&queue_mutex);
+		running--;
+		latency[jobs_done % SORT_LATENCY_WINDOW] = j->t_done - j->t_submit;
+		jobs_done++;
+		j->finished = 1;
+		pthread_cond_signal(&j->done);
+		pthread_mutex_unlock(&queue_mutex);
+	}
+
+	return NULL;
+}
+
+// function : handle_client()
+// description : Serve the requests of one connection. A sort request
+//               is admitted only if the wait queue has room, otherwise
+//               it is answered with SORT_EBUSY right away.
+//---------------------------------------------------------------------
+
+void* handle_client(void *ptr)
+{
+	int fd = *(int*) ptr;
+	free(ptr);
+
+	struct sort_request req;
+	struct sort_reply   rep;
+	int seg_fd;
+
+	while (recv_request(fd, &req, &seg_fd) == 0) {
+
+		memset(&rep, 0, sizeof(rep));
+
+		if (req.magic != SORT_MAGIC) {
+			rep.status = SORT_EINVAL;
+		}
+		else if (req.op == SORT_OP_STATS) {
+
+			pthread_mutex_lock(&queue_mutex);
+			latency_stats(&rep);
+			pthread_mutex_unlock(&queue_mutex);
+			rep.status = SORT_OK;
+		}
+		else if (req.op == SORT_OP_SORT) {
+
+			struct job j;
+			memset(&j, 0, sizeof(j));
+			j.t_submit = now();
+
+			rep.status = map_segment(&req, seg_fd, &j);
+			seg_fd = -1;
+
+			if (rep.status == SORT_OK) {
+
+				pthread_cond_init(&j.done, NULL);
+
+				pthread_mutex_lock(&queue_mutex);
+				if (heap_size >= Nqueue || stop) {
+					jobs_rejected++;
+					rep.status = SORT_EBUSY;
+				}
+				else {
+					heap_push(&j);
+					pthread_cond_signal(&queue_cond);
+					while (!j.finished)
+						pthread_cond_wait(&j.done, &queue_mutex);
+				}
+				rep.jobs_done     = jobs_done;
+				rep.jobs_rejected = jobs_rejected;
+				pthread_mutex_unlock(&queue_mutex);
+
+				if (rep.status == SORT_OK) {
+					rep.threads    = j.threads;
+					rep.queue_time = j.t_start - j.t_submit;
+					rep.sort_time  = j.t_done  - j.t_start;
+					rep.presort    = j.presort;
+				}
+
+				pthread_cond_destroy(&j.done);
+				munmap(j.map, j.map_len);
+			}
+		}
+		else {
+			rep.status = SORT_EINVAL;
+		}
+
+		if (seg_fd >= 0)
+			close(seg_fd);
+
+		if (send(fd, &rep, sizeof(rep), 0) != sizeof(rep))
+			break;
+	}
+
+	close(fd);
+	return NULL;
+}
+
+// function : recv_request()
+// description : Read one request and the descriptor attached to it
+//               (-1 if none). Returns -1 when the client is gone.
+//---------------------------------------------------------------------
+
+int recv_request(int fd, struct sort_request *req, int *seg_fd)
+{
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	ssize_t got;
+
+	*seg_fd = -1;
+
+	iov.iov_base = req;
+	iov.iov_len  = sizeof(*req);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov        = &iov;
+	msg.msg_iovlen     = 1;
+	msg.msg_control    = control;
+	msg.msg_controllen = sizeof(control);
+
+	got = recvmsg(fd, &msg, MSG_WAITALL);
+	if (got != sizeof(*req))
+		return -1;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg,cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(seg_fd, CMSG_DATA(cmsg), sizeof(int));
+	}
+
+	return 0;
+}
+
+// function : map_segment()
+// description : Map the keys of a request (shared, in place). Takes
+//               ownership of seg_fd.
+//---------------------------------------------------------------------
+
+int map_segment(struct sort_request *req, int seg_fd, struct job *j)
+{
+	struct stat st;
+	long page = sysconf(_SC_PAGESIZE);
+
+	if (req->shm_name[0] != '\0') {
+
+		req->shm_name[SORT_SHM_NAME_LENGTH-1] = '\0';
+		if (seg_fd >= 0)
+			close(seg_fd);
+		seg_fd = shm_open(req->shm_name, O_RDWR, 0);
+	}
+
+	if (seg_fd < 0)
+		return SORT_EMAP;
+
+	if (fstat(seg_fd, &st) != 0 || req->count > 0x7fffffff ||
+	    req->offset + req->count * sizeof(int) > (uint64_t) st.st_size ||
+	    req->offset % sizeof(int) != 0) {
+		close(seg_fd);
+		return SORT_EINVAL;
+	}
+
+	// the mapping has to start on a page boundary
+	off_t  base  = (off_t) (req->offset - req->offset % page);
+	size_t delta = (size_t) (req->offset - base);
+
+	j->map_len = delta + req->count * sizeof(int);
+	if (j->map_len == 0)
+		j->map_len = 1;
+
+	j->map = mmap(NULL, j->map_len, PROT_READ|PROT_WRITE, MAP_SHARED, seg_fd, base);
+	close(seg_fd);
+
+	if (j->map == MAP_FAILED)
+		return SORT_EMAP;
+
+	j->keys     = (int*) ((char*) j->map + delta);
+	j->count    = req->count;
+	j->dir      = req->dir ? ENGINE_ASCENDING : ENGINE_DESCENDING;
+	j->priority = req->priority;
+
+	return SORT_OK;
+}
+
+// function : heap_push() / heap_pop()
+// description : Priority queue of the admitted jobs (queue_mutex held).
+//---------------------------------------------------------------------
+
+void heap_push(struct job *j)
+{
+	int i = heap_size++;
+
+	j->seq = next_seq++;
+
+	while (i > 0 && job_before(j, heap[(i-1)/2])) {
+		heap[i] = heap[(i-1)/2];
+		i = (i-1)/2;
+	}
+	heap[i] = j;
+}
+
+struct job* heap_pop(void)
+{
+	struct job *top  = heap[0];
+	struct job *last = heap[--heap_size];
+	int i = 0;
+
+	while (2*i+1 < heap_size) {
+
+		int c = 2*i+1;
+		if (c+1 < heap_size && job_before(heap[c+1], heap[c]))
+			c++;
+		if (!job_before(heap[c], last))
+			break;
+
+		heap[i] = heap[c];
+		i = c;
+	}
+	heap[i] = last;
+
+	return top;
+}
+
+// function : job_before()
+// description : Higher priority first, then first come first served.
+//---------------------------------------------------------------------
+
+int job_before(struct job *x, struct job *y)
+{
+	if (x->priority != y->priority)
+		return x->priority > y->priority;
+
+	return x->seq < y->seq;
+}
+
+// function : latency_stats()
+// description : Fill the counters and the p50/p99 latency of the last
+//               SORT_LATENCY_WINDOW jobs (queue_mutex held).
+//---------------------------------------------------------------------
+
+void latency_stats(struct sort_reply *rep)
+{
+	static double sorted[SORT_LATENCY_WINDOW];
+	int n = (jobs_done < SORT_LATENCY_WINDOW) ? (int) jobs_done : SORT_LATENCY_WINDOW;
+
+	rep->jobs_done     = jobs_done;
+	rep->jobs_rejected = jobs_rejected;
+	rep->latency_p50   = 0;
+	rep->latency_p99   = 0;
+
+	if (n == 0)
+		return;
+
+	memcpy(sorted, latency, n * sizeof(double));
+	qsort(sorted, n, sizeof(double), cmpfunc_double);
+
+	rep->latency_p50 = sorted[(n-1) * 50 / 100];
+	rep->latency_p99 = sorted[(n-1) * 99 / 100];
+}
+
+int cmpfunc_double(const void *x, const void *y)
+{
+	double a = *(const double*) x;
+	double b = *(const double*) y;
+
+	return (a > b) - (a < b);
+}
+
+// function : now()
+// description : Monotonic time in seconds.
+//---------------------------------------------------------------------
+
+double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+void on_signal(int sig)
+{
+	stop = 1;
+}
+
+// function : block_signals()
+// description : Block (1) or unblock (0) SIGINT/SIGTERM in the calling
+//               thread. New threads inherit the mask, so blocking around
+//               pthread_create() keeps the signals on the main thread.
+//---------------------------------------------------------------------
+
+void block_signals(int block)
+{
+	sigset_t set;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGINT);
+	sigaddset(&set, SIGTERM);
+	pthread_sigmask(block ? SIG_BLOCK : SIG_UNBLOCK, &set, NULL);
+}
@@ -0,0 +1,78 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#ifndef SORT_PROTOCOL_H
+#define SORT_PROTOCOL_H
+
+#include <stdint.h>
+
+// Messages between code_sort_client and code_sort_daemon.
+//
+// The keys never travel over the socket. The client puts them in a
+// shared memory segment and either passes the segment's descriptor
+// (memfd, SCM_RIGHTS) or its shm_open() name. The daemon maps the
+// segment, sorts it in place and answers with a sort_reply.
+//===========================================================
+
+#define SORT_SOCKET_PATH "/tmp/bitonic_sort.sock"
+
+#define SORT_MAGIC 0x42534f52 //"BSOR"
+
+#define SORT_SHM_NAME_LENGTH 64
+
+// request types
+#define SORT_OP_SORT  1
+#define SORT_OP_STATS 2
+
+// reply status
+#define SORT_OK      0
+#define SORT_EBUSY   1 //admission control rejected the job
+#define SORT_EINVAL  2 //malformed request or segment too small
+#define SORT_EMAP    3 //could not open/map the segment
+
+// number of finished jobs kept for the latency percentiles
+#define SORT_LATENCY_WINDOW 4096
+
+struct sort_request {
+
+	uint32_t magic;
+	uint32_t op;
+	char     shm_name[SORT_SHM_NAME_LENGTH]; //empty: descriptor attached
+	uint64_t offset;   //byte offset of the keys in the segment
+	uint64_t count;    //number of int keys
+	int32_t  dir;      //1 ascending, 0 descending
+	int32_t  priority; //higher priorities are served first
+};
+
+struct sort_reply {
+
+	int32_t  status;
+	int32_t  threads;       //threads the job was sorted with
+	double   queue_time;    //seconds between admission and start
+	double   sort_time;     //seconds spent sorting
+	uint64_t jobs_done;
+	uint64_t jobs_rejected;
+	double   latency_p50;   //seconds, request received -> reply
+	double   latency_p99;
+	int32_t  presort;       //path the presortedness pre-pass took
+	                        //(PRESORT_* in common/presort.h)
+};
+
+#endif
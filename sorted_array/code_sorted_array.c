@@ -0,0 +1,256 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "../common/sorted_array.h"
+#include "../common/bitonic_engine.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+const char* RESORT_FLAG = "-resort\0";
+const int RESORT_FLAG_LENGTH = 7;
+
+int TEST_MODE   = 0;
+int RESORT_MODE = 0; //also time a full re-sort after every batch
+
+// for time measurements
+struct timeval startwtime, endwtime;
+double seq_time;
+double resort_time = 0;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int P; //number of threads
+int p; //log2(number of threads)
+int N; //initial sorted keys
+int q; //log2(initial keys)
+int B; //keys per batch
+int K; //number of batches
+
+struct sorted_array sa;
+
+int *all;   //every key inserted, for the re-sort and the test
+int  nall;
+
+
+// Function Declaration
+//===========================================================
+
+void   parse_arguments(int argc,char *argv[]);
+void   init           (void);
+void   insert_batches (void);
+void   test           (void);
+double elapsed        (struct timeval*, struct timeval*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+	init();
+	insert_batches();
+	test();
+
+	sorted_array_free(&sa);
+	free(all);
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],RESORT_FLAG,RESORT_FLAG_LENGTH+1)) {
+			RESORT_MODE = 1;
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != 4) {
+		printf("Usage: %s [%s] [%s] p q b k\n\nwhere, %s is an optional flag (test mode)\n       %s also times a full re-sort after every batch\n       P=2^p is the number of threads\n       N=2^q is the number of keys sorted at the start\n       b is the number of keys per batch\n       k is the number of batches inserted\n",
+		       argv[0],TEST_FLAG,RESORT_FLAG,TEST_FLAG,RESORT_FLAG);
+		exit(1);
+	}
+
+	p = atoi(argv[arg]);
+	q = atoi(argv[arg+1]);
+	B = atoi(argv[arg+2]);
+	K = atoi(argv[arg+3]);
+
+	if (B < 1 || K < 0) {
+		printf("b must be at least 1 and k at least 0.\n");
+		exit(1);
+	}
+
+	P = 1 << p;
+	N = 1 << q;
+}
+
+// function : init()
+// description : Fill the array with N random keys (one sort, one group).
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	int i;
+
+	all = (int*) malloc(((size_t) N + (size_t) B * K) * sizeof(int));
+	if (all == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	srand( time(NULL) );
+	for (i = 0; i < N; i++) {
+		all[i] = rand() % N;
+	}
+	nall = N;
+
+	sorted_array_init(&sa, P, B);
+	if (sorted_array_insert(&sa, all, N) != 0 || sorted_array_flush(&sa) != 0) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	sa.merges = sa.merged = 0;
+}
+
+// function : insert_batches()
+// description : Insert K batches of B random keys and time them; with
+//               -resort, also time sorting everything from scratch
+//               after every batch, as a full sort would.
+//---------------------------------------------------------------------
+
+void insert_batches(void)
+{
+	int i, k, n;
+	int *copy = NULL;
+
+	if (RESORT_MODE) {
+		copy = (int*) malloc(((size_t) N + (size_t) B * K) * sizeof(int));
+		if (copy == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+	}
+
+	for (k = 0; k < K; k++) {
+
+		int *batch = all + nall;
+		for (i = 0; i < B; i++) {
+			batch[i] = rand() % N;
+		}
+		nall += B;
+
+		gettimeofday(&startwtime,NULL);
+		if (sorted_array_insert(&sa, batch, B) != 0) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+		gettimeofday(&endwtime,NULL);
+		seq_time += elapsed(&startwtime, &endwtime);
+
+		if (RESORT_MODE) {
+			memcpy(copy, all, (size_t) nall * sizeof(int));
+			gettimeofday(&startwtime,NULL);
+			engine_sort(copy, nall, ENGINE_ASCENDING, P);
+			gettimeofday(&endwtime,NULL);
+			resort_time += elapsed(&startwtime, &endwtime);
+		}
+	}
+
+	// the keys still buffered are part of the last update
+	gettimeofday(&startwtime,NULL);
+	sorted_array_data(&sa, &n);
+	gettimeofday(&endwtime,NULL);
+	seq_time += elapsed(&startwtime, &endwtime);
+
+	printf("%lf\n",seq_time);
+	printf("incremental: %d batches of %d keys, %lld merges of %.1f keys on average\n",
+	       K, B, sa.merges, sa.merges ? (double) sa.merged / sa.merges : 0.0);
+	if (RESORT_MODE)
+		printf("re-sort: %lf s, %.1fx the incremental time\n",
+		       resort_time, seq_time > 0 ? resort_time / seq_time : 0.0);
+
+	free(copy);
+}
+
+// function : test()
+// description : Check the array against stdlib/qsort of every key
+//               inserted.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	int n;
+
+	if (TEST_MODE) {
+
+		int *keys = sorted_array_data(&sa, &n);
+		qsort(all, nall, sizeof(int), engine_cmp_asc);
+
+		if (n == nall && memcmp(keys, all, (size_t) n * sizeof(int)) == 0)
+			printf("Test PASSED. Same results with stdlib/qsort.\n");
+		else
+			printf("Test NOT PASSED. Different results with stdlib/qsort.\n");
+	}
+}
+
+// function : elapsed()
+// description : Seconds between two gettimeofday() samples.
+//---------------------------------------------------------------------
+
+double elapsed(struct timeval *t0, struct timeval *t1)
+{
+	return (double) ( (t1->tv_usec - t0->tv_usec) / 1.0e6
+	                + t1->tv_sec - t0->tv_sec );
+}
@@ -0,0 +1,295 @@
+/*
+ * =======================================================================
+ *  This file is part of Bitonic-Sorter.
+ *  Copyright (C) 2016 Marios Mitalidis
+ *
+ *  Bitonic-Sorter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Bitonic-Sorter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Bitonic-Sorter.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "../common/string_sort.h"
+
+
+// Constants & Variables (Test Related)
+//===========================================================
+
+const char* TEST_FLAG = "-test\0";
+const int TEST_FLAG_LENGTH = 5;
+
+const char* IN_FLAG = "--in\0";
+const int IN_FLAG_LENGTH = 4;
+
+int TEST_MODE = 0;
+
+// for time measurements
+struct timeval startwtime, endwtime;
+double seq_time;
+
+
+// Constants & Variables (Algorithm Related)
+//===========================================================
+
+int P; //number of threads
+int p; //log2(number of threads)
+int N; //number of strings
+
+const char *in_path = NULL; //sort the lines of this file instead
+
+char      *arena;   //the bytes of all strings
+long long *offsets; //string i is arena[offsets[i]..offsets[i+1])
+int       *order;   //the sorted indices
+
+
+// Function Declaration
+//===========================================================
+
+void   parse_arguments(int argc,char *argv[]);
+void   init           (void);
+void   init_file      (void);
+void   sort           (void);
+void   test           (void);
+int    cmp_index      (const void*, const void*);
+double elapsed        (struct timeval*, struct timeval*);
+
+
+// Main
+//===========================================================
+
+int main(int argc, char *argv[])
+{
+	parse_arguments(argc,argv);
+	if (in_path)
+		init_file();
+	else
+		init();
+	sort();
+	test();
+
+	free(arena);
+	free(offsets);
+	free(order);
+
+	return(0);
+}
+
+
+// Function Definition
+//===========================================================
+
+// function : parse_arguments()
+// description : Parse the user arguments and store the inputs
+//               to the respective global variables.
+//---------------------------------------------------------------------
+
+void parse_arguments(int argc, char *argv[])
+{
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+
+		if (!strncmp(argv[arg],TEST_FLAG,TEST_FLAG_LENGTH+1)) {
+			TEST_MODE = 1;
+		}
+		else if (!strncmp(argv[arg],IN_FLAG,IN_FLAG_LENGTH+1) && arg + 1 < argc) {
+			in_path = argv[++arg];
+		}
+		else {
+			printf("Illegal flag received: %s\n",argv[arg]);
+			exit(1);
+		}
+		arg++;
+	}
+
+	if (argc - arg != (in_path ? 1 : 2)) {
+		printf("Usage: %s [%s] p n\n       %s [%s] %s file p\n\nwhere, %s is an optional flag (test mode)\n       P=2^p is the number of threads\n       n is the number of random URLs sorted\n       %s sorts the lines of file instead\n",
+		       argv[0],TEST_FLAG,argv[0],TEST_FLAG,IN_FLAG,TEST_FLAG,IN_FLAG);
+		exit(1);
+	}
+
+	p = atoi(argv[arg]);
+	P = 1 << p;
+
+	if (!in_path) {
+		N = atoi(argv[arg+1]);
+		if (N < 1) {
+			printf("n must be at least 1.\n");
+			exit(1);
+		}
+	}
+}
+
+// function : init()
+// description : N random URL-like strings. They all share the first
+//               12 bytes and many share much more, so most of them go
+//               through the equal-prefix refinement.
+//---------------------------------------------------------------------
+
+void init(void)
+{
+	static const char *paths[] = { "index", "search?q=", "item/", "user/", "" };
+	int i;
+
+	arena   = (char*) malloc((size_t) N * 64);
+	offsets = (long long*) malloc(((size_t) N + 1) * sizeof(long long));
+	order   = (int*) malloc((size_t) N * sizeof(int));
+	if (arena == NULL || offsets == NULL || order == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	srand( time(NULL) );
+	offsets[0] = 0;
+	for (i = 0; i < N; i++) {
+		int len = snprintf(arena + offsets[i], 64, "https://www.site%d.com/%s%d",
+		                   rand() % 1000, paths[rand() % 5], rand() % (N + 1));
+		offsets[i+1] = offsets[i] + len;
+	}
+}
+
+// function : init_file()
+// description : Read in_path and take its lines (without the '\n') as
+//               the strings.
+//---------------------------------------------------------------------
+
+void init_file(void)
+{
+	FILE *f = fopen(in_path, "rb");
+	long  size;
+	long long i;
+
+	if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0) {
+		printf("Error opening %s.\n", in_path);
+		exit(2);
+	}
+	rewind(f);
+
+	arena = (char*) malloc(size + 1);
+	if (arena == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	if (fread(arena, 1, size, f) != (size_t) size) {
+		printf("Error reading %s.\n", in_path);
+		exit(2);
+	}
+	fclose(f);
+
+	// a last line without '\n' is a line too
+	if (size == 0 || arena[size-1] != '\n')
+		arena[size++] = '\n';
+
+	N = 0;
+	for (i = 0; i < size; i++)
+		N += (arena[i] == '\n');
+
+	offsets = (long long*) malloc(((size_t) N + 1) * sizeof(long long));
+	order   = (int*) malloc((size_t) N * sizeof(int));
+	if (offsets == NULL || order == NULL) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+
+	// drop the '\n's, so that the lines are back to back in the arena
+	long long w = 0;
+	int       n = 0;
+	offsets[0] = 0;
+	for (i = 0; i < size; i++) {
+		if (arena[i] == '\n')
+			offsets[++n] = w;
+		else
+			arena[w++] = arena[i];
+	}
+}
+
+// function : sort()
+// description : Sort the strings and print the time.
+//---------------------------------------------------------------------
+
+void sort(void)
+{
+	gettimeofday(&startwtime,NULL);
+	if (string_sort(arena, offsets, N, order, P) != 0) {
+		printf("Error allocating memory.\n");
+		exit(4);
+	}
+	gettimeofday(&endwtime,NULL);
+
+	seq_time = elapsed(&startwtime, &endwtime);
+	printf("%lf\n",seq_time);
+}
+
+// function : test()
+// description : Check the order against stdlib/qsort of the indices,
+//               which compares the strings through a function pointer,
+//               and print its time.
+//---------------------------------------------------------------------
+
+void test(void)
+{
+	int i;
+
+	if (TEST_MODE) {
+
+		int *ref = (int*) malloc((size_t) N * sizeof(int));
+		if (ref == NULL) {
+			printf("Error allocating memory.\n");
+			exit(4);
+		}
+		for (i = 0; i < N; i++)
+			ref[i] = i;
+
+		gettimeofday(&startwtime,NULL);
+		qsort(ref, N, sizeof(int), cmp_index);
+		gettimeofday(&endwtime,NULL);
+		printf("qsort: %lf s\n", elapsed(&startwtime, &endwtime));
+
+		if (memcmp(ref, order, (size_t) N * sizeof(int)) == 0)
+			printf("Test PASSED. Same results with stdlib/qsort.\n");
+		else
+			printf("Test NOT PASSED. Different results with stdlib/qsort.\n");
+
+		free(ref);
+	}
+}
+
+// function : cmp_index()
+// description : qsort comparator of string indices, equal strings by
+//               index like string_sort().
+//---------------------------------------------------------------------
+
+int cmp_index(const void *x, const void *y)
+{
+	int i = *(const int*) x;
+	int j = *(const int*) y;
+	int c = string_cmp(arena, offsets, i, j);
+
+	return c != 0 ? c : (i > j) - (i < j);
+}
+
+// function : elapsed()
+// description : Seconds between two gettimeofday() samples.
+//---------------------------------------------------------------------
+
+double elapsed(struct timeval *t0, struct timeval *t1)
+{
+	return (double) ( (t1->tv_usec - t0->tv_usec) / 1.0e6
+	                + t1->tv_sec - t0->tv_sec );
+}